@@ -1,6 +1,6 @@
 #include <EngTrModel.h>       /* Model's header file */
 #include <rtwtypes.h>
-#include <serial-readline.h>
+#include <TractorLink.h>      /* Binary link with the STM32, shared with Stm32FreeRtos */
 #include <ArduinoJson.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
@@ -16,19 +16,115 @@ const int mqtt_port = 1883;
 
 WiFiClient espClient;
 PubSubClient client(espClient);
-void received(char*);
-SerialLineReader reader(Serial, received);
-JsonDocument doc;
+TractorLink_Rx_t linkRx;
+TractorLink_Msg_t linkMsg;
+uint8_t linkTxSeq = 0;
+uint32_t linkBaud = TL_BAUD_DEFAULT;
+unsigned long linkLastRx = 0;
+uint8_t linkErrors = 0;              // bad frames in a row
+const uint32_t linkRates[TL_BAUD_RATE_COUNT] = TL_BAUD_RATES_INIT;
 int pot = 0;
 int pot_fixed = 0;
 int button = 0;
+const unsigned long STEP_PERIOD_MS = 200;
+unsigned long lastStep = 0;
+
+// Latency trace riding on an input frame, all times on this micros() clock.
+// The STM32 converts its own stamps with the clock sync of TractorLink.h.
+struct LinkTrace {
+  uint16_t id;                       // 0 when no trace is pending
+  uint32_t sampleUs;                 // STM32 ADC sample
+  uint32_t txUs;                     // STM32 frame sent
+  uint32_t rxUs;                     // frame decoded here, received()
+  uint32_t stepUs;                   // EngTrModel_step done
+};
+LinkTrace pendingTrace = {0, 0, 0, 0, 0};
+
+
+bool linkRateSupported(uint32_t baud) {
+  for (uint8_t i = 0; i < TL_BAUD_RATE_COUNT; i++) {
+    if (linkRates[i] == baud) return true;
+  }
+  return false;
+}
+
+// Acknowledge at the current rate, then switch; the STM32 follows on the ack
+void acceptBaud(uint32_t baud) {
+  uint8_t frame[TL_MAX_FRAME];
+  size_t length = TractorLink_Encode_Baud(TL_MSG_BAUD_ACK, baud, linkTxSeq++, frame);
+  Serial.write(frame, length);
+  Serial.flush();
+  Serial.updateBaudRate(baud);
+  linkBaud = baud;
+  linkLastRx = millis();
+  linkErrors = 0;
+}
+
+// Clock sync answer, sent right away so the STM32 sees the shortest round trip
+void answerSync(uint32_t t1, uint32_t t2) {
+  TractorLink_Sync_t sync;
+  uint8_t frame[TL_MAX_FRAME];
+  sync.t1 = t1;
+  sync.t2 = t2;
+  sync.t3 = micros();
+  size_t length = TractorLink_Encode_Sync(TL_MSG_SYNC_ACK, &sync, linkTxSeq++, frame);
+  Serial.write(frame, length);
+}
+
+// New input from the STM32, 'rxUs' is when its frame was decoded
+void received(const TractorLink_Input_t &input, uint32_t rxUs) {
+  pot = input.adc;
+  button = input.button;
+  // A later input before the next step still carries the traced pot position
+  if (input.trace_id != 0) {
+    pendingTrace.id = input.trace_id;
+    pendingTrace.sampleUs = input.sample_us;
+    pendingTrace.txUs = input.tx_us;
+    pendingTrace.rxUs = rxUs;
+  }
+}
 
+// Feed every byte waiting on the STM32 UART, keep the latest input frame
+void pollLink() {
+  TractorLink_Input_t input;
+  TractorLink_Sync_t sync;
+  uint32_t baud;
+  while (Serial.available() > 0) {
+    uint32_t bad = linkRx.stats.crc_errors + linkRx.stats.format_errors;
+    if (TractorLink_Rx_Byte(&linkRx, (uint8_t)Serial.read(), &linkMsg)) {
+      uint32_t now = micros();
+      linkLastRx = millis();
+      linkErrors = 0;
+      if (TractorLink_Decode_Input(&linkMsg, &input) == TL_OK) {
+        received(input, now);
+      } else if (linkMsg.type == TL_MSG_SYNC_REQ && TractorLink_Decode_Sync(&linkMsg, &sync) == TL_OK) {
+        answerSync(sync.t1, now);
+      } else if (linkMsg.type == TL_MSG_BAUD_REQ &&
+                 TractorLink_Decode_Baud(&linkMsg, &baud) == TL_OK && linkRateSupported(baud)) {
+        acceptBaud(baud);
+      }
+    } else if (bad != linkRx.stats.crc_errors + linkRx.stats.format_errors) {
+      linkErrors++;
+    }
+  }
 
-void received(char *line) {
+  // Same fallback rule as the STM32: silence or repeated bad frames
+  if (linkBaud != TL_BAUD_DEFAULT &&
+      (millis() - linkLastRx > TL_LINK_TIMEOUT_MS || linkErrors >= TL_LINK_MAX_ERRORS)) {
+    Serial.updateBaudRate(TL_BAUD_DEFAULT);
+    linkBaud = TL_BAUD_DEFAULT;
+    linkErrors = 0;
+  }
+}
 
-  deserializeJson(doc, line);
-  pot = doc["adc"];
-  button = doc["button"];
+void sendState() {
+  TractorLink_State_t state;
+  uint8_t frame[TL_MAX_FRAME];
+  state.velocity_x100 = (int16_t)constrain(EngTrModel_Y.VehicleSpeed * 100.0, -32768.0, 32767.0);
+  state.rpm = (uint16_t)constrain(EngTrModel_Y.EngineSpeed, 0.0, 65535.0);
+  state.gear = (uint8_t)EngTrModel_Y.Gear;
+  size_t length = TractorLink_Encode_State(&state, linkTxSeq++, frame);
+  Serial.write(frame, length);
 }
 
 void setup_wifi() {
@@ -56,10 +152,11 @@ void reconnect() {
     // Serial.print("Conectando al broker MQTT...");
     if (client.connect("stm32client")) {
       client.subscribe("tractor/control");
+      client.subscribe("tractor/sync");
       // Serial.println("Conectado!");
     } else {
       // Serial.print("Fallo, rc=");
-      Serial.print(client.state());
+      // Serial.print(client.state());  // Serial is the binary STM32 link
       // Serial.println(" intentando de nuevo en 5 segundos");
       delay(5000);
     }
@@ -67,6 +164,7 @@ void reconnect() {
 }
 
 void callback(char* topic, byte* payload, unsigned int length) {
+  uint32_t now = micros();
   // deserialize incoming JSON
   DynamicJsonDocument doc(128);
   DeserializationError err = deserializeJson(doc, payload, length);
@@ -83,15 +181,22 @@ void callback(char* topic, byte* payload, unsigned int length) {
       EngTrModel_U.Throttle    = pedal ? 200.0 : 0.0;
       EngTrModel_U.BrakeTorque = brake ? 10000.0 : 0.0;
     }
+  } else if (t == "tractor/sync") {
+    // Backend clock sync, same exchange as on the STM32 link: it keeps t1, we add t2 and t3
+    String reply = String("{\"id\":") + doc["id"].as<unsigned long>() +
+                   ",\"t2\":" + now + ",\"t3\":" + micros() + "}";
+    client.publish("tractor/sync/reply", reply.c_str());
   }
 }
 void setup()
 {
   delay(3000);
-  Serial.begin(9600);
+  Serial.setRxBufferSize(1024);       // ~200 ms of input frames at 921600 between polls
+  Serial.begin(TL_BAUD_DEFAULT);
   setup_wifi();
   client.setServer(mqtt_server, mqtt_port);
   client.setCallback(callback);
+  TractorLink_Rx_Init(&linkRx);
   EngTrModel_initialize();
 }
 
@@ -100,26 +205,36 @@ void loop()
   if (!client.connected()) {
     reconnect();
   }
+  // Link and MQTT are served every pass, the model only every STEP_PERIOD_MS,
+  // so frames are stamped when they arrive and sync requests answered at once
   client.loop();
-  reader.poll();
+  pollLink();
+  if (millis() - lastStep < STEP_PERIOD_MS) {
+    delay(1);
+    return;
+  }
+  lastStep = millis();
+
   if (controlMode == "dashboard") {
     // in dashboard mode, use UART pot/button
     pot_fixed = map(pot, 0, 4095, 0, 200);
     EngTrModel_U.Throttle = (pot_fixed > 0) ? pot_fixed : 0.0;
     EngTrModel_U.BrakeTorque = (button ? 10000.0 : 0.0);
   }
+  LinkTrace trace = pendingTrace;
+  pendingTrace.id = 0;
   EngTrModel_step( );
+  trace.stepUs = micros();
   String mqttMsg = String("{\"velocity\":") + EngTrModel_Y.VehicleSpeed +
                        ",\"rpm\":" + EngTrModel_Y.EngineSpeed +
-                       ",\"gear\":" + EngTrModel_Y.Gear +"}";
+                       ",\"gear\":" + EngTrModel_Y.Gear;
+  if (trace.id != 0) {
+    // Hop stamps in path order, the last one is the publish
+    mqttMsg += String(",\"trace\":{\"id\":") + trace.id + ",\"t\":[" + trace.sampleUs + "," +
+               trace.txUs + "," + trace.rxUs + "," + trace.stepUs + "," + micros() + "]}";
+  }
+  mqttMsg += "}";
 
   client.publish("tractor/data", mqttMsg.c_str());
-  Serial.print(EngTrModel_Y.VehicleSpeed);
-  Serial.print("V");
-  Serial.print(EngTrModel_Y.EngineSpeed);
-  Serial.print("S");
-  Serial.print(EngTrModel_Y.Gear);
-  Serial.print("E");
-  delay(200);
-  
+  sendState();
 }
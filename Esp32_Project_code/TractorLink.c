@@ -0,0 +1,309 @@
+/*
+ * File: TractorLink.c
+ *
+ * COBS framing, CRC-16/CCITT-FALSE and message packing for the STM32 <-> ESP32
+ * link. Plain C99 with no dependencies, built unchanged on the STM32, the ESP32
+ * and the host. See TractorLink.h for the frame layout.
+ */
+#include <string.h>
+#include "TractorLink.h"
+
+#if !TL_HW_CRC
+
+/* Nibble table, 32 bytes of flash instead of 512 for the byte table */
+static const uint16_t TractorLink_Crc_Table[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t TractorLink_Crc16(const uint8_t *data, size_t length)
+{
+  uint16_t crc = 0xFFFFU;
+  while (length--) {
+    crc = (uint16_t)((crc << 4) ^ TractorLink_Crc_Table[(crc >> 12) ^ (*data >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ TractorLink_Crc_Table[(crc >> 12) ^ (*data & 0x0FU)]);
+    data++;
+  }
+
+  return crc;
+}
+
+#endif                                 /* !TL_HW_CRC */
+
+/* Returns the encoded length including the trailing delimiter */
+size_t TractorLink_Cobs_Encode(const uint8_t *in, size_t length, uint8_t *out)
+{
+  size_t read = 0;
+  size_t write = 1;
+  size_t code_index = 0;
+  uint8_t code = 1;
+  while (read < length) {
+    if (in[read] == 0U) {
+      out[code_index] = code;
+      code_index = write++;
+      code = 1;
+    } else {
+      out[write++] = in[read];
+      code++;
+      if (code == 0xFFU) {
+        out[code_index] = code;
+        code_index = write++;
+        code = 1;
+      }
+    }
+
+    read++;
+  }
+
+  out[code_index] = code;
+  out[write++] = TL_DELIMITER;
+  return write;
+}
+
+/* 'in' excludes the delimiter. Returns the decoded length, 0 on a malformed block */
+TL_RAMFUNC size_t TractorLink_Cobs_Decode(const uint8_t *in, size_t length, uint8_t *out)
+{
+  size_t read = 0;
+  size_t write = 0;
+  uint8_t code;
+  uint8_t i;
+  while (read < length) {
+    code = in[read++];
+    if (code == 0U || read + code - 1U > length) {
+      return 0;
+    }
+
+    for (i = 1; i < code; i++) {
+      out[write++] = in[read++];
+    }
+
+    if (code != 0xFFU && read < length) {
+      out[write++] = 0U;
+    }
+  }
+
+  return write;
+}
+
+/* Builds the complete wire frame, returns its length or 0 if the payload is too long */
+size_t TractorLink_Pack(uint8_t type, uint8_t seq, const uint8_t *payload, size_t length,
+  uint8_t *frame)
+{
+  uint8_t raw[TL_MAX_RAW];
+  uint16_t crc;
+  if (length > TL_MAX_PAYLOAD) {
+    return 0;
+  }
+
+  raw[0] = type;
+  raw[1] = seq;
+  memcpy(&raw[TL_HEADER_SIZE], payload, length);
+  crc = TractorLink_Crc16(raw, TL_HEADER_SIZE + length);
+  raw[TL_HEADER_SIZE + length] = (uint8_t)(crc >> 8);
+  raw[TL_HEADER_SIZE + length + 1U] = (uint8_t)crc;
+  return TractorLink_Cobs_Encode(raw, TL_HEADER_SIZE + length + TL_CRC_SIZE, frame);
+}
+
+/* 'frame' is one received frame without its delimiter */
+TL_RAMFUNC int TractorLink_Unpack(const uint8_t *frame, size_t length, TractorLink_Msg_t *msg)
+{
+  uint8_t raw[TL_MAX_RAW];
+  size_t raw_length;
+  if (length == 0U || length > TL_MAX_RAW + 1U) {
+    return TL_ERR_LENGTH;
+  }
+
+  raw_length = TractorLink_Cobs_Decode(frame, length, raw);
+  if (raw_length == 0U) {
+    return TL_ERR_COBS;
+  }
+
+  if (raw_length < TL_HEADER_SIZE + TL_CRC_SIZE) {
+    return TL_ERR_LENGTH;
+  }
+
+  /* Running the CRC over the data and its own big-endian CRC leaves zero */
+  if (TractorLink_Crc16(raw, raw_length) != 0U) {
+    return TL_ERR_CRC;
+  }
+
+  msg->type = raw[0];
+  msg->seq = raw[1];
+  msg->length = (uint8_t)(raw_length - TL_HEADER_SIZE - TL_CRC_SIZE);
+  memcpy(msg->payload, &raw[TL_HEADER_SIZE], msg->length);
+  return TL_OK;
+}
+
+static void TractorLink_Put32(uint8_t *dst, uint32_t value)
+{
+  dst[0] = (uint8_t)value;
+  dst[1] = (uint8_t)(value >> 8);
+  dst[2] = (uint8_t)(value >> 16);
+  dst[3] = (uint8_t)(value >> 24);
+}
+
+TL_RAMFUNC static uint32_t TractorLink_Get32(const uint8_t *src)
+{
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) |
+    ((uint32_t)src[3] << 24);
+}
+
+/* The trace tail is only sent when input->trace_id is not zero */
+size_t TractorLink_Encode_Input(const TractorLink_Input_t *input, uint8_t seq, uint8_t *frame)
+{
+  uint8_t payload[TL_INPUT_TRACE_SIZE];
+  payload[0] = (uint8_t)input->adc;
+  payload[1] = (uint8_t)(input->adc >> 8);
+  payload[2] = input->button;
+  if (input->trace_id == 0U) {
+    return TractorLink_Pack(TL_MSG_INPUT, seq, payload, TL_INPUT_SIZE, frame);
+  }
+
+  payload[3] = (uint8_t)input->trace_id;
+  payload[4] = (uint8_t)(input->trace_id >> 8);
+  TractorLink_Put32(&payload[5], input->sample_us);
+  TractorLink_Put32(&payload[9], input->tx_us);
+  return TractorLink_Pack(TL_MSG_INPUT, seq, payload, TL_INPUT_TRACE_SIZE, frame);
+}
+
+size_t TractorLink_Encode_State(const TractorLink_State_t *state, uint8_t seq, uint8_t *frame)
+{
+  uint8_t payload[TL_STATE_SIZE];
+  payload[0] = (uint8_t)state->velocity_x100;
+  payload[1] = (uint8_t)((uint16_t)state->velocity_x100 >> 8);
+  payload[2] = (uint8_t)state->rpm;
+  payload[3] = (uint8_t)(state->rpm >> 8);
+  payload[4] = state->gear;
+  return TractorLink_Pack(TL_MSG_STATE, seq, payload, sizeof(payload), frame);
+}
+
+int TractorLink_Decode_Input(const TractorLink_Msg_t *msg, TractorLink_Input_t *input)
+{
+  if (msg->type != TL_MSG_INPUT ||
+      (msg->length != TL_INPUT_SIZE && msg->length != TL_INPUT_TRACE_SIZE)) {
+    return TL_ERR_LENGTH;
+  }
+
+  input->adc = (uint16_t)(msg->payload[0] | (msg->payload[1] << 8));
+  input->button = msg->payload[2];
+  input->trace_id = 0U;
+  input->sample_us = 0U;
+  input->tx_us = 0U;
+  if (msg->length == TL_INPUT_TRACE_SIZE) {
+    input->trace_id = (uint16_t)(msg->payload[3] | (msg->payload[4] << 8));
+    input->sample_us = TractorLink_Get32(&msg->payload[5]);
+    input->tx_us = TractorLink_Get32(&msg->payload[9]);
+  }
+  return TL_OK;
+}
+
+TL_RAMFUNC int TractorLink_Decode_State(const TractorLink_Msg_t *msg, TractorLink_State_t *state)
+{
+  if (msg->type != TL_MSG_STATE || msg->length != TL_STATE_SIZE) {
+    return TL_ERR_LENGTH;
+  }
+
+  state->velocity_x100 = (int16_t)(msg->payload[0] | (msg->payload[1] << 8));
+  state->rpm = (uint16_t)(msg->payload[2] | (msg->payload[3] << 8));
+  state->gear = msg->payload[4];
+  return TL_OK;
+}
+
+/* 'type' is TL_MSG_BAUD_REQ or TL_MSG_BAUD_ACK */
+size_t TractorLink_Encode_Baud(uint8_t type, uint32_t baud, uint8_t seq, uint8_t *frame)
+{
+  uint8_t payload[TL_BAUD_SIZE];
+  TractorLink_Put32(payload, baud);
+  return TractorLink_Pack(type, seq, payload, sizeof(payload), frame);
+}
+
+int TractorLink_Decode_Baud(const TractorLink_Msg_t *msg, uint32_t *baud)
+{
+  if ((msg->type != TL_MSG_BAUD_REQ && msg->type != TL_MSG_BAUD_ACK) ||
+      msg->length != TL_BAUD_SIZE) {
+    return TL_ERR_LENGTH;
+  }
+
+  *baud = TractorLink_Get32(msg->payload);
+  return TL_OK;
+}
+
+/* 'type' is TL_MSG_SYNC_REQ (t1 only) or TL_MSG_SYNC_ACK */
+size_t TractorLink_Encode_Sync(uint8_t type, const TractorLink_Sync_t *sync, uint8_t seq,
+  uint8_t *frame)
+{
+  uint8_t payload[TL_SYNC_ACK_SIZE];
+  TractorLink_Put32(&payload[0], sync->t1);
+  TractorLink_Put32(&payload[4], sync->t2);
+  TractorLink_Put32(&payload[8], sync->t3);
+  return TractorLink_Pack(type, seq, payload,
+    (type == TL_MSG_SYNC_REQ) ? TL_SYNC_REQ_SIZE : TL_SYNC_ACK_SIZE, frame);
+}
+
+/* Decoded in the STM32 UART interrupt for the answers */
+TL_RAMFUNC int TractorLink_Decode_Sync(const TractorLink_Msg_t *msg, TractorLink_Sync_t *sync)
+{
+  if (!(msg->type == TL_MSG_SYNC_REQ && msg->length == TL_SYNC_REQ_SIZE) &&
+      !(msg->type == TL_MSG_SYNC_ACK && msg->length == TL_SYNC_ACK_SIZE)) {
+    return TL_ERR_LENGTH;
+  }
+
+  sync->t1 = TractorLink_Get32(&msg->payload[0]);
+  sync->t2 = 0U;
+  sync->t3 = 0U;
+  if (msg->type == TL_MSG_SYNC_ACK) {
+    sync->t2 = TractorLink_Get32(&msg->payload[4]);
+    sync->t3 = TractorLink_Get32(&msg->payload[8]);
+  }
+  return TL_OK;
+}
+
+void TractorLink_Rx_Init(TractorLink_Rx_t *rx)
+{
+  memset(rx, 0, sizeof(*rx));
+}
+
+/* Returns 1 when 'byte' completed a valid frame, now in 'msg' */
+TL_RAMFUNC int TractorLink_Rx_Byte(TractorLink_Rx_t *rx, uint8_t byte, TractorLink_Msg_t *msg)
+{
+  int result;
+  if (byte != TL_DELIMITER) {
+    if (rx->length < sizeof(rx->buffer)) {
+      rx->buffer[rx->length++] = byte;
+    } else {
+      rx->overflow = 1U;
+    }
+
+    return 0;
+  }
+
+  /* Delimiter: a back-to-back one is just idle line, anything else is a frame */
+  if (rx->length == 0U) {
+    return 0;
+  }
+
+  if (rx->overflow) {
+    result = TL_ERR_LENGTH;
+  } else {
+    result = TractorLink_Unpack(rx->buffer, rx->length, msg);
+  }
+
+  rx->length = 0;
+  rx->overflow = 0;
+  if (result == TL_ERR_CRC) {
+    rx->stats.crc_errors++;
+    return 0;
+  } else if (result != TL_OK) {
+    rx->stats.format_errors++;
+    return 0;
+  }
+
+  if (rx->synced && msg->seq != rx->next_seq) {
+    rx->stats.lost += (uint8_t)(msg->seq - rx->next_seq);
+  }
+
+  rx->synced = 1U;
+  rx->next_seq = (uint8_t)(msg->seq + 1U);
+  rx->stats.frames++;
+  return 1;
+}
@@ -0,0 +1,167 @@
+/*
+ * File: TractorLink.h
+ *
+ * Binary link between the STM32 and the ESP32 (UART).
+ * The same TractorLink.h / TractorLink.c pair is copied into every project that
+ * talks on the link (Stm32FreeRtos/Core, Esp32_Project_code), keep the copies equal.
+ *
+ * Frame on the wire:  COBS( type | seq | payload | crc16 ) 0x00
+ *   type     message identifier (TL_MSG_*)
+ *   seq      per-sender counter, incremented on every frame, gaps count as lost
+ *   payload  little-endian fields, fixed size per type (INPUT has an optional
+ *            trace tail, see TL_INPUT_TRACE_SIZE)
+ *   crc16    CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over type, seq and
+ *            payload, most significant byte first
+ * COBS removes every 0x00 from the frame so 0x00 only marks the end of a frame,
+ * a receiver resynchronises on the next delimiter after any corrupted byte.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TRACTORLINK_H_
+#define TRACTORLINK_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The STM32 computes the CRC on its hardware unit, see user_crc.c */
+#if defined(STM32C031xx)
+#define TL_HW_CRC              1
+#else
+#define TL_HW_CRC              0
+#endif
+
+/* Receive path, run per byte from the STM32 UART interrupt: placed in SRAM there */
+#if defined(STM32C031xx) && !defined(USER_NO_RAMFUNC)
+#define TL_RAMFUNC             __attribute__((section(".RamFunc"), noinline))
+#else
+#define TL_RAMFUNC
+#endif
+
+#define TL_DELIMITER           0x00U
+#define TL_HEADER_SIZE         2U//	type + seq
+#define TL_CRC_SIZE            2U
+#define TL_MAX_PAYLOAD         16U
+#define TL_MAX_RAW             ( TL_HEADER_SIZE + TL_MAX_PAYLOAD + TL_CRC_SIZE )
+#define TL_MAX_FRAME           ( TL_MAX_RAW + 2U )//	COBS overhead byte + delimiter
+
+/* Message types */
+#define TL_MSG_INPUT           0x01U//	STM32 -> ESP32, pedal and brake inputs
+#define TL_MSG_STATE           0x02U//	ESP32 -> STM32, model outputs
+#define TL_MSG_BAUD_REQ        0x03U//	STM32 -> ESP32, proposed baud rate
+#define TL_MSG_BAUD_ACK        0x04U//	ESP32 -> STM32, rate accepted, both ends switch after it
+#define TL_MSG_SYNC_REQ        0x05U//	STM32 -> ESP32, clock sync request
+#define TL_MSG_SYNC_ACK        0x06U//	ESP32 -> STM32, clock sync answer
+
+#define TL_INPUT_SIZE          3U
+#define TL_INPUT_TRACE_SIZE    13U//	INPUT followed by trace id, sample and send time
+#define TL_STATE_SIZE          5U
+#define TL_BAUD_SIZE           4U
+#define TL_SYNC_REQ_SIZE       4U
+#define TL_SYNC_ACK_SIZE       12U
+
+/*
+ * Link speed negotiation. Both ends boot at TL_BAUD_DEFAULT. The STM32 offers
+ * the rates of TL_BAUD_RATES_INIT fastest first, the ESP32 acknowledges at the
+ * old rate and both switch. Either end goes back to TL_BAUD_DEFAULT when no
+ * valid frame arrived for TL_LINK_TIMEOUT_MS or after TL_LINK_MAX_ERRORS bad
+ * frames in a row, the STM32 then offers the next slower rate.
+ */
+#define TL_BAUD_DEFAULT        9600UL
+#define TL_BAUD_RATES_INIT     { 921600UL, 460800UL, 115200UL }
+#define TL_BAUD_RATE_COUNT     3U
+#define TL_LINK_TIMEOUT_MS     1000U
+#define TL_LINK_MAX_ERRORS     8U
+
+/*
+ * Clock sync and latency tracing. The STM32 sends SYNC_REQ with t1, its
+ * microseconds when the request went out. The ESP32 answers SYNC_ACK with t1
+ * echoed, t2 when it read the request and t3 right before writing the answer,
+ * the STM32 takes t4 when the answer completes. The STM32 keeps the ESP32
+ * clock offset and rate from the exchanges with the shortest round trip.
+ *
+ * Once in sync some INPUT frames carry a trace: a non-zero id, the time the
+ * ADC sample was taken and the time the frame went out, both already on the
+ * ESP32 clock (micros()). The ESP32 passes the trace on with the next model
+ * step, see Esp32_Project_code and PythonApi.
+ */
+#define TL_SYNC_PERIOD_MS      125U
+#define TL_TRACE_PERIOD_MS     500U
+
+/* TractorLink_Unpack results */
+#define TL_OK                  0
+#define TL_ERR_COBS            -1
+#define TL_ERR_LENGTH          -2
+#define TL_ERR_CRC             -3
+
+typedef struct {
+  uint16_t adc;                        /* potentiometer, 12-bit ADC counts */
+  uint8_t button;                      /* brake button, 0 or 1 */
+  uint16_t trace_id;                   /* 0 when the frame carries no trace */
+  uint32_t sample_us;                  /* trace only, ESP32 clock */
+  uint32_t tx_us;                      /* trace only, ESP32 clock */
+} TractorLink_Input_t;
+
+typedef struct {
+  int16_t velocity_x100;               /* vehicle speed, km/h * 100 */
+  uint16_t rpm;                        /* engine speed */
+  uint8_t gear;
+} TractorLink_State_t;
+
+typedef struct {
+  uint32_t t1;                         /* STM32, request sent */
+  uint32_t t2;                         /* ESP32, request read */
+  uint32_t t3;                         /* ESP32, answer written */
+} TractorLink_Sync_t;
+
+typedef struct {
+  uint8_t type;
+  uint8_t seq;
+  uint8_t length;
+  uint8_t payload[TL_MAX_PAYLOAD];
+} TractorLink_Msg_t;
+
+typedef struct {
+  uint32_t frames;                     /* good frames */
+  uint32_t crc_errors;
+  uint32_t format_errors;              /* bad COBS, wrong length or too long */
+  uint32_t lost;                       /* sequence gaps */
+} TractorLink_Stats_t;
+
+/* Receiver state, one per link, fed one byte at a time (safe to run in an ISR) */
+typedef struct {
+  uint8_t buffer[TL_MAX_FRAME];
+  uint8_t length;
+  uint8_t overflow;
+  uint8_t synced;
+  uint8_t next_seq;
+  TractorLink_Stats_t stats;
+} TractorLink_Rx_t;
+
+uint16_t TractorLink_Crc16(const uint8_t *data, size_t length);
+size_t TractorLink_Cobs_Encode(const uint8_t *in, size_t length, uint8_t *out);
+size_t TractorLink_Cobs_Decode(const uint8_t *in, size_t length, uint8_t *out);
+
+size_t TractorLink_Pack(uint8_t type, uint8_t seq, const uint8_t *payload, size_t length,
+  uint8_t *frame);
+int TractorLink_Unpack(const uint8_t *frame, size_t length, TractorLink_Msg_t *msg);
+
+size_t TractorLink_Encode_Input(const TractorLink_Input_t *input, uint8_t seq, uint8_t *frame);
+size_t TractorLink_Encode_State(const TractorLink_State_t *state, uint8_t seq, uint8_t *frame);
+int TractorLink_Decode_Input(const TractorLink_Msg_t *msg, TractorLink_Input_t *input);
+int TractorLink_Decode_State(const TractorLink_Msg_t *msg, TractorLink_State_t *state);
+size_t TractorLink_Encode_Baud(uint8_t type, uint32_t baud, uint8_t seq, uint8_t *frame);
+int TractorLink_Decode_Baud(const TractorLink_Msg_t *msg, uint32_t *baud);
+size_t TractorLink_Encode_Sync(uint8_t type, const TractorLink_Sync_t *sync, uint8_t seq,
+  uint8_t *frame);
+int TractorLink_Decode_Sync(const TractorLink_Msg_t *msg, TractorLink_Sync_t *sync);
+
+void TractorLink_Rx_Init(TractorLink_Rx_t *rx);
+int TractorLink_Rx_Byte(TractorLink_Rx_t *rx, uint8_t byte, TractorLink_Msg_t *msg);
+
+#endif                                 /* TRACTORLINK_H_ */
+
+#ifdef __cplusplus
+}
+#endif
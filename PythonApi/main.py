@@ -6,12 +6,13 @@ Python backend with MQTT client and REST API
 
 import json
 import csv
+import math
 import threading
 import time
 from datetime import datetime
 from typing import Dict, List, Optional
 from dataclasses import dataclass, asdict
-from collections import deque
+from collections import deque, OrderedDict
 import os
 import asyncio
 
@@ -45,6 +46,149 @@ class ControlCommand(BaseModel):
     pedal: bool
     brake: bool
 
+def now_us() -> int:
+    """Backend clock of the latency traces, in microseconds"""
+    return time.monotonic_ns() // 1000
+
+class ClockSync:
+    """
+    Offset of a remote clock from now_us(), NTP style: t1 when the request
+    left, t2 and t3 stamped by the peer on receive and answer, t4 when the
+    answer arrived. The exchange with the shortest round trip among the last
+    `window` ones is used, its two legs are the closest to equal.
+    """
+
+    def __init__(self, window: int = 8, wrap_bits: Optional[int] = None):
+        self.samples: deque = deque(maxlen=window)
+        self.requests: OrderedDict = OrderedDict()  # id -> t1
+        self.next_id = 1
+        self.wrap = 1 << wrap_bits if wrap_bits else None
+        self.lock = threading.Lock()
+
+    def _diff(self, a: int, b: int) -> int:
+        """a - b on the peer clock, which wraps for the ESP32 micros()"""
+        d = a - b
+        if self.wrap:
+            d = (d + self.wrap // 2) % self.wrap - self.wrap // 2
+        return d
+
+    def request(self) -> int:
+        """Id of a new exchange, stamped now"""
+        with self.lock:
+            request_id = self.next_id
+            self.next_id = self.next_id % 65535 + 1
+            self.requests[request_id] = now_us()
+            while len(self.requests) > 16:
+                self.requests.popitem(last=False)
+        return request_id
+
+    def answer(self, request_id: int, t2: int, t3: int, t4: int):
+        with self.lock:
+            t1 = self.requests.pop(request_id, None)
+            if t1 is None:
+                return
+            rtt = (t4 - t1) - self._diff(t3, t2)
+            # Peer time t2 happened half a round trip after t1
+            self.samples.append((max(rtt, 0), t2, t1 + max(rtt, 0) // 2))
+
+    def ready(self) -> bool:
+        return len(self.samples) > 0
+
+    def rtt_us(self) -> Optional[int]:
+        with self.lock:
+            return min(self.samples)[0] if self.samples else None
+
+    def to_local(self, peer_us: int) -> Optional[int]:
+        """now_us() time of a peer timestamp, None before the first exchange"""
+        with self.lock:
+            if not self.samples:
+                return None
+            _, peer_ref, local_ref = min(self.samples)
+        return local_ref + self._diff(peer_us, peer_ref)
+
+# Hops of a latency trace, in path order. STM32 ADC sample -> frame sent (stm32)
+# -> ESP32 received() (serial) -> EngTrModel_step (model) -> MQTT publish
+# (publish) -> on_mqtt_message (mqtt) -> WebSocket broadcast (backend) ->
+# ws.onmessage (websocket) -> next painted frame (render)
+TRACE_HOPS = ("stm32", "serial", "model", "publish", "mqtt", "backend", "websocket", "render")
+
+def percentile(ordered: List[float], fraction: float) -> float:
+    """Nearest-rank percentile of an already sorted list"""
+    return ordered[max(0, math.ceil(fraction * len(ordered)) - 1)]
+
+class LatencyTracer:
+    """
+    End-to-end latency traces. The ESP32 sends the first five stamps (up to its
+    MQTT publish) on its own clock, the backend adds its two, the dashboard
+    sends back the last two already on the backend clock. Every hop keeps its
+    last `history` latencies for the p50/p99 of /api/latency.
+    """
+
+    def __init__(self, history: int = 1000):
+        self.hops: Dict[str, deque] = {hop: deque(maxlen=history) for hop in TRACE_HOPS + ("total",)}
+        self.pending: OrderedDict = OrderedDict()  # id -> stamps, now_us() clock
+        self.recent: deque = deque(maxlen=100)
+        self.unsynced = 0
+        self.lock = threading.Lock()
+
+    def _record(self, stamps: List[int], first: int):
+        for i in range(first, len(stamps) - 1):
+            self.hops[TRACE_HOPS[i]].append((stamps[i + 1] - stamps[i]) / 1000.0)
+
+    def start(self, trace: Dict, mqtt_rx_us: int, esp_clock: ClockSync) -> Optional[int]:
+        """Trace of a tractor/data message, returns its id or None when unusable"""
+        trace_id = int(trace.get('id', 0))
+        stamps = [esp_clock.to_local(int(t)) for t in trace.get('t', [])]
+        if trace_id == 0 or len(stamps) != 5:
+            return None
+        if None in stamps:
+            with self.lock:
+                self.unsynced += 1
+            return None
+        stamps.append(mqtt_rx_us)
+        with self.lock:
+            self.pending[trace_id] = stamps
+            while len(self.pending) > 64:
+                self.pending.popitem(last=False)
+            self._record(stamps, 0)
+        return trace_id
+
+    def broadcast(self, trace_id: int, tx_us: int):
+        with self.lock:
+            stamps = self.pending.get(trace_id)
+            if stamps is not None and len(stamps) == 6:
+                stamps.append(tx_us)
+                self._record(stamps, 5)
+
+    def complete(self, trace_id: int, rx_us: int, render_us: int):
+        """Stamps of the first dashboard to answer, later answers are ignored"""
+        with self.lock:
+            stamps = self.pending.pop(trace_id, None)
+            if stamps is None or len(stamps) != 7:
+                return
+            stamps += [rx_us, render_us]
+            self._record(stamps, 6)
+            total = (stamps[-1] - stamps[0]) / 1000.0
+            self.hops["total"].append(total)
+            self.recent.append({
+                "id": trace_id,
+                "hops_ms": {hop: (stamps[i + 1] - stamps[i]) / 1000.0 for i, hop in enumerate(TRACE_HOPS)},
+                "total_ms": total,
+            })
+
+    def summary(self) -> Dict:
+        with self.lock:
+            values = {hop: sorted(samples) for hop, samples in self.hops.items()}
+        return {
+            hop: {
+                "count": len(ordered),
+                "p50_ms": percentile(ordered, 0.50) if ordered else None,
+                "p99_ms": percentile(ordered, 0.99) if ordered else None,
+                "max_ms": ordered[-1] if ordered else None,
+            }
+            for hop, ordered in values.items()
+        }
+
 class TractorBackend:
     def __init__(self):
         self.app = FastAPI(title="Tractor Dashboard API", version="1.0.0")
@@ -68,6 +212,10 @@ class TractorBackend:
         
         # WebSocket connections
         self.websocket_connections: List[WebSocket] = []
+
+        # Latency traces, the ESP32 micros() clock wraps at 32 bits
+        self.esp_clock = ClockSync(wrap_bits=32)
+        self.tracer = LatencyTracer()
         
         # Control state
         self.current_control = ControlData(
@@ -101,6 +249,7 @@ class TractorBackend:
             print(f"Connecting to MQTT broker at {self.mqtt_broker}:{self.mqtt_port}")
             self.mqtt_client.connect(self.mqtt_broker, self.mqtt_port, 60)
             self.mqtt_client.loop_start()
+            self.start_clock_sync()
         except Exception as e:
             print(f"Failed to connect to MQTT broker: {e}")
             # Start with simulated data if MQTT fails
@@ -112,7 +261,8 @@ class TractorBackend:
             print("Connected to MQTT broker")
             self.mqtt_connected = True
             client.subscribe("tractor/data")
-            print("Subscribed to tractor/data topic")
+            client.subscribe("tractor/sync/reply")
+            print("Subscribed to tractor/data and tractor/sync/reply topics")
         else:
             print(f"Failed to connect to MQTT broker, return code {rc}")
             self.start_simulation()
@@ -124,12 +274,15 @@ class TractorBackend:
     
     def on_mqtt_message(self, client, userdata, msg):
         """Handle incoming MQTT messages"""
+        rx_us = now_us()
         try:
             topic = msg.topic
             payload = json.loads(msg.payload.decode())
             
             if topic == "tractor/data":
-                self.process_tractor_data(payload)
+                self.process_tractor_data(payload, rx_us)
+            elif topic == "tractor/sync/reply":
+                self.esp_clock.answer(int(payload['id']), int(payload['t2']), int(payload['t3']), rx_us)
                 
         except Exception as e:
             print(f"Error processing MQTT message: {e}")
@@ -138,9 +291,13 @@ class TractorBackend:
         """Capture uvicorn's event loop for thread-safe scheduling."""
         self.loop = asyncio.get_running_loop()
 
-    def process_tractor_data(self, data: Dict):
-        """Process incoming tractor data"""
+    def process_tractor_data(self, data: Dict, rx_us: Optional[int] = None):
+        """Process incoming tractor data, rx_us is the on_mqtt_message time of traced data"""
         try:
+            trace_id = None
+            if 'trace' in data and rx_us is not None:
+                trace_id = self.tracer.start(data['trace'], rx_us, self.esp_clock)
+
             tractor_data = TractorData(
                 velocity=float(data.get('velocity', 0)),
                 rpm=int(data.get('rpm', 0)),
@@ -162,7 +319,7 @@ class TractorBackend:
             if self.loop:
                 try:
                     asyncio.run_coroutine_threadsafe(
-                        self.broadcast_data(),
+                        self.broadcast_data(trace_id),
                         self.loop
                     )
                 except Exception as e:
@@ -193,6 +350,18 @@ class TractorBackend:
         
         simulation_thread = threading.Thread(target=simulate_data, daemon=True)
         simulation_thread.start()
+
+    def start_clock_sync(self):
+        """Keep the ESP32 clock offset fresh for the latency traces"""
+        def sync_clock():
+            while True:
+                if self.mqtt_connected:
+                    payload = json.dumps({"id": self.esp_clock.request()})
+                    self.mqtt_client.publish("tractor/sync", payload)
+                time.sleep(0.25)
+
+        sync_thread = threading.Thread(target=sync_clock, daemon=True)
+        sync_thread.start()
     
     def publish_control_command(self, command: ControlData):
         """Publish control command via MQTT"""
@@ -206,7 +375,7 @@ class TractorBackend:
         else:
             print("MQTT not connected, control command not sent")
     
-    async def broadcast_data(self):
+    async def broadcast_data(self, trace_id: Optional[int] = None):
         """Broadcast current data to all WebSocket clients"""
         if self.current_data:
             message = {
@@ -215,6 +384,10 @@ class TractorBackend:
                 "control": asdict(self.current_control),
                 "mqtt_connected": self.mqtt_connected
             }
+            if trace_id is not None:
+                # The dashboard answers with its receive and render times
+                message["trace"] = {"id": trace_id}
+                self.tracer.broadcast(trace_id, now_us())
             
             # Remove disconnected clients
             active_connections = []
@@ -280,6 +453,21 @@ class TractorBackend:
             
             return {"status": "success", "command": asdict(control_data)}
         
+        @self.app.get("/api/latency")
+        async def get_latency():
+            """Per-hop latency percentiles of the end-to-end traces"""
+            return {
+                "hops": self.tracer.summary(),
+                "unsynced_traces": self.tracer.unsynced,
+                "esp32_sync_rtt_ms": (self.esp_clock.rtt_us() / 1000.0) if self.esp_clock.ready() else None
+            }
+
+        @self.app.get("/api/latency/traces")
+        async def get_latency_traces(limit: int = 20):
+            """Last complete traces, hop by hop"""
+            traces = list(self.tracer.recent)
+            return {"traces": traces[-limit:], "total_traces": len(traces)}
+
         @self.app.get("/api/export/csv")
         async def export_csv():
             """Export data to CSV file"""
@@ -322,9 +510,23 @@ class TractorBackend:
                     }
                     await websocket.send_text(json.dumps(initial_message))
                 
-                # Keep connection alive
+                # Keep connection alive, serving the clock sync and trace answers
                 while True:
-                    await websocket.receive_text()
+                    text = await websocket.receive_text()
+                    rx_us = now_us()
+                    try:
+                        message = json.loads(text)
+                    except ValueError:
+                        continue
+                    if message.get("type") == "sync":
+                        await websocket.send_text(json.dumps({
+                            "type": "sync",
+                            "t1": message.get("t1"),
+                            "t2": rx_us,
+                            "t3": now_us()
+                        }))
+                    elif message.get("type") == "trace":
+                        self.tracer.complete(int(message["id"]), int(message["rx"]), int(message["render"]))
                     
             except WebSocketDisconnect:
                 if websocket in self.websocket_connections:
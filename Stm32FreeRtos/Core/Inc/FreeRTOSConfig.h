@@ -64,11 +64,15 @@ extern uint32_t SystemCoreClock;
 #define configSUPPORT_DYNAMIC_ALLOCATION         1
 #define configUSE_IDLE_HOOK                      0
 #define configUSE_TICK_HOOK                      0
+#define configUSE_MALLOC_FAILED_HOOK             1
+#define configCHECK_FOR_STACK_OVERFLOW           2
 #define configCPU_CLOCK_HZ                       ( SystemCoreClock )
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
-#define configMAX_PRIORITIES                     ( 56 )
-#define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)4096)
+/* Idle 0, Stats 1, Jobs worker 2, timer service 3 (job releases). One ready list each, 20 bytes per priority */
+#define configMAX_PRIORITIES                     ( 4 )
+/* Stack depths are not measured yet: size them from the STATS high-water marks (Tools/stats_series.py --stacks) */
+#define configMINIMAL_STACK_SIZE                 ((uint16_t)64)
+#define configTOTAL_HEAP_SIZE                    ((size_t)256)
 #define configSTACK_ALLOCATION_FROM_SEPARATE_HEAP 0
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
@@ -96,12 +100,13 @@ extern uint32_t SystemCoreClock;
 
 /* Software timer definitions. */
 #define configUSE_TIMERS                         1
-#define configTIMER_TASK_PRIORITY                ( 2 )
+#define configTIMER_TASK_PRIORITY                ( 3 )
 #define configTIMER_QUEUE_LENGTH                 10
-#define configTIMER_TASK_STACK_DEPTH             128
+#define configTIMER_TASK_STACK_DEPTH             96
 
 /* The following flag must be enabled only when using newlib */
-#define configUSE_NEWLIB_REENTRANT          1
+/* No task calls printf or other stateful newlib functions (see user_fmt.c), no _reent per TCB */
+#define configUSE_NEWLIB_REENTRANT          0
 
 /* CMSIS-RTOS V2 flags */
 #define configUSE_OS2_THREAD_SUSPEND_RESUME  1
@@ -140,11 +145,32 @@ standard names. */
 #define xPortPendSVHandler PendSV_Handler
 
 /* IMPORTANT: After 10.3.1 update, Systick_Handler comes from NVIC (if SYS timebase = systick), otherwise from cmsis_os2.c */
+/* The CMSIS-RTOS2 wrapper is not built, SysTick_Handler and the static task memory are in user_rtos.c */
 
 #define USE_CUSTOM_SYSTICK_HANDLER_IMPLEMENTATION 0
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* Index 0 is left for the application, index 1 is the LCD completion notification (LCD_NOTIFY_INDEX) */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES    2
+/* Run-time stats count microseconds on the free-running TIM14, started in System_init */
+#if defined(__ICCARM__) || defined(__ARMCC_VERSION) || defined(__GNUC__)
+extern uint32_t USER_Micros(void);
+#endif
+#define configGENERATE_RUN_TIME_STATS            1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()         USER_Micros()
+/* Kernel trace hooks record into the RAM ring of user_trace.c */
+#if defined(__ICCARM__) || defined(__ARMCC_VERSION) || defined(__GNUC__)
+#include "user_trace.h"
+#endif
+/* Tickless idle, SLEEP or STOP until the RTC alarm, see user_power.c */
+#define configUSE_TICKLESS_IDLE                  2
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP    2
+#if defined(__ICCARM__) || defined(__ARMCC_VERSION) || defined(__GNUC__)
+extern void USER_Power_Sleep(uint32_t expected);
+#endif
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )    USER_Power_Sleep( xExpectedIdleTime )
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
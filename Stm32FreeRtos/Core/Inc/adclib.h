@@ -1,8 +1,22 @@
 #ifndef ADCLIB_H_
 #define ADCLIB_H_
 
+/* Posición de cada canal en el buffer del DMA (orden ascendente del barrido) */
+#define USER_ADC_POT           0U//	IN0  (PA0) potenciometro
+#define USER_ADC_SPARE         1U//	IN1  (PA1) entrada libre
+#define USER_ADC_VREFINT       2U//	IN10 referencia interna, para medir la alimentacion
+#define USER_ADC_CHANNELS      3U
+
+/* Valor de fábrica de VREFINT medido con VDDA = 3.0 V */
+#define USER_ADC_VREFINT_CAL     (( const uint16_t * )0x1FFF756AUL )
+#define USER_ADC_VREFINT_CAL_MV  3000U
+
 static uint8_t USER_ADC_Calibration( void );
 void USER_ADC_Init( void );
 uint16_t USER_ADC_Read( void );
+uint16_t USER_ADC_Get( uint8_t channel );
+uint16_t USER_ADC_Get_VDDA_mV( void );
+void USER_ADC_Suspend( void );
+void USER_ADC_Resume( void );
 
 #endif /* USER_ADC_H_ */
@@ -1,6 +1,8 @@
 #ifndef EXTI_FUNC_H_
 #define EXTI_FUNC_H_
 
-void USER_EXTI1_Init( void );
+void USER_EXTI7_Init( void );
+void USER_EXTI7_Mask( void );
+void USER_EXTI7_Unmask( void );
 
 #endif /* USER_EXTI_H_ */
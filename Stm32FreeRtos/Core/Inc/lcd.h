@@ -20,6 +20,24 @@
 #define LCD_D6_PIN_LOW 	      ( 0x1UL << 30U )//	Reset pin DATA6_LCD (PB14)
 #define LCD_D7_PIN_LOW 	      ( 0x1UL << 31U )//	Reset pin DATA7_LCD (PB15)
 
+//Dimensiones de la pantalla y del framebuffer
+#define LCD_LINES             2U
+#define LCD_COLUMNS           16U
+#define LCD_ADDRESS_UNKNOWN   0xFFU//	Direccion DDRAM desconocida (p. ej. tras escribir la CGRAM)
+
+//Motor de transferencia por interrupcion (TIM16)
+#define LCD_QUEUE_SIZE        128U//	Operaciones en cola, potencia de 2 (cabe LCD_Init completo)
+#define LCD_NOTIFY_INDEX      1U//		Indice de notificacion de tarea usado por LCD_Wait_Idle
+#define LCD_WAIT_SHORT_US     50U//		Tiempo de ejecucion de la mayoria de las instrucciones (37 us)
+#define LCD_WAIT_LONG_US      1600U//	'Clear Display' y 'Return Home' (1.52 ms)
+#define LCD_EN_PULSE_NOPS     12U//		~1 us en alto y en bajo para EN a 48 MHz
+
+#define LCD_OP_MASK           ( 0x3U << 14U )
+#define LCD_OP_CMD            ( 0x0U << 14U )//	Byte con RS = 0
+#define LCD_OP_DATA           ( 0x1U << 14U )//	Byte con RS = 1
+#define LCD_OP_NIBBLE         ( 0x2U << 14U )//	Solo un nibble con RS = 0 (inicializacion)
+#define LCD_OP_WAIT( us )     ( ( 0x3U << 14U ) | ( ( us ) >> 2U ) )//	Espera, hasta 65532 us
+
 //Definimos los nombres de los comandos para el LCD
 #define LCD_Clear( )			LCD_Write_Cmd( 0x01U )//	Borra la pantalla
 #define LCD_Display_ON( )		LCD_Write_Cmd( 0x0EU )//	Pantalla LCD activa
@@ -34,17 +52,22 @@
 #define LCD_Cursor_SRight( )	LCD_Write_Cmd( 0x1CU )//	Movimiento hacia la derecha de la pantalla
 
 //Lista de funciones
-void LCD_Data_Out4(uint8_t val);
-void LCD_Write_Byte(uint8_t val);
+void LCD_Out_Data4(uint8_t val);
 void LCD_Write_Cmd(uint8_t val);
 void LCD_Put_Char(uint8_t c);
 void LCD_Init(void);
 void LCD_Set_Cursor(uint8_t line, uint8_t column);
 void LCD_Put_Str(char * str);
 void LCD_Put_Num(int16_t num);
-char LCD_Busy(void);
 void LCD_Pulse_EN(void);
 void LCD_BarGraphic(int16_t value, int16_t size);
 void LCD_BarGraphicXY(int16_t pos_x, int16_t pos_y, int16_t value);
+void LCD_Frame_Clear(void);
+void LCD_Frame_Put_Str(uint8_t line, uint8_t column, const char * str);
+void LCD_Frame_Invalidate(void);
+uint8_t LCD_Frame_Flush(void);
+uint8_t LCD_Idle(void);
+BaseType_t LCD_Wait_Idle(TickType_t xTicksToWait);
+void TIM16_IRQHandler(void);
 
 #endif /* INC_LCD_H_ */
@@ -46,7 +46,21 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
-
+/*
+ * Code run from SRAM, zero wait states instead of the flash latency at 48 MHz.
+ * The linker script puts .RamFunc in .data, the startup code copies it with
+ * the initialized data. Build with USER_NO_RAMFUNC defined to keep it in flash.
+ *
+ * Before and after: two Debug builds, one with USER_NO_RAMFUNC, under the same
+ * link traffic. The 'p' console command dumps the usart1 and tim3 probes
+ * (user_prof.h), compare their mean and max cycles. The RAM side is the
+ * .RamFunc line of Tools/ram_budget.py on Debug/Stm32FreeRtos.map.
+ */
+#ifndef USER_NO_RAMFUNC
+#define USER_RAMFUNC	__attribute__( ( section( ".RamFunc" ), noinline ) )
+#else
+#define USER_RAMFUNC
+#endif
 /* USER CODE END EM */
 
 /* Exported functions prototypes ---------------------------------------------*/
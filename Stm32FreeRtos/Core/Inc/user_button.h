@@ -0,0 +1,22 @@
+#ifndef USER_BUTTON_H_
+#define USER_BUTTON_H_
+
+#include <stdint.h>
+
+#define USER_BUTTON_DEBOUNCE_US		10000U//	Contact bounce of the brake button, under the 65 ms of TIM14
+#define USER_BUTTON_QUEUE_LENGTH	8U
+
+/* One debounced edge of PA7 */
+typedef struct {
+	uint32_t time_us;//	USER_Micros at the edge
+	uint8_t pressed;
+} USER_Button_Event_t;
+
+extern volatile uint32_t USER_Button_Dropped;//	Events lost to a full queue
+
+void USER_Button_Init( void );
+uint8_t USER_Button_Pressed( void );
+BaseType_t USER_Button_Get( USER_Button_Event_t *event, TickType_t xTicksToWait );
+void EXTI4_15_IRQHandler( void );
+
+#endif /* USER_BUTTON_H_ */
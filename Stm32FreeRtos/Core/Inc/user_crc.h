@@ -0,0 +1,6 @@
+#ifndef USER_CRC_H_
+#define USER_CRC_H_
+
+void USER_CRC_Init( void );
+
+#endif /* USER_CRC_H_ */
@@ -0,0 +1,28 @@
+#ifndef USER_FMT_H_
+#define USER_FMT_H_
+
+/*
+ * Integer formatter, replaces printf/snprintf in the tasks. Every function
+ * writes at 'dst', terminates the string and returns a pointer to the
+ * terminator so calls can be chained into one line:
+ *
+ *   p = USER_Fmt_Str( line, "adc " );
+ *   p = USER_Fmt_Uint( p, adc );
+ *   USER_UART2_Transmit( ( uint8_t * )line, p - line );
+ *
+ * No division (the M0+ has no divider), no allocation, no shared state, so
+ * it is safe from any task or ISR. The caller sizes the buffer, with the
+ * terminator: USER_FMT_UINT_LEN for USER_Fmt_Uint and so on.
+ */
+#define USER_FMT_UINT_LEN	11U//	"4294967295"
+#define USER_FMT_INT_LEN	12U//	"-2147483648"
+#define USER_FMT_FIXED_LEN	13U//	"-2.147483648", decimals up to 9, decimals + 4 above
+
+char *USER_Fmt_Char( char *dst, char c );
+char *USER_Fmt_Str( char *dst, const char *src );
+char *USER_Fmt_Uint( char *dst, uint32_t value );
+char *USER_Fmt_Int( char *dst, int32_t value );
+char *USER_Fmt_Hex( char *dst, uint32_t value, uint8_t digits );
+char *USER_Fmt_Fixed( char *dst, int32_t value, uint8_t decimals );
+
+#endif /* USER_FMT_H_ */
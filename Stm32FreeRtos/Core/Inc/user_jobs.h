@@ -0,0 +1,36 @@
+#ifndef USER_JOBS_H_
+#define USER_JOBS_H_
+
+#define USER_JOBS_MAX			8U//	One release bit per job, at most 32
+#define USER_JOBS_STACK_DEPTH	112U//	Not measured yet, trim with Tools/stats_series.py --stacks
+
+/*
+ * Periodic job, declared in a table by the application. The framework owns the
+ * fields after 'wcet_us', leave them zero in the initializer.
+ */
+typedef struct {
+	const char *name;
+	void ( *run )( void );
+	uint16_t period_ms;
+	uint16_t phase_ms;//	First release after the scheduler starts
+	uint32_t deadline_us;//	Relative to the release, at most the period
+	uint32_t wcet_us;//	Execution time budget
+
+	uint8_t priority;//	Rate-monotonic rank, 0 is the shortest period
+	TimerHandle_t timer;
+	StaticTimer_t timer_buffer;
+	TickType_t release;//	Tick of the latest release
+	uint32_t runs;
+	uint32_t misses;//	Finished after release + deadline
+	uint32_t overruns;//	Ran longer than wcet_us
+	uint32_t skipped;//	Releases lost because the previous one had not run yet
+	uint32_t max_exec_us;
+	uint32_t max_response_us;//	Release to end of run
+} USER_Job_t;
+
+void USER_Jobs_Init( USER_Job_t *jobs, uint8_t count, UBaseType_t priority );
+const USER_Job_t *USER_Jobs_Get( uint8_t index );
+uint32_t USER_Jobs_Utilization( void );
+void USER_Jobs_Worker( void *pvParameters );
+
+#endif /* USER_JOBS_H_ */
@@ -0,0 +1,34 @@
+#ifndef USER_LINK_H_
+#define USER_LINK_H_
+
+#define USER_LINK_REQ_PERIOD_MS	100U//	Baud offers while the ESP32 has not answered
+#define USER_LINK_RETRY_MS		1000U//	Pause after a fallback before offering again
+#define USER_LINK_SYNC_SAMPLES	8U//	Clock sync exchanges per update, the shortest round trip wins
+#define USER_LINK_SKEW_MAX_PPM	20000//	Larger rate differences mean the ESP32 restarted its clock
+#define USER_LINK_SLOW_EVERY	2U//	At TL_BAUD_DEFAULT one INPUT frame per this many calls
+
+/* Untraced INPUT frame with the COBS overhead and delimiter, and its time on the wire */
+#define USER_LINK_INPUT_FRAME	( TL_HEADER_SIZE + TL_INPUT_SIZE + TL_CRC_SIZE + 2U )
+#define USER_LINK_WIRE_US( bytes, baud )	( ( uint32_t )( bytes ) * 10000000UL / ( baud ) )
+
+typedef struct {
+	uint32_t baud;//			Current USART1 rate
+	uint32_t switches;//		Successful negotiations
+	uint32_t fallbacks;//		Returns to TL_BAUD_DEFAULT
+	uint32_t line_errors;//		Framing, noise and overrun errors
+	uint32_t sync_rtt_us;//		Round trip of the exchange behind the clock offset
+	int32_t sync_skew_ppm;//	ESP32 clock rate against the STM32 one
+	uint32_t sync_updates;//	Clock offsets applied since the faster rate was agreed
+	uint32_t traces;//			Traced INPUT frames sent
+} USER_Link_Stats_t;
+
+extern TractorLink_Rx_t USER_Link_Rx;
+extern USER_Link_Stats_t USER_Link_Stats;
+
+void USER_Link_Init( void );
+uint8_t USER_Link_Rx_Byte( uint8_t byte, TractorLink_Msg_t *msg );
+void USER_Link_Rx_Error( void );
+uint8_t USER_Link_To_Peer( uint32_t local_us, uint32_t *peer_us );
+void USER_Link_Send_Input( const TractorLink_Input_t *input, uint32_t sample_us );
+
+#endif /* USER_LINK_H_ */
@@ -0,0 +1,52 @@
+#ifndef USER_POOL_H_
+#define USER_POOL_H_
+
+#include <stdint.h>
+
+#define USER_POOL_MAX	4U//	Pools reported by the stats task
+
+/*
+ * Fixed-block memory pool. Blocks are handed around by pointer, through a
+ * FreeRTOS queue of pointers, never copied. Each block carries a reference
+ * count: USER_Pool_Alloc returns it with one reference, which moves with the
+ * pointer through the queue. Every extra consumer takes one with
+ * USER_Pool_Retain and gives it back with USER_Pool_Release, the last release
+ * puts the block back on the free list.
+ *
+ * Every call is O(1) and safe from tasks and ISRs (short PRIMASK sections).
+ * The storage is static, declared with USER_POOL_DEFINE:
+ *
+ *   USER_POOL_DEFINE( State_Pool, "state", TractorLink_State_t, 4 );
+ *   USER_Pool_Init( &State_Pool );
+ */
+
+/* In front of every block: free list link while free, reference count while in use */
+typedef union {
+	void *next;
+	uint32_t refs;
+} USER_Pool_Header_t;
+
+typedef struct {
+	const char *name;
+	uint8_t *storage;
+	uint16_t block_size;//	Header included, multiple of 4
+	uint16_t blocks;
+	USER_Pool_Header_t *free;
+	uint16_t in_use;
+	uint16_t peak;
+	uint32_t fails;//	Allocations refused, pool empty
+} USER_Pool_t;
+
+#define USER_POOL_BLOCK_SIZE( size )	( ( ( size ) + sizeof( USER_Pool_Header_t ) + 3U ) & ~3U )
+
+#define USER_POOL_DEFINE( pool, label, type, count ) \
+	static uint32_t pool##_Storage[ USER_POOL_BLOCK_SIZE( sizeof( type ) ) * ( count ) / 4U ]; \
+	USER_Pool_t pool = { ( label ), ( uint8_t * )pool##_Storage, USER_POOL_BLOCK_SIZE( sizeof( type ) ), ( count ), 0, 0, 0, 0 }
+
+void USER_Pool_Init( USER_Pool_t *pool );
+void *USER_Pool_Alloc( USER_Pool_t *pool );
+void USER_Pool_Retain( void *block );
+void USER_Pool_Release( USER_Pool_t *pool, void *block );
+const USER_Pool_t *USER_Pool_Get( uint8_t index );
+
+#endif /* USER_POOL_H_ */
@@ -0,0 +1,43 @@
+#ifndef USER_POWER_H_
+#define USER_POWER_H_
+
+#include <stdint.h>
+
+/*
+ * Tickless idle (configUSE_TICKLESS_IDLE 2): when every task is blocked for at
+ * least two ticks the idle task stops SysTick and the HAL timebase and sleeps
+ * until the RTC alarm, an interrupt or a USART1 byte. STOP is used instead of
+ * SLEEP when the idle time is long enough and nothing that stops with the
+ * clocks is busy (USER_Power_Sleep). Build with USER_NO_STOP defined to only
+ * ever use SLEEP.
+ */
+#define USER_PWR_STOP_MIN_TICKS		3U//	Shorter idle times are not worth the STOP entry and exit
+#define USER_PWR_MAX_IDLE_TICKS		800U//	The RTC sub-second counter spans one second
+#define USER_PWR_CAL_COUNTS			256U//	LSI periods measured against TIM14 at init, 8 ms
+
+/*
+ * Supply current of each state, in uA, for the average in the stats report.
+ * Rough typical values for the C031 at 48 MHz and 3.3 V with this firmware's
+ * peripherals on. Measure the board and replace them.
+ */
+#define USER_PWR_RUN_UA				4000U
+#define USER_PWR_SLEEP_UA			1500U
+#define USER_PWR_STOP_UA			100U
+
+typedef struct {
+	uint32_t sleeps;
+	uint32_t stops;
+	uint64_t sleep_us;
+	uint64_t stop_us;
+	uint32_t wake_last_us;//	RTC alarm to the core running again, 31 us steps
+	uint32_t wake_max_us;
+} USER_Power_Stats_t;
+
+extern USER_Power_Stats_t USER_Power_Stats;
+
+void USER_Power_Init( void );
+void USER_Power_Sleep( uint32_t expected );
+uint32_t USER_Power_Average_uA( void );
+void RTC_IRQHandler( void );
+
+#endif /* USER_POWER_H_ */
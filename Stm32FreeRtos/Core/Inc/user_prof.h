@@ -0,0 +1,86 @@
+#ifndef USER_PROF_H_
+#define USER_PROF_H_
+
+#include <stdint.h>
+
+/*
+ * Code path profiler on TIM1, free running at the CPU clock: the M0+ has no
+ * DWT cycle counter. A probe is a scope in one function,
+ *
+ *   PROF_BEGIN( PROF_LCD );
+ *   ...
+ *   PROF_END( PROF_LCD );
+ *
+ * and keeps count, min, max, mean and a log2 histogram of its duration in CPU
+ * cycles, with the probe's own cost removed. Each probe must be used from one
+ * context only (one task or one ISR). Only in DEBUG builds, in release the
+ * macros and the module compile to nothing.
+ */
+#ifdef DEBUG
+#define USER_PROF_ENABLED	1
+#else
+#define USER_PROF_ENABLED	0
+#endif
+
+#define USER_PROF_BUCKETS	20U//	Bucket k counts [2^k, 2^(k+1)) cycles, the last one everything above 2^19 (11 ms)
+
+/* Probes, names in user_prof.c */
+typedef enum {
+	PROF_USART1,//	USART1_IRQHandler, link receiver
+	PROF_TIM3,//	TIM3_IRQHandler, control loop
+	PROF_ADC,//		USER_ADC_Read
+	PROF_LCD,//		Full display refresh, Job_Display
+	PROF_COUNT
+} USER_Prof_Probe_t;
+
+#if USER_PROF_ENABLED
+
+extern volatile uint16_t USER_Prof_Overflows;
+
+/* CPU cycles since USER_Prof_Init, TIM1 extended to 32 bits by its overflow interrupt */
+static inline uint32_t USER_Prof_Now( void ){
+	uint32_t primask;
+	uint32_t high;
+	uint32_t low;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	high = USER_Prof_Overflows;
+	low  = TIM1->CNT;
+	/* Overflow already happened but its interrupt has not run yet */
+	if( ( TIM1->SR & ( 0x1UL << 0U ) ) && low < 0x8000U )
+		high++;
+	__set_PRIMASK( primask );
+
+	return ( high << 16U ) | low;
+}
+
+#define PROF_BEGIN( probe )		uint32_t prof_start_##probe = USER_Prof_Now( )
+#define PROF_END( probe )		USER_Prof_Record( ( probe ), USER_Prof_Now( ) - prof_start_##probe )
+
+/* Around the tickless sleep, the overflow interrupt would end it every 1.37 ms. No probe spans the idle task */
+static inline void USER_Prof_Pause( void ){
+	TIM1->CR1 &= ~( 0x1UL << 0U );
+}
+
+static inline void USER_Prof_Resume( void ){
+	TIM1->CR1 |=  ( 0x1UL << 0U );
+}
+
+void USER_Prof_Init( void );
+void USER_Prof_Record( USER_Prof_Probe_t probe, uint32_t cycles );
+void USER_Prof_Dump( void );
+void TIM1_BRK_UP_TRG_COM_IRQHandler( void );
+
+#else
+
+#define PROF_BEGIN( probe )
+#define PROF_END( probe )
+#define USER_Prof_Init( )
+#define USER_Prof_Dump( )
+#define USER_Prof_Pause( )
+#define USER_Prof_Resume( )
+
+#endif
+
+#endif /* USER_PROF_H_ */
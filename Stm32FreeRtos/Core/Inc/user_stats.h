@@ -0,0 +1,17 @@
+#ifndef USER_STATS_H_
+#define USER_STATS_H_
+
+#define USER_STATS_PERIOD_MS	1000U//	One report line per second
+#define USER_STATS_MAX_TASKS	8U//	Application tasks plus IDLE and Tmr Svc
+#define USER_STATS_STACK_DEPTH	96U
+
+/* Console commands received on USART2 */
+#define USER_STATS_CMD_TRACE	't'
+#define USER_STATS_CMD_PROF		'p'
+
+void USER_Stats_Init( UBaseType_t priority );
+void USER_Stats_Post_State( USER_Pool_t *pool, TractorLink_State_t *state, BaseType_t *woken );
+void USER_Stats_Task( void *pvParameters );
+void USART2_IRQHandler( void );
+
+#endif /* USER_STATS_H_ */
@@ -1,11 +1,39 @@
 #ifndef USER_TIM_H_
 #define USER_TIM_H_
 
+#define USER_TIM3_ARR					47999U//	1 kHz PWM at 48 MHz
+#define USER_TIM3_PERIOD_US				1000U
+#define USER_TIM3_COUNTS_PER_PERCENT	( ( USER_TIM3_ARR + 1U ) / 100U )
+#define USER_TIM3_COUNTS_PER_PERMILLE	( ( USER_TIM3_ARR + 1U ) / 1000U )
+
+/* Control loop timing, periods in microseconds measured with USER_Micros */
+typedef struct {
+	uint32_t last;
+	uint32_t min_period;
+	uint32_t max_period;
+	uint32_t max_jitter;
+	uint32_t count;
+} USER_Jitter_Stats_t;
+
+extern USER_Jitter_Stats_t USER_TIM3_Jitter;
+extern volatile uint32_t USER_TIM3_Update_Cycles;
+
 void USER_TIM3_PWM_Init( void );
 void update_cycle(uint8_t duty, uint8_t pin);
 uint16_t USER_Duty_Cycle( uint8_t duty );
+uint16_t USER_Duty_Cycle_Permille( uint16_t permille );
+void USER_TIM3_Set_Duty4( const uint16_t ccr[ 4 ] );
+void USER_TIM3_Attach_Control( void ( *hook )( void ) );
+void USER_TIM3_Jitter_Restart( void );
+void TIM3_IRQHandler( void );
 void USER_TIM14_Init(void);
-void USER_TIM14_Delay(uint16_t ms);
+uint32_t USER_Micros(void);
+void USER_TIM14_Advance(uint32_t us);
+uint32_t USER_Cycles_Since( uint32_t start );
+void USER_Delay_us(uint32_t us);
+void USER_TIM14_Attach_Compare( void ( *hook )( void ) );
+void USER_TIM14_Compare_In( uint16_t us );
+void TIM14_IRQHandler(void);
 void USER_TIM17_Init_Timer( void );
 
 #endif /* USER_TIM_H_ */
@@ -0,0 +1,83 @@
+#ifndef USER_TRACE_H_
+#define USER_TRACE_H_
+
+#include <stdint.h>
+
+/*
+ * Kernel event tracer. Included from the bottom of FreeRTOSConfig.h so the
+ * trace hook macros below replace the empty defaults of FreeRTOS.h.
+ * Set USER_TRACE_ENABLED to 0 to compile every hook out.
+ */
+#define USER_TRACE_ENABLED		1
+#define USER_TRACE_EVENTS		128U//	Ring depth, power of two, 8 bytes per event
+#define USER_TRACE_MAX_TASKS	8U
+/*
+ * Interrupts recorded by USER_TRACE_ISR_BEGIN/END, one bit per IRQ number.
+ * TIM3 (the 1 kHz control loop) is left out: its 2000 events/s would turn the
+ * ring over every 60 ms. Set USER_Trace_IRQ_Mask from the debugger to add it.
+ */
+#define USER_TRACE_IRQ_DEFAULT	( ~( 0x1UL << 16U ) )//	All but TIM3_IRQn
+
+/* Event types, 'id' and 'arg' meaning in the comment */
+#define USER_TRACE_TASK_IN			1U//	task number, priority
+#define USER_TRACE_ISR_ENTER		2U//	IRQ number, -
+#define USER_TRACE_ISR_EXIT			3U//	IRQ number, -
+#define USER_TRACE_QUEUE_SEND		4U//	queue type, queue address
+#define USER_TRACE_QUEUE_RECEIVE	5U//	queue type, queue address
+#define USER_TRACE_QUEUE_BLOCK_RX	6U//	queue type, queue address
+#define USER_TRACE_QUEUE_BLOCK_TX	7U//	queue type, queue address
+#define USER_TRACE_QUEUE_SEND_ISR	8U//	queue type, queue address
+#define USER_TRACE_NOTIFY_GIVE_ISR	9U//	notified task number, index
+#define USER_TRACE_NOTIFY_TAKE		10U//	-, index
+#define USER_TRACE_NOTIFY_BLOCK		11U//	-, index
+#define USER_TRACE_PRIO_INHERIT		12U//	mutex holder task number, new priority
+#define USER_TRACE_PRIO_DISINHERIT	13U//	mutex holder task number, restored priority
+#define USER_TRACE_DELAY			14U//	-, -
+#define USER_TRACE_TASK_OUT			15U//	task number, -
+
+typedef struct {
+	uint32_t time_us;
+	uint8_t type;
+	uint8_t id;
+	uint16_t arg;
+} USER_Trace_Event_t;
+
+extern volatile uint32_t USER_Trace_IRQ_Mask;
+
+void USER_Trace_Record( uint8_t type, uint8_t id, uint16_t arg );
+void USER_Trace_Task_Name( uint8_t id, const char *name );
+void USER_Trace_Dump( void );
+
+#if USER_TRACE_ENABLED
+
+#define USER_TRACE_ISR_BEGIN( irq )		do { if( USER_Trace_IRQ_Mask & ( 0x1UL << ( irq ) ) ) USER_Trace_Record( USER_TRACE_ISR_ENTER, ( irq ), 0U ); } while( 0 )
+#define USER_TRACE_ISR_END( irq )		do { if( USER_Trace_IRQ_Mask & ( 0x1UL << ( irq ) ) ) USER_Trace_Record( USER_TRACE_ISR_EXIT, ( irq ), 0U ); } while( 0 )
+
+/* Both edges of a context switch, so the time a task is preempted by an untraced interrupt stays with it */
+#define traceTASK_SWITCHED_OUT()	USER_Trace_Record( USER_TRACE_TASK_OUT, ( uint8_t )pxCurrentTCB->uxTCBNumber, 0U )
+#define traceTASK_SWITCHED_IN()		USER_Trace_Record( USER_TRACE_TASK_IN, ( uint8_t )pxCurrentTCB->uxTCBNumber, ( uint16_t )pxCurrentTCB->uxPriority )
+#define traceTASK_CREATE( pxNewTCB )	USER_Trace_Task_Name( ( uint8_t )( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->pcTaskName )
+#define traceTASK_DELAY()			USER_Trace_Record( USER_TRACE_DELAY, 0U, 0U )
+#define traceTASK_DELAY_UNTIL( xTimeToWake )	USER_Trace_Record( USER_TRACE_DELAY, 0U, 0U )
+
+#define traceQUEUE_SEND( pxQueue )					USER_Trace_Record( USER_TRACE_QUEUE_SEND, ( pxQueue )->ucQueueType, ( uint16_t )( uint32_t )( pxQueue ) )
+#define traceQUEUE_RECEIVE( pxQueue )				USER_Trace_Record( USER_TRACE_QUEUE_RECEIVE, ( pxQueue )->ucQueueType, ( uint16_t )( uint32_t )( pxQueue ) )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )	USER_Trace_Record( USER_TRACE_QUEUE_BLOCK_RX, ( pxQueue )->ucQueueType, ( uint16_t )( uint32_t )( pxQueue ) )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )		USER_Trace_Record( USER_TRACE_QUEUE_BLOCK_TX, ( pxQueue )->ucQueueType, ( uint16_t )( uint32_t )( pxQueue ) )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )			USER_Trace_Record( USER_TRACE_QUEUE_SEND_ISR, ( pxQueue )->ucQueueType, ( uint16_t )( uint32_t )( pxQueue ) )
+
+#define traceTASK_NOTIFY_GIVE_FROM_ISR( uxIndexToNotify )	USER_Trace_Record( USER_TRACE_NOTIFY_GIVE_ISR, ( uint8_t )pxTCB->uxTCBNumber, ( uint16_t )( uxIndexToNotify ) )
+#define traceTASK_NOTIFY_TAKE( uxIndexToWait )				USER_Trace_Record( USER_TRACE_NOTIFY_TAKE, 0U, ( uint16_t )( uxIndexToWait ) )
+#define traceTASK_NOTIFY_TAKE_BLOCK( uxIndexToWait )		USER_Trace_Record( USER_TRACE_NOTIFY_BLOCK, 0U, ( uint16_t )( uxIndexToWait ) )
+
+#define traceTASK_PRIORITY_INHERIT( pxTCBOfMutexHolder, uxInheritedPriority )	USER_Trace_Record( USER_TRACE_PRIO_INHERIT, ( uint8_t )( pxTCBOfMutexHolder )->uxTCBNumber, ( uint16_t )( uxInheritedPriority ) )
+#define traceTASK_PRIORITY_DISINHERIT( pxTCBOfMutexHolder, uxOriginalPriority )	USER_Trace_Record( USER_TRACE_PRIO_DISINHERIT, ( uint8_t )( pxTCBOfMutexHolder )->uxTCBNumber, ( uint16_t )( uxOriginalPriority ) )
+
+#else
+
+#define USER_TRACE_ISR_BEGIN( irq )
+#define USER_TRACE_ISR_END( irq )
+
+#endif
+
+#endif /* USER_TRACE_H_ */
@@ -1,9 +1,18 @@
 #ifndef USER_UART_H_
 #define USER_UART_H_
 
+#define USER_UART1_TX_SIZE	64U//	Transmit ring, power of two, a few frames
+
+extern volatile uint32_t USER_UART1_Tx_Dropped;
+
 void USER_UART1_Init( void );
 void USER_UART2_Init( void );
 void USER_UART1_Transmit( uint8_t *pData, uint16_t size );
+void USER_UART1_Set_Baud( uint32_t baud );
+uint16_t USER_UART1_Tx_Pending( void );
+uint8_t USER_UART1_Tx_Idle( void );
+void USER_UART1_Tx_Next( void );
+void USER_UART2_Transmit( uint8_t *pData, uint16_t size );
 
 
 #endif /* USER_UART_H_ */
@@ -3,50 +3,96 @@
 #include "adclib.h"
 #include "user_tim.h"
 
+/* Latest oversampled conversion of every scanned channel, written by DMA1 channel 1 */
+static volatile uint16_t USER_ADC_Buffer[ USER_ADC_CHANNELS ];
+static uint8_t USER_ADC_Suspended = 0;
+
 void USER_ADC_Init(void) {
-    // Habilitar reloj del ADC y del puerto GPIOA
+    // Habilitar reloj del ADC, del DMA y del puerto GPIOA
     RCC->IOPENR |= (1 << 0);     // GPIOAEN
     RCC->APBENR2 |= (1 << 20);   // ADCEN
+    RCC->AHBENR |= (1 << 0);     // DMA1EN (DMAMUX incluido)
 
-    // PA0 en modo analógico
-    GPIOA->MODER |= (0x3 << (0*2));   // Modo analógico
-    GPIOA->PUPDR &= ~(0x3 << (0*2));  // Sin pull-up/pull-down
+    // PA0 (potenciometro) y PA1 (entrada libre) en modo analógico
+    GPIOA->MODER |= (0x3 << (0*2)) | (0x3 << (1*2));  // Modo analógico
+    GPIOA->PUPDR &= ~((0x3 << (0*2)) | (0x3 << (1*2))); // Sin pull-up/pull-down
 
-    // Configurar CKMODE para reloj síncrono dividido entre 2
+    // Configurar CKMODE para reloj asíncrono (SYSCLK) dividido entre 2
     ADC1->CFGR2 &= ~(0x3 << 30);        // Borrar CKMODE
     //ADC1->CFGR2 |=  (0x1 << 30);        // CKMODE = 01: PCLK/2
 
     ADC->CCR &= ~(0xE << 18);
     ADC->CCR|=  (0x1 << 18);
+    ADC->CCR |= (1 << 22);              // VREFEN, canal interno VREFINT
 
     // Configurar resolución, alineación, modo de conversión
-    ADC1->CFGR1 &= ~(0x1 << 13); // Single conversion mode
+    ADC1->CFGR1 |= (0x1 << 13);  // Continuous conversion mode
+    ADC1->CFGR1 |= (0x1 << 12);  // Overrun: DR se sobreescribe con el dato nuevo
     ADC1->CFGR1 &= ~(0x1 << 5);  // Right alignment
     ADC1->CFGR1 &= ~(0x3 << 3);  // 12-bit resolution
 
-    // Tiempo de muestreo
-    ADC1->SMPR |= ~(0x7 << 0);   // Sampling time = shortest
+    // Sobremuestreo por hardware: 16 muestras, corrimiento de 4 bits -> promedio de 12 bits
+    ADC1->CFGR2 &= ~((0x7 << 2) | (0xF << 5) | (0x1 << 9));
+    ADC1->CFGR2 |=  (0x3 << 2) | (0x4 << 5) | (0x1 << 0);   // OVSR = 16x, OVSS = 4, OVSE
+
+    // Tiempo de muestreo: todos los canales usan SMP1 = 160.5 ciclos (VREFINT pide > 4 us)
+    ADC1->SMPR = (0x7 << 0);
 
-    ADC1->ISR &= ~( 0x1UL << 13U );
-    ADC1->CFGR1 &= ~( 0x1UL << 21U ) & ~( 0x1UL << 2U );
+    ADC1->ISR = ( 0x1UL << 13U );    // Limpiar CCRDY (se limpia escribiendo 1)
+    ADC1->CFGR1 &= ~( 0x1UL << 21U ) & ~( 0x1UL << 2U ); // CHSELR por bits, barrido ascendente
 
-    // Seleccionar canal 0 (PA0)
-    ADC1->CHSELR |= (1 << 0);
+    // Canales del barrido: IN0 (PA0), IN1 (PA1), IN10 (VREFINT)
+    ADC1->CHSELR = (1 << 0) | (1 << 1) | (1 << 10);
 
     while( !(ADC1->ISR & (0x1UL << 13U)));
 
     // Habilitar regulador interno
 
     ADC1->CR |= (1 << 28);       // ADVREGEN
-    USER_TIM14_Delay(1);
+    USER_Delay_us(20);           // tADCVREG_STUP = 20 us
 
-    // Calibración
+    // Calibración (DMAEN debe estar en 0)
     while (!USER_ADC_Calibration());
 
+    // DMA1 canal 1: ADC1->DR -> USER_ADC_Buffer, circular, 16 bits
+    DMAMUX1_Channel0->CCR = 5U;                  // DMAREQ_ID = ADC1 (DMAMUX canal 0 -> DMA1 canal 1)
+    DMA1_Channel1->CCR &= ~(1 << 0);             // Deshabilitar el canal para configurarlo
+    DMA1_Channel1->CPAR = (uint32_t)&ADC1->DR;
+    DMA1_Channel1->CMAR = (uint32_t)USER_ADC_Buffer;
+    DMA1_Channel1->CNDTR = USER_ADC_CHANNELS;
+    DMA1_Channel1->CCR = (0x1 << 10)             // MSIZE = 16 bits
+                       | (0x1 << 8)              // PSIZE = 16 bits
+                       | (0x1 << 7)              // Incremento en memoria
+                       | (0x1 << 5)              // Modo circular
+                       | (0x1 << 0);             // Canal habilitado
+    ADC1->CFGR1 |= (0x1 << 1) | (0x1 << 0);      // DMACFG circular, DMAEN
+
     // Habilitar ADC
     ADC1->CR |= (1 << 0);         // ADEN
-    for (uint32_t i = 0; i < 1000 && !(ADC1->ISR & (1 << 0)); i++) USER_TIM14_Delay(1); // Wait up to 1ms
+    uint32_t start = USER_Micros();
+    while (!(ADC1->ISR & (1 << 0)) && (USER_Micros() - start) < 1000); // Wait up to 1ms
     if (!(ADC1->ISR & (1 << 0))) return;  // Fail if ADRDY not set
+
+    // Conversión continua, el DMA mantiene USER_ADC_Buffer actualizado
+    ADC1->CR |= (1 << 2);         // ADSTART
+}
+
+// Detiene el barrido antes de STOP (user_power.c): sin reloj se congelaria a media secuencia
+void USER_ADC_Suspend(void) {
+    if (!(ADC1->CR & (1 << 2))) return;      // No hay conversión en curso
+    ADC1->CR |= (1 << 4);                    // ADSTP
+    while (ADC1->CR & (1 << 4));             // Esperar que termine la conversión actual
+    DMA1_Channel1->CCR &= ~(1 << 0);         // Deshabilitar el canal del DMA
+    USER_ADC_Suspended = 1;
+}
+
+// Reanuda el barrido desde el primer canal, con el DMA de nuevo al inicio del buffer
+void USER_ADC_Resume(void) {
+    if (!USER_ADC_Suspended) return;
+    USER_ADC_Suspended = 0;
+    DMA1_Channel1->CNDTR = USER_ADC_CHANNELS;
+    DMA1_Channel1->CCR |= (1 << 0);          // Canal habilitado
+    ADC1->CR |= (1 << 2);                    // ADSTART
 }
 
 uint8_t USER_ADC_Calibration(void) {
@@ -61,10 +107,18 @@ uint8_t USER_ADC_Calibration(void) {
 }
 
 uint16_t USER_ADC_Read(void) {
-    ADC1->CR |= (1 << 2);               // ADSTART
-    while (!(ADC1->ISR & (1 << 2)));    // Esperar EOC
-    if (ADC1->ISR & (1 << 4)) {         // Check for overrun error
-        ADC1->ISR |= (1 << 4);          // Clear overrun flag
-    }
-    return (uint16_t)(ADC1->DR);        // Leer valor convertido
+    return USER_ADC_Buffer[ USER_ADC_POT ];  // Último valor del potenciómetro, sin esperar
+}
+
+uint16_t USER_ADC_Get(uint8_t channel) {
+    if (channel >= USER_ADC_CHANNELS)
+        return 0;
+    return USER_ADC_Buffer[ channel ];
+}
+
+uint16_t USER_ADC_Get_VDDA_mV(void) {
+    uint16_t vrefint = USER_ADC_Buffer[ USER_ADC_VREFINT ];
+    if (vrefint == 0)
+        return 0;                            // Aún no hay conversión
+    return (uint16_t)(((uint32_t)USER_ADC_VREFINT_CAL_MV * (*USER_ADC_VREFINT_CAL)) / vrefint);
 }
@@ -2,9 +2,26 @@
 #include "main.h"
 #include "exti_func.h"
 
-void USER_EXTI1_Init( void ){
-//  EXTI->IMR1    |=  (  0x1UL <<  25U );//  Enable interrupt
-//  EXTI->EMR1    &=  ~(  0x1UL <<  25U );//  Disable event generation
-//  NVIC->IP[6]  &= ~( 0x00UL <<  3U );
-//  NVIC_ISER0 = (1UL << 27);
+/* PA7 (brake button) on EXTI line 7, both edges, handled in user_button.c */
+void USER_EXTI7_Init( void ){
+  EXTI->EXTICR[1] &= ~( 0xFFUL << 24U );//  EXTI7 source is port A
+  EXTI->RTSR1   |=  (  0x1UL <<  7U );//  Rising edge, press
+  EXTI->FTSR1   |=  (  0x1UL <<  7U );//  Falling edge, release
+  EXTI->RPR1     =  (  0x1UL <<  7U );//  Clear an edge seen before the init
+  EXTI->FPR1     =  (  0x1UL <<  7U );
+  EXTI->EMR1    &= ~(  0x1UL <<  7U );//  Disable event generation
+  EXTI->IMR1    |=  (  0x1UL <<  7U );//  Enable interrupt
+  NVIC_SetPriority( EXTI4_15_IRQn, 1 );//  Below the control loop
+  NVIC->ISER[0] =   (  0x1UL <<  7U );//  EXTI4_15 interrupt
+}
+
+/* Edges are ignored while masked, their pending flags are dropped on unmask */
+void USER_EXTI7_Mask( void ){
+  EXTI->IMR1    &= ~(  0x1UL <<  7U );
+}
+
+void USER_EXTI7_Unmask( void ){
+  EXTI->RPR1     =  (  0x1UL <<  7U );
+  EXTI->FPR1     =  (  0x1UL <<  7U );
+  EXTI->IMR1    |=  (  0x1UL <<  7U );
 }
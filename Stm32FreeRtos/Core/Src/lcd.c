@@ -1,7 +1,10 @@
 #include <stdint.h>
 #include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include "lcd.h"
-#include "user_tim.h"
+#include "user_trace.h"
+#include "user_fmt.h"
 
 //Caracter definido por usuario para cargar en la memoria CGRAM del LCD
 const int8_t UserFont[8][8] =
@@ -16,6 +19,26 @@ const int8_t UserFont[8][8] =
 		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }
 };
 
+//Framebuffer: contenido deseado (Frame) y copia de lo que hay en la DDRAM (Shadow)
+static char LCD_Frame[ LCD_LINES ][ LCD_COLUMNS ];
+static char LCD_Shadow[ LCD_LINES ][ LCD_COLUMNS ];
+//Direccion DDRAM actual del cursor, LCD_ADDRESS_UNKNOWN si no se conoce
+static uint8_t LCD_Address = LCD_ADDRESS_UNKNOWN;
+
+/*
+ * Cola de operaciones del motor de transferencia. La llenan las tareas
+ * (un solo productor) y la vacia la interrupcion de TIM16 (un solo consumidor)
+ */
+static volatile uint16_t LCD_Queue[ LCD_QUEUE_SIZE ];
+static volatile uint8_t LCD_Queue_Head = 0;//	Siguiente posicion a escribir
+static volatile uint8_t LCD_Queue_Tail = 0;//	Siguiente posicion a leer
+static volatile uint8_t LCD_Engine_Running = 0;
+static TaskHandle_t LCD_Notify_Task = NULL;
+
+static void LCD_Queue_Put(uint16_t op);
+static void LCD_Engine_Step(void);
+static void LCD_Write_Byte(uint8_t val);
+
 //Funcion que inicializa el LCD a 4 bits
 void LCD_Init(void){
 	int8_t const *p;
@@ -65,51 +88,49 @@ void LCD_Init(void){
 	GPIOB->MODER  &= ~( 0x2UL << 30U );
 	GPIOB->MODER  |=  ( 0x1UL << 30U );
 
+/**
+  * TIM16 como base de tiempo del motor de transferencia:
+  * 1 tick = 1 us, modo one-pulse, una interrupcion por operacion
+  */
+	RCC->APBENR2 |=  ( 0x1UL << 17U );//	TIM16 clock enabled
+	TIM16->CR1   &= ~( 0x1UL <<  7U )//	ARR no buffered, el retardo aplica de inmediato
+				 &  ~( 0x1UL <<  1U );//	UEV enabled
+	TIM16->CR1   |=  ( 0x1UL <<  3U )//	One-pulse mode
+				 |   ( 0x1UL <<  2U );//	Only counter overflow generates the interrupt
+	TIM16->PSC    =  47U;//				48 MHz / (47+1) = 1 MHz
+	TIM16->EGR   |=  ( 0x1UL <<  0U );//	Load PSC
+	TIM16->SR    &= ~( 0x1UL <<  0U );
+	TIM16->DIER  |=  ( 0x1UL <<  0U );//	Update interrupt enabled
+	NVIC_SetPriority( TIM16_IRQn, 3 );//	Lowest priority, the display can wait
+	NVIC->ISER[0] = ( 0x1UL << 21U );//	TIM16 interrupt
+
+	LCD_Queue_Head = 0;
+	LCD_Queue_Tail = 0;
+	LCD_Engine_Running = 0;
+
 /**
   * Inicialización del LCD
   * https://web.alfredstate.edu/faculty/weimandn/lcd/lcd_initialization/lcd_initialization_index.html
-  * Power ON
+  * Power ON. La secuencia se encola y la ejecuta TIM16 en segundo plano
   */
-	GPIOB->BSRR	 =	 LCD_RS_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_RW_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_EN_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D4_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D5_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
-	USER_TIM14_Delay(50);
+	GPIOB->BSRR	 =	 LCD_RS_PIN_LOW | LCD_RW_PIN_LOW | LCD_EN_PIN_LOW
+				 |	 LCD_D4_PIN_LOW | LCD_D5_PIN_LOW | LCD_D6_PIN_LOW | LCD_D7_PIN_LOW;
+	LCD_Queue_Put( LCD_OP_WAIT( 40000U ) );//	> 40 ms after Vcc rises to 2.7 V
 
 	/* Special case of 'Function Set'	*/
-	GPIOB->BSRR	 =	 LCD_D4_PIN_HIGH;
-	GPIOB->BSRR	 =	 LCD_D5_PIN_HIGH;
-	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
-	LCD_Pulse_EN( );
-	USER_TIM14_Delay(50);
+	LCD_Queue_Put( LCD_OP_NIBBLE | 0x03U );
+	LCD_Queue_Put( LCD_OP_WAIT( 4100U ) );//	> 4.1 ms
 
 	/* Special case of 'Function Set' */
-	GPIOB->BSRR	 =	 LCD_D4_PIN_HIGH;
-	GPIOB->BSRR	 =	 LCD_D5_PIN_HIGH;
-	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
-	LCD_Pulse_EN( );
-	USER_TIM14_Delay(50);
+	LCD_Queue_Put( LCD_OP_NIBBLE | 0x03U );
+	LCD_Queue_Put( LCD_OP_WAIT( 100U ) );//	> 100 us
 
 	/* Special case of 'Function Set' */
-	GPIOB->BSRR	 =	 LCD_D4_PIN_HIGH;
-	GPIOB->BSRR	 =	 LCD_D5_PIN_HIGH;
-	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
-	LCD_Pulse_EN( );
-	while( LCD_Busy( ) );
+	LCD_Queue_Put( LCD_OP_NIBBLE | 0x03U );
 
 	/* Initial 'Function Set' to change 4-bit mode	*/
-	GPIOB->BSRR	 =	 LCD_D4_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D5_PIN_HIGH;
-	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
-	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
-	LCD_Pulse_EN( );
-	while( LCD_Busy( ) );
+	LCD_Queue_Put( LCD_OP_NIBBLE | 0x02U );
+
 	/* 'Function Set' (I=1, N and F as required)	*/
 	LCD_Write_Cmd( 0x28U );
 	/* 'Display ON/OFF Control' (D=1, C=0, B=0)	*/
@@ -130,50 +151,58 @@ void LCD_Init(void){
 
 	/*	Set DDRAM address in address			*/
 	LCD_Write_Cmd( 0x80 );//
+
+	//La DDRAM quedo en blanco con 'Clear Display'
+	LCD_Frame_Clear( );
+	LCD_Frame_Invalidate( );
 }
 
-//Funcion que genera un strobe en el LCD
+//Funcion que coloca un nibble en D4-D7 con una sola escritura a BSRR
 void LCD_Out_Data4(uint8_t val){
-	if( ( val & 0x01U ) == 0x01U )
-		GPIOB->BSRR	=	LCD_D4_PIN_HIGH;
-	else
-		GPIOB->BSRR	=	LCD_D4_PIN_LOW;
-
-	if( ( val & 0x02U ) == 0x02U )
-		GPIOB->BSRR	=	LCD_D5_PIN_HIGH;
-	else
-		GPIOB->BSRR	=	LCD_D5_PIN_LOW;
-
-	if( ( val & 0x04U ) == 0x04U )
-		GPIOB->BSRR	=	LCD_D6_PIN_HIGH;
-	else
-		GPIOB->BSRR	=	LCD_D6_PIN_LOW;
-
-	if( ( val & 0x08U ) == 0x08U )
-		GPIOB->BSRR	=	LCD_D7_PIN_HIGH;
-	else
-		GPIOB->BSRR	=	LCD_D7_PIN_LOW;
+	GPIOB->BSRR	=	( (uint32_t)(  val & 0x0FU ) << 12U )//	Set de los bits en 1
+				|	( (uint32_t)( ~val & 0x0FU ) << 28U );//	Reset de los bits en 0
 }
 
-//Funcion que escribe 1 byte de datos en el LCD
-void LCD_Write_Byte(uint8_t val){
+//Funcion que escribe 1 byte en el LCD, RS debe estar ya seleccionado
+static void LCD_Write_Byte(uint8_t val){
 	LCD_Out_Data4( ( val >> 4 ) & 0x0FU );
 	LCD_Pulse_EN( );
 	LCD_Out_Data4( val & 0x0FU );
 	LCD_Pulse_EN( );
-	while( LCD_Busy( ) );
 }
 
-//Funcion que escribe un comando en el LCD
+//Funcion que encola un comando para el LCD
 void LCD_Write_Cmd(uint8_t val){
-	GPIOB->BSRR	=	LCD_RS_PIN_LOW;
-	LCD_Write_Byte( val );
+	LCD_Queue_Put( LCD_OP_CMD | val );
+
+	//Seguimiento de la direccion del cursor para el framebuffer
+	if( val & 0x80U )
+		LCD_Address = val & 0x7FU;//			'Set DDRAM address'
+	else if( val & 0x40U )
+		LCD_Address = LCD_ADDRESS_UNKNOWN;//	'Set CGRAM address'
+	else if( val & 0x20U )
+		;//										'Function Set'
+	else if( val & 0x10U )
+		LCD_Address = LCD_ADDRESS_UNKNOWN;//	'Cursor or Display Shift'
+	else if( ( val & 0xFEU ) == 0x02U )
+		LCD_Address = 0x00U;//					'Return Home'
+	else if( val == 0x01U )
+		LCD_Frame_Invalidate( );//				'Clear Display'
 }
 
-//Escribe un caracter ASCII en el LCD
+//Encola un caracter ASCII para el LCD
 void LCD_Put_Char(uint8_t c){
-	GPIOB->BSRR	=	LCD_RS_PIN_HIGH;
-	LCD_Write_Byte( c );
+	uint8_t line, column;
+
+	LCD_Queue_Put( LCD_OP_DATA | c );
+
+	if( LCD_Address == LCD_ADDRESS_UNKNOWN )
+		return;
+	line   = LCD_Address / 0x40U;
+	column = LCD_Address % 0x40U;
+	if( line < LCD_LINES && column < LCD_COLUMNS )
+		LCD_Shadow[ line ][ column ] = c;
+	LCD_Address++;
 }
 
 //Funcion que establece el cursor en una posicion de la pantalla del LCD
@@ -196,68 +225,20 @@ void LCD_Put_Str(char * str){
 //Funcion que envia un caracter numerico al LCD
 //El número debe ser entero y de 5 dígitos máximo
 void LCD_Put_Num(int16_t num){
-	int16_t p;
-	int16_t f = 0;
-	int8_t ch[ 5 ];
-
-	for( int16_t i = 0; i < 5; i++ ){
-		p = 1;
-		for( int16_t j = 4 - i; j > 0; j-- )
-			p = p * 10;
-		ch[ i ] = ( num / p );
-		if( num >= p && !f )
-			f = 1;
-		num = num - ch[ i ] * p;
-		ch[ i ] = ch[ i ] + 48;
-		if( f )
-			LCD_Put_Char( ch[ i ] );
-	}
-}
+	char str[ USER_FMT_INT_LEN ];
 
-//Funcion que provoca tiempos de espera en el LCD
-char LCD_Busy(void){
-/**
-  * Configuracion de D7 as input floating
-  */
-	GPIOB->PUPDR &= ~( 0x3UL << 30U );
-  GPIOB->MODER &= ~( 0x3UL << 30U );
-	GPIOB->BSRR	  =	 LCD_RS_PIN_LOW;
-	GPIOB->BSRR	  =	 LCD_RW_PIN_HIGH;
-	GPIOB->BSRR	  =	 LCD_EN_PIN_HIGH;
-	USER_TIM14_Delay(1);
-	if(( GPIOB->IDR	& LCD_D7_PIN_HIGH )) {
-		GPIOB->BSRR	=  LCD_EN_PIN_LOW;
-		GPIOB->BSRR	=	 LCD_RW_PIN_LOW;
-/**
-  * Configuracion de D7 as output push-pull
-  */
-		GPIOB->PUPDR  &= ~( 0x3UL << 30U );
-  	GPIOB->OTYPER &= ~( 0x1UL << 15U );
-  	GPIOB->MODER  &= ~( 0x2UL << 30U );
-  	GPIOB->MODER  |=  ( 0x1UL << 30U );
-		return 1;
-	} else {
-		GPIOB->BSRR	=  LCD_EN_PIN_LOW;
-		GPIOB->BSRR	=	 LCD_RW_PIN_LOW;
-/**
-  * Configuracion de D7 as output push-pull
-  */
-		GPIOB->PUPDR  &= ~( 0x3UL << 30U );
-  	GPIOB->OTYPER &= ~( 0x1UL << 15U );
-  	GPIOB->MODER  &= ~( 0x2UL << 30U );
-  	GPIOB->MODER  |=  ( 0x1UL << 30U );
-		return 0;
-	}
+	USER_Fmt_Int( str, num );//	Sin divisiones, tambien muestra el 0 y los negativos
+	LCD_Put_Str( str );
 }
 
-//Funcion que genera un pulso en el pin EN del LCD
+//Funcion que genera un pulso en el pin EN del LCD (PWeh > 450 ns, tcyc > 1 us)
 void LCD_Pulse_EN(void){
-	GPIOB->BSRR	=	LCD_EN_PIN_LOW;//
-	USER_TIM14_Delay(1);
 	GPIOB->BSRR	=	LCD_EN_PIN_HIGH;
-	USER_TIM14_Delay(1);
+	for( uint8_t i = 0; i < LCD_EN_PULSE_NOPS; i++ )
+		__NOP( );
 	GPIOB->BSRR	=	LCD_EN_PIN_LOW;
-	USER_TIM14_Delay(1);
+	for( uint8_t i = 0; i < LCD_EN_PULSE_NOPS; i++ )
+		__NOP( );
 }
 
 /*
@@ -295,3 +276,156 @@ void LCD_BarGraphicXY(int16_t pos_x, int16_t pos_y, int16_t value){
 		}
 	}
 }
+
+//Funcion que llena el framebuffer con espacios
+void LCD_Frame_Clear(void){
+	for( uint8_t i = 0; i < LCD_LINES; i++ )
+		for( uint8_t j = 0; j < LCD_COLUMNS; j++ )
+			LCD_Frame[ i ][ j ] = ' ';
+}
+
+//Funcion que escribe una cadena en el framebuffer, sin acceder al LCD
+//Minimum values for line and column must be 1
+void LCD_Frame_Put_Str(uint8_t line, uint8_t column, const char * str){
+	line--;
+	column--;
+	if( line >= LCD_LINES )
+		return;
+	for( ; column < LCD_COLUMNS && *str != 0; column++, str++ )
+		LCD_Frame[ line ][ column ] = *str;
+}
+
+//Funcion que marca la DDRAM como en blanco tras un 'Clear Display'
+void LCD_Frame_Invalidate(void){
+	for( uint8_t i = 0; i < LCD_LINES; i++ )
+		for( uint8_t j = 0; j < LCD_COLUMNS; j++ )
+			LCD_Shadow[ i ][ j ] = ' ';
+	LCD_Address = 0x00U;
+}
+
+/*
+ * Funcion que envia al LCD solo las celdas del framebuffer que cambiaron.
+ * El cursor solo se reposiciona cuando la siguiente celda a escribir no es
+ * la que sigue al ultimo caracter, aprovechando el auto-incremento del LCD.
+ * Regresa el numero de celdas escritas.
+ */
+uint8_t LCD_Frame_Flush(void){
+	uint8_t address;
+	uint8_t written = 0;
+
+	for( uint8_t i = 0; i < LCD_LINES; i++ ){
+		for( uint8_t j = 0; j < LCD_COLUMNS; j++ ){
+			if( LCD_Frame[ i ][ j ] == LCD_Shadow[ i ][ j ] )
+				continue;
+			address = ( i * 0x40U ) + j;
+			if( address != LCD_Address )
+				LCD_Write_Cmd( 0x80U + address );
+			LCD_Put_Char( LCD_Frame[ i ][ j ] );
+			written++;
+		}
+	}
+	return written;
+}
+
+//Funcion que indica si el motor ya envio todas las operaciones encoladas
+uint8_t LCD_Idle(void){
+	return !LCD_Engine_Running && LCD_Queue_Head == LCD_Queue_Tail;
+}
+
+/*
+ * Funcion que bloquea a la tarea que la llama hasta que el LCD termine de
+ * procesar la cola, usando la notificacion LCD_NOTIFY_INDEX de la tarea
+ */
+BaseType_t LCD_Wait_Idle(TickType_t xTicksToWait){
+	uint32_t primask;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	if( LCD_Idle( ) ){
+		__set_PRIMASK( primask );
+		return pdTRUE;
+	}
+	//Descartar una notificacion vieja de una espera que expiro
+	ulTaskNotifyValueClearIndexed( NULL, LCD_NOTIFY_INDEX, 0xFFFFFFFFUL );
+	LCD_Notify_Task = xTaskGetCurrentTaskHandle( );
+	__set_PRIMASK( primask );
+
+	return ulTaskNotifyTakeIndexed( LCD_NOTIFY_INDEX, pdTRUE, xTicksToWait ) != 0;
+}
+
+//Funcion que agrega una operacion a la cola y arranca el motor si estaba detenido
+static void LCD_Queue_Put(uint16_t op){
+	uint8_t next = ( LCD_Queue_Head + 1U ) & ( LCD_QUEUE_SIZE - 1U );
+	uint32_t primask;
+
+	//Cola llena: esperar a que la interrupcion libere espacio
+	while( next == LCD_Queue_Tail ){
+		if( xTaskGetSchedulerState( ) == taskSCHEDULER_RUNNING )
+			vTaskDelay( 1 );
+	}
+	LCD_Queue[ LCD_Queue_Head ] = op;
+	LCD_Queue_Head = next;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	if( !LCD_Engine_Running ){
+		LCD_Engine_Running = 1;
+		TIM16->CNT  = 0U;
+		TIM16->ARR  = 1U;
+		TIM16->CR1 |= ( 0x1UL << 0U );//	Start, overflow in 2 us
+	}
+	__set_PRIMASK( primask );
+}
+
+//Funcion que ejecuta la siguiente operacion de la cola y programa la espera posterior
+static void LCD_Engine_Step(void){
+	uint16_t op;
+	uint16_t wait;
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if( LCD_Queue_Head == LCD_Queue_Tail ){
+		LCD_Engine_Running = 0;
+		if( LCD_Notify_Task != NULL ){
+			vTaskNotifyGiveIndexedFromISR( LCD_Notify_Task, LCD_NOTIFY_INDEX, &xHigherPriorityTaskWoken );
+			LCD_Notify_Task = NULL;
+		}
+		portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+		return;
+	}
+	op = LCD_Queue[ LCD_Queue_Tail ];
+	LCD_Queue_Tail = ( LCD_Queue_Tail + 1U ) & ( LCD_QUEUE_SIZE - 1U );
+
+	switch( op & LCD_OP_MASK ){
+	case LCD_OP_CMD:
+		GPIOB->BSRR = LCD_RS_PIN_LOW;
+		LCD_Write_Byte( op & 0xFFU );
+		//'Clear Display' y 'Return Home' tardan 1.52 ms, el resto 37 us
+		wait = ( ( op & 0xFFU ) <= 0x03U ) ? LCD_WAIT_LONG_US : LCD_WAIT_SHORT_US;
+		break;
+	case LCD_OP_DATA:
+		GPIOB->BSRR = LCD_RS_PIN_HIGH;
+		LCD_Write_Byte( op & 0xFFU );
+		wait = LCD_WAIT_SHORT_US;
+		break;
+	case LCD_OP_NIBBLE:
+		GPIOB->BSRR = LCD_RS_PIN_LOW;
+		LCD_Out_Data4( op & 0x0FU );
+		LCD_Pulse_EN( );
+		wait = LCD_WAIT_SHORT_US;
+		break;
+	default://	LCD_OP_WAIT
+		wait = ( op & ~LCD_OP_MASK ) << 2U;
+		break;
+	}
+	TIM16->CNT  = 0U;
+	TIM16->ARR  = wait;
+	TIM16->CR1 |= ( 0x1UL << 0U );
+}
+
+//Interrupcion de TIM16: avanza la maquina de estados del LCD
+void TIM16_IRQHandler(void){
+	USER_TRACE_ISR_BEGIN( TIM16_IRQn );
+	TIM16->SR &= ~( 0x1UL << 0U );
+	LCD_Engine_Step( );
+	USER_TRACE_ISR_END( TIM16_IRQn );
+}
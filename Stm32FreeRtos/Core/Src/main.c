@@ -1,33 +1,70 @@
 /* **************** START *********************** */
 /* Libraries, Definitions and Global Declarations */
 #include <stdint.h>
-#include <stdio.h>
 #include <string.h>
-#include <stdlib.h>
 #include "main.h"
 #include "user_uart.h"
 #include "FreeRTOSConfig.h"
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
+#include "timers.h"
 #include "user_tim.h"
 #include "exti_func.h"
 #include "adclib.h"
 #include "lcd.h"
+#include "user_crc.h"
+#include "TractorLink.h"
+#include "user_link.h"
+#include "user_fmt.h"
+#include "user_jobs.h"
+#include "user_prof.h"
+#include "user_power.h"
+#include "user_button.h"
+#include "user_pool.h"
+#include "user_stats.h"
 
 #define configUSE_PREEMPTION  1
 
-#define BUFFER_SIZE 8
-
-char buffer_str[8];
 char buffer_vel[8];
 char buffer_rpm[8];
 char buffer_gear[8];
-// char test_buffer[] = "112.561";
 int velocity = 0;
-int index_k = 0;
+
+/* ESP32 link (USART1), binary frames defined in TractorLink.h, handled by user_link.c */
+TractorLink_Msg_t link_msg;
+
+/*
+ * Decoded STATE messages live in pool blocks. The ISR unpacks the frame into
+ * link_msg, decodes it into a block and sends its pointer to the display job
+ * through State_Queue, the reference moves with the pointer. The stats task
+ * takes a second reference for its LINK line (USER_Stats_Post_State). Each
+ * consumer keeps its newest block and releases the older ones. Blocks: the
+ * display's, two queued, the reporter's, one in its mailbox and the one the
+ * ISR is filling.
+ */
+#define STATE_QUEUE_LENGTH	2U
+USER_POOL_DEFINE(State_Pool, "state", TractorLink_State_t, 6);
+static StaticQueue_t State_Queue_Buffer;
+static uint8_t State_Queue_Storage[STATE_QUEUE_LENGTH * sizeof(TractorLink_State_t *)];
+static QueueHandle_t State_Queue = NULL;
+volatile uint32_t state_dropped = 0;//	Decoded states released with the queue full
 
 uint8_t button_status = 0;
 uint16_t val;
+uint32_t val_us;//	USER_Micros when 'val' was sampled, for the latency traces
+
+/* UART velocity field to PWM update latency, in microseconds */
+typedef struct {
+	uint32_t last;
+	uint32_t min;
+	uint32_t max;
+	uint32_t count;
+} Latency_Stats_t;
+
+volatile uint32_t velocity_rx_us = 0;
+volatile uint8_t velocity_pending = 0;
+Latency_Stats_t pwm_latency = { 0, UINT32_MAX, 0, 0 };
 
 
 void USER_RCC_Init( void );
@@ -35,15 +72,27 @@ void System_init(void);
 void USER_GPIO_Init(void);
 void USART1_IRQHandler(void);
 
-TaskHandle_t Task1Handle;
-TaskHandle_t Task2Handle;
-TaskHandle_t Task3Handle;
-TaskHandle_t Task4Handle;
+void Job_Sample( void );
+void Job_Display( void );
+void Job_Emit( void );
+void Control_Loop( void );
 
-void StartTask1( void *pvParameters );
-void StartTask2( void *pvParameters );
-void StartTask3( void *pvParameters );
-void StartTask4( void *pvParameters );
+/*
+ * Periodic work, run by the worker of user_jobs.c. Priorities follow from the
+ * periods (rate-monotonic), the phases keep the jobs from piling up on the
+ * same tick. Budgets are the worst case seen plus margin. Emit only queues
+ * its frame, the USART1 interrupt sends it. At 9600 baud one frame outlasts
+ * the period and only one call in USER_LINK_SLOW_EVERY sends, main checks
+ * that this keeps up with the line.
+ * Everything lives in .bss, the FreeRTOS heap is not used at run time.
+ */
+USER_Job_t Jobs[] = {
+	/* name      run          period ms  phase ms  deadline us  WCET us */
+	{ "Sample",  Job_Sample,  6,         0,        2000,        100 },
+	{ "Emit",    Job_Emit,    6,         1,        6000,        1000 },
+	{ "Display", Job_Display, 50,        3,        20000,       500 },
+};
+#define JOBS_COUNT	( sizeof( Jobs ) / sizeof( Jobs[0] ) )
 /* Superloop structure */
 int main(void)
 {
@@ -51,11 +100,14 @@ int main(void)
 	HAL_Init();
 	System_init();
 
-	/* Create a task with a priority of 0 (idle), 1 (belowNormal), 2 (Normal), 3 (High), 4 (VeryHigh) */
-	xTaskCreate(StartTask1, "Task1", 128, NULL, 1, &Task1Handle);
-	xTaskCreate(StartTask2, "Task2", 128, NULL, 3, &Task2Handle);
-	xTaskCreate(StartTask3, "Task3", 128, NULL, 2, &Task3Handle);
-	xTaskCreate(StartTask4, "Task4", 128, NULL, 4, &Task4Handle);
+	for (uint8_t i = 0; i < JOBS_COUNT; i++)
+		if (Jobs[i].run == Job_Emit)
+			configASSERT(USER_LINK_WIRE_US(USER_LINK_INPUT_FRAME, TL_BAUD_DEFAULT)
+						 < USER_LINK_SLOW_EVERY * Jobs[i].period_ms * 1000UL);
+
+	/* Priorities: 0 (idle), 1 (Stats), 2 (Jobs worker) */
+	USER_Jobs_Init(Jobs, JOBS_COUNT, tskIDLE_PRIORITY + 2);
+	USER_Stats_Init(tskIDLE_PRIORITY + 1);
 
 	vTaskStartScheduler();
 
@@ -67,120 +119,156 @@ int main(void)
 
 }
 
-// Task1 function
-void StartTask1(void *pvParameters) {
+// Sample job: reads the pedal (ADC), the brake button arrives as events (user_button.c)
+void Job_Sample(void) {
+	PROF_BEGIN(PROF_ADC);
+	val_us = USER_Micros();
+	val = USER_ADC_Read();
+	PROF_END(PROF_ADC);
+}
 
-  /* Infinite loop */
-  for(;;) {
+// Display job: redraws the LCD with the latest state from the ESP32
+void Job_Display(void) {
+	static const TractorLink_State_t no_state = { 0, 0, 0 };
+	static TractorLink_State_t *state = NULL;//	Newest block received, held until a newer one arrives
+	TractorLink_State_t *next;
+	const TractorLink_State_t *shown;
 
-	  val = USER_ADC_Read();
-	  if (GPIOA->IDR & (0x1UL << 7U))
-				{
-					button_status = 1;
-				}
-				else
-				{
-					button_status = 0;
-				}
-	  vTaskDelay(6); //1
-  }
-}
+	PROF_BEGIN(PROF_LCD);
+	while (xQueueReceive(State_Queue, &next, 0) == pdPASS)
+	{
+		if (state != NULL)
+			USER_Pool_Release(&State_Pool, state);
+		state = next;
+	}
+	shown = (state != NULL) ? state : &no_state;//	Zeros until the ESP32 sends its first state
+	USER_Fmt_Fixed(buffer_vel, shown->velocity_x100, 2);
+	USER_Fmt_Uint(buffer_rpm, shown->rpm);
+	USER_Fmt_Uint(buffer_gear, shown->gear);
 
-void StartTask2(void *pvParameters) {
- //vTaskDelay(100);
-	vTaskDelay(2);
-  /* Infinite loop */
-  for(;;) {
-
-		LCD_Set_Cursor(1, 1);
-		LCD_Put_Str("Vel:       G:  ");
-		LCD_Set_Cursor(1, 5);
-		LCD_Put_Str(buffer_vel);
-		LCD_Set_Cursor(1, 14);
-		LCD_Put_Str(buffer_gear);
-		LCD_Set_Cursor(2, 1);
-		LCD_Put_Str("RPM:       ");
-		LCD_Set_Cursor(2, 5);
-		LCD_Put_Str(buffer_rpm);
-		vTaskDelay(6); //3
-  }
+	/* Compose the screen in RAM, only the changed cells reach the LCD */
+	LCD_Frame_Put_Str(1, 1, "Vel:       G:  ");
+	LCD_Frame_Put_Str(1, 5, buffer_vel);
+	LCD_Frame_Put_Str(1, 14, buffer_gear);
+	LCD_Frame_Put_Str(2, 1, "RPM:            ");
+	LCD_Frame_Put_Str(2, 5, buffer_rpm);
+	LCD_Frame_Flush();
+	PROF_END(PROF_LCD);
 }
 
-void StartTask3(void *pvParameters) {
+// Emit job: sends the latest sample to the ESP32
+void Job_Emit(void) {
+	TractorLink_Input_t input = { 0 };
+	USER_Button_Event_t event;
 
-	vTaskDelay(1);
-  /* Infinite loop */
-  for(;;) {
-	  printf("{adc: %u, button: %u}\n", val, button_status);
-	  vTaskDelay(6); //1
-  }
+	/* A press lasts at least the debounce window, longer than the period, so every one reaches a frame */
+	while (USER_Button_Get(&event, 0))
+		button_status = event.pressed;
+
+	input.adc = val;
+	input.button = button_status;
+	USER_Link_Send_Input(&input, val_us);
 }
 
-void StartTask4(void *pvParameters) {
-  /* Infinite loop */
- vTaskDelay(5);
-  for(;;) {
-	  //printf("Task4, enter \r\n");
-	  if(velocity > 50 ){
-	  		velocity = 50;
-	  	}
-	  		update_cycle(velocity,1);
-	  		update_cycle(velocity,2);
-	  		update_cycle(velocity,3);
-	  		update_cycle(velocity,4);
-	  vTaskDelay(5); //1
+// Control loop, runs in the TIM3 update interrupt once per PWM period
+USER_RAMFUNC void Control_Loop(void) {
+  int setpoint;
+  uint16_t duty;
+  uint16_t ccr[4];
+  uint32_t latency;
+
+  if (!velocity_pending)
+	  return;
+  velocity_pending = 0;
+
+  setpoint = velocity;
+  if(setpoint > 50 ){
+	  setpoint = 50;
+  }
+  if(setpoint < 0 ){
+	  setpoint = 0;
   }
+  duty = USER_Duty_Cycle_Permille(setpoint * 10);
+  ccr[0] = duty;
+  ccr[1] = duty;
+  ccr[2] = duty;
+  ccr[3] = duty;
+  USER_TIM3_Set_Duty4(ccr);
+
+  latency = USER_Micros() - velocity_rx_us;
+  pwm_latency.last = latency;
+  if (latency < pwm_latency.min) pwm_latency.min = latency;
+  if (latency > pwm_latency.max) pwm_latency.max = latency;
+  pwm_latency.count++;
 }
 
 void System_init(void){
 	USER_RCC_Init();
+	USER_Prof_Init();
+	USER_CRC_Init();
+	USER_Link_Init();
+	USER_Pool_Init(&State_Pool);
 	USER_UART1_Init();
 	USER_UART2_Init();
 	USER_GPIO_Init();
 	USER_TIM14_Init();
+	USER_Power_Init();
 	USER_TIM3_PWM_Init( );
+	USER_TIM3_Attach_Control( Control_Loop );
 	USER_ADC_Init();
     LCD_Init();
 	LCD_Clear();
+	/* Queues last: before the scheduler the kernel critical section leaves PRIMASK set */
+	USER_Button_Init();
+	State_Queue = xQueueCreateStatic(STATE_QUEUE_LENGTH, sizeof(TractorLink_State_t *),
+									 State_Queue_Storage, &State_Queue_Buffer);
 }
 
 
-void USART1_IRQHandler(void) {
+USER_RAMFUNC void USART1_IRQHandler(void) {
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	PROF_BEGIN(PROF_USART1);
+	USER_TRACE_ISR_BEGIN(USART1_IRQn);
+	if (USART1->ISR & (0x7UL << 1U))
+		{ // framing, noise or overrun error, the link falls back to a safe rate if they persist
+			USART1->ICR = (0x7UL << 1U);
+			USER_Link_Rx_Error();
+		}
+	if ((USART1->CR1 & (0x1UL << 7U)) && (USART1->ISR & (0x1UL << 7U)))
+		{ // transmit data register empty, next byte of the link frame
+			USER_UART1_Tx_Next();
+		}
 	if ((USART1->ISR & (0x1UL << 5U)))
 		{ // wait until a data is received (ISR register)
-			char received = USART1->RDR;
-			if (received == 'V')
+			uint8_t received = USART1->RDR;
+			TractorLink_State_t *state;
+			if (USER_Link_Rx_Byte(received, &link_msg))
 			{
-				velocity = atoi(buffer_str);
-				memcpy(buffer_vel, buffer_str, sizeof(buffer_str));
-				memset(buffer_str, 0, sizeof(buffer_str));
-				index_k = 0;
-			}
-			else if (received == 'S')
+				state = USER_Pool_Alloc(&State_Pool);
+				if (state != NULL && TractorLink_Decode_State(&link_msg, state) == TL_OK)
+				{
+					velocity = state->velocity_x100 / 100;
+					/* The PWM only needs the velocity, the control loop picks it up next period */
+					velocity_rx_us = USER_Micros();
+					velocity_pending = 1;
+					USER_Stats_Post_State(&State_Pool, state, &xHigherPriorityTaskWoken);
+					/* No queue before the end of System_init, and a full one means the display is behind */
+					if (State_Queue == NULL || xQueueSendFromISR(State_Queue, &state, &xHigherPriorityTaskWoken) != pdPASS)
 					{
-						memcpy(buffer_rpm, buffer_str, sizeof(buffer_str));
-						memset(buffer_str, 0, sizeof(buffer_str));
-						index_k = 0;
+						USER_Pool_Release(&State_Pool, state);
+						state_dropped++;
 					}
-			else if (received == 'E')
-							{
-								memcpy(buffer_gear, buffer_str, sizeof(buffer_str));
-								memset(buffer_str, 0, sizeof(buffer_str));
-								index_k = 0;
-							}
-			else
-			{
-				if (index_k < BUFFER_SIZE - 1)
-				{
-					buffer_str[index_k++] = received;
 				}
-				else
+				else if (state != NULL)
 				{
-					memset(buffer_str, 0, sizeof(buffer_str));
-					index_k = 0;
+					USER_Pool_Release(&State_Pool, state);
 				}
 			}
 		}
+	USER_TRACE_ISR_END(USART1_IRQn);
+	PROF_END(PROF_USART1);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 void USER_GPIO_Init(void)
@@ -203,6 +291,8 @@ void USER_RCC_Init( void ){
 	FLASH->ACR	&= ~( 0x6UL <<  0U );// 2 HCLK cycles latency, if SYSCLK >=24MHz <=48MHz
 	FLASH->ACR	|=  ( 0x1UL <<  0U );// 2 HCLK cycles latency, if SYSCLK >=24MHz <=48MHz
 	while(( FLASH->ACR & ( 0x7UL <<  0U )) != 0x001UL );// wait until LATENCY[2:0]=001
+	FLASH->ACR	|=  ( 0x1UL <<  9U )// instruction cache, hides the wait state on loops
+				|   ( 0x1UL <<  8U );// prefetch, hides it on straight-line code
 	RCC->CR		&= ~( 0x7UL << 11U );// select HSISYS division factor by 1
 	while(!( RCC->CR & ( 0x1UL << 10U )));// wait until HSISYS is stable and ready
 	RCC->CFGR	&= ~( 0x7UL <<  0U );// select HSISYS as the SYSCLK clock source
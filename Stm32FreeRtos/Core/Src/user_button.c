@@ -0,0 +1,90 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "user_tim.h"
+#include "exti_func.h"
+#include "user_trace.h"
+#include "user_button.h"
+
+/*
+ * Brake button on PA7, interrupt driven with a leading-edge debounce. The
+ * first edge is published at once with its USER_Micros timestamp, then EXTI7
+ * stays masked for USER_BUTTON_DEBOUNCE_US, timed by the TIM14 channel 1
+ * compare. When the window ends the pin is read again: a level that changed
+ * back meanwhile is published as a new edge and starts another window.
+ *
+ * Every edge goes to a queue read with USER_Button_Get. The queue has a single
+ * reader, other code only needs the level from USER_Button_Pressed.
+ */
+
+volatile uint32_t USER_Button_Dropped = 0;
+
+static StaticQueue_t USER_Button_Queue_Buffer;
+static uint8_t USER_Button_Queue_Storage[ USER_BUTTON_QUEUE_LENGTH * sizeof( USER_Button_Event_t ) ];
+static QueueHandle_t USER_Button_Queue;
+static volatile uint8_t USER_Button_Level = 0;//	Last published level
+
+static uint8_t USER_Button_Read( void ){
+	return ( GPIOA->IDR >> 7U ) & 0x1U;
+}
+
+static void USER_Button_Publish( uint8_t pressed, uint32_t time, BaseType_t *xHigherPriorityTaskWoken ){
+	USER_Button_Event_t event;
+
+	event.time_us = time;
+	event.pressed = pressed;
+	USER_Button_Level = pressed;
+	if( xQueueSendFromISR( USER_Button_Queue, &event, xHigherPriorityTaskWoken ) != pdPASS )
+		USER_Button_Dropped++;
+}
+
+/* End of the debounce window, from the TIM14 interrupt */
+static void USER_Button_Settled( void ){
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	uint8_t level = USER_Button_Read( );
+
+	if( level != USER_Button_Level ){
+		/* Released or pressed again inside the window, late by at most the window */
+		USER_Button_Publish( level, USER_Micros( ), &xHigherPriorityTaskWoken );
+		USER_TIM14_Compare_In( USER_BUTTON_DEBOUNCE_US );
+	} else {
+		USER_EXTI7_Unmask( );
+	}
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+void USER_Button_Init( void ){
+	USER_Button_Queue = xQueueCreateStatic( USER_BUTTON_QUEUE_LENGTH, sizeof( USER_Button_Event_t ),
+											USER_Button_Queue_Storage, &USER_Button_Queue_Buffer );
+	USER_Button_Level = USER_Button_Read( );
+	USER_TIM14_Attach_Compare( USER_Button_Settled );
+	USER_EXTI7_Init( );
+}
+
+void EXTI4_15_IRQHandler( void ){
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+	uint32_t now = USER_Micros( );
+	uint8_t level;
+
+	USER_TRACE_ISR_BEGIN( EXTI4_15_IRQn );
+	EXTI->RPR1 = ( 0x1UL << 7U );
+	EXTI->FPR1 = ( 0x1UL << 7U );
+	level = USER_Button_Read( );
+	if( level != USER_Button_Level )
+		USER_Button_Publish( level, now, &xHigherPriorityTaskWoken );
+	USER_EXTI7_Mask( );
+	USER_TIM14_Compare_In( USER_BUTTON_DEBOUNCE_US );
+	USER_TRACE_ISR_END( EXTI4_15_IRQn );
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+/* Debounced level, 1 while pressed */
+uint8_t USER_Button_Pressed( void ){
+	return USER_Button_Level;
+}
+
+/* Next edge, pdFALSE if none arrived within xTicksToWait */
+BaseType_t USER_Button_Get( USER_Button_Event_t *event, TickType_t xTicksToWait ){
+	return xQueueReceive( USER_Button_Queue, event, xTicksToWait );
+}
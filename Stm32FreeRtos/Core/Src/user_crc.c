@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include "main.h"
+#include "user_crc.h"
+#include "TractorLink.h"
+
+/* CRC-16/CCITT-FALSE on the hardware CRC unit: 16-bit polynomial 0x1021, init 0xFFFF, no reflection */
+void USER_CRC_Init( void ){
+	RCC->AHBENR	|=  ( 0x1UL << 12U );//	CRC clock enabled
+	CRC->CR		 =  ( 0x1UL <<  3U );//	16-bit polynomial, input and output not reversed
+	CRC->POL	 =  0x1021U;
+	CRC->INIT	 =  0xFFFFU;
+}
+
+/* TractorLink.c leaves this one out on the STM32 (TL_HW_CRC). Used from tasks and the UART ISR */
+USER_RAMFUNC uint16_t TractorLink_Crc16( const uint8_t *data, size_t length ){
+	uint32_t primask;
+	uint16_t crc;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	CRC->CR		|=  ( 0x1UL <<  0U );//	Reload INIT into the data register
+	while( length-- )
+		*( __IO uint8_t * )&CRC->DR = *data++;//	Byte writes feed 8 bits at a time
+	crc = ( uint16_t )CRC->DR;
+	__set_PRIMASK( primask );
+
+	return crc;
+}
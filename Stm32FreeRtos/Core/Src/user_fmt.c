@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include "user_fmt.h"
+
+/* n / 10 with shifts and adds, exact for every 32-bit n (Hacker's Delight divu10) */
+static uint32_t USER_Fmt_Div10( uint32_t n, uint32_t *remainder ){
+	uint32_t q;
+	uint32_t r;
+
+	q  = ( n >> 1U ) + ( n >> 2U );
+	q += q >> 4U;
+	q += q >> 8U;
+	q += q >> 16U;
+	q >>= 3U;
+	r  = n - ( ( q << 3U ) + ( q << 1U ) );
+	if( r > 9U ){
+		q++;
+		r -= 10U;
+	}
+	*remainder = r;
+	return q;
+}
+
+/* Decimal digits of 'value', least significant first, returns how many */
+static uint8_t USER_Fmt_Digits( char *digits, uint32_t value ){
+	uint8_t count = 0;
+	uint32_t remainder;
+
+	do {
+		value = USER_Fmt_Div10( value, &remainder );
+		digits[ count++ ] = ( char )( '0' + remainder );
+	} while( value );
+	return count;
+}
+
+char *USER_Fmt_Char( char *dst, char c ){
+	*dst++ = c;
+	*dst = '\0';
+	return dst;
+}
+
+char *USER_Fmt_Str( char *dst, const char *src ){
+	while( *src )
+		*dst++ = *src++;
+	*dst = '\0';
+	return dst;
+}
+
+char *USER_Fmt_Uint( char *dst, uint32_t value ){
+	char digits[ 10 ];
+	uint8_t count;
+
+	count = USER_Fmt_Digits( digits, value );
+	while( count )
+		*dst++ = digits[ --count ];
+	*dst = '\0';
+	return dst;
+}
+
+char *USER_Fmt_Int( char *dst, int32_t value ){
+	if( value < 0 ){
+		*dst++ = '-';
+		return USER_Fmt_Uint( dst, 0U - ( uint32_t )value );
+	}
+	return USER_Fmt_Uint( dst, ( uint32_t )value );
+}
+
+/* Exactly 'digits' hexadecimal digits (1 to 8), lower case, zero padded */
+char *USER_Fmt_Hex( char *dst, uint32_t value, uint8_t digits ){
+	static const char hex[ 16 ] = "0123456789abcdef";
+
+	while( digits-- )
+		*dst++ = hex[ ( value >> ( digits * 4U ) ) & 0xFU ];
+	*dst = '\0';
+	return dst;
+}
+
+/* 'value' holds the number times 10^decimals: ( 1234, 2 ) -> "12.34", ( -5, 2 ) -> "-0.05" */
+char *USER_Fmt_Fixed( char *dst, int32_t value, uint8_t decimals ){
+	char digits[ 10 ];
+	uint8_t count;
+	uint8_t zeros;
+	uint32_t magnitude = ( uint32_t )value;
+
+	if( value < 0 ){
+		*dst++ = '-';
+		magnitude = 0U - magnitude;
+	}
+	count = USER_Fmt_Digits( digits, magnitude );
+	if( count <= decimals ){
+		/* Below one: "0." and the zeros between the point and the first digit */
+		*dst++ = '0';
+		*dst++ = '.';
+		for( zeros = decimals - count; zeros; zeros-- )
+			*dst++ = '0';
+	}
+	while( count ){
+		*dst++ = digits[ --count ];
+		if( count && count == decimals )
+			*dst++ = '.';
+	}
+	*dst = '\0';
+	return dst;
+}
@@ -0,0 +1,198 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "user_tim.h"
+#include "user_jobs.h"
+
+/*
+ * Rate-monotonic periodic jobs. USER_Jobs_Init sorts the table by period
+ * (deadline, then table order, break ties), the position is the job priority.
+ * Every job gets an auto-reload software timer. Its callback, in the timer
+ * service task, only marks the job released and wakes the worker task. The
+ * kernel reloads the timers from their previous expiry, so releases stay on
+ * phase + k * period and never drift with the execution time. The timer
+ * service task runs above the worker, a long job cannot hold a release back.
+ *
+ * Whenever the worker is free it runs the highest priority released job, a
+ * lower priority job can delay it by at most one run (non-preemptive, all
+ * jobs share one stack). The Liu and Layland bound does not hold for that
+ * blocking, USER_Jobs_Init checks the declared set with a non-preemptive
+ * response-time test instead.
+ *
+ * Every run is checked against the job's WCET budget and deadline, the counts
+ * go out on the debug UART with the STATS report (user_stats.c).
+ */
+
+static StaticTask_t USER_Jobs_TCB;
+static StackType_t USER_Jobs_Stack[ USER_JOBS_STACK_DEPTH ];
+static USER_Job_t *USER_Jobs;
+static uint8_t USER_Jobs_Count;
+static uint32_t USER_Jobs_Load;//	Sum of wcet / period, permille
+static uint8_t USER_Jobs_Fit;//		Every job passed the response-time test
+static TaskHandle_t USER_Jobs_Handle;
+static uint32_t USER_Jobs_Released;//	One bit per job, index = priority, set by the timers
+
+static uint8_t USER_Jobs_Before( const USER_Job_t *a, const USER_Job_t *b ){
+	if( a->period_ms != b->period_ms )
+		return a->period_ms < b->period_ms;
+	return a->deadline_us < b->deadline_us;
+}
+
+/*
+ * Worst-case response of a job under non-preemptive fixed priorities, 0 when
+ * it exceeds the deadline. The job waits for the longest lower priority run
+ * that may have just started (blocking), then for every higher priority
+ * release up to and including its own start, then runs for its WCET.
+ * Deadlines are at most the period, so one run per job is enough.
+ */
+static uint32_t USER_Jobs_Response( const USER_Job_t *jobs, uint8_t count, uint8_t index ){
+	uint32_t blocking = 0;
+	uint32_t start;
+	uint32_t previous;
+	uint8_t j;
+
+	for( j = index + 1U; j < count; j++ )
+		if( jobs[ j ].wcet_us > blocking )
+			blocking = jobs[ j ].wcet_us;
+
+	start = blocking;
+	do {
+		previous = start;
+		start = blocking;
+		for( j = 0; j < index; j++ )
+			start += ( previous / ( jobs[ j ].period_ms * 1000UL ) + 1U ) * jobs[ j ].wcet_us;
+		if( start + jobs[ index ].wcet_us > jobs[ index ].deadline_us )
+			return 0;
+	} while( start != previous );
+
+	return start + jobs[ index ].wcet_us;
+}
+
+/* Timer service task context, the timer ID is the job index */
+static void USER_Jobs_Release( TimerHandle_t timer ){
+	uint32_t index = ( uint32_t )( uintptr_t )pvTimerGetTimerID( timer );
+	USER_Job_t *job = &USER_Jobs[ index ];
+
+	/* The first expiry was the phase, the timer runs at the period from here on */
+	if( xTimerGetPeriod( timer ) != pdMS_TO_TICKS( job->period_ms ) )
+		xTimerChangePeriod( timer, pdMS_TO_TICKS( job->period_ms ), 0 );
+
+	taskENTER_CRITICAL( );
+	if( USER_Jobs_Released & ( 0x1UL << index ) )
+		job->skipped++;//	The previous release has not run yet, this one merges into it
+	USER_Jobs_Released |= ( 0x1UL << index );
+	job->release = xTaskGetTickCount( );
+	taskEXIT_CRITICAL( );
+	xTaskNotifyGive( USER_Jobs_Handle );
+}
+
+void USER_Jobs_Init( USER_Job_t *jobs, uint8_t count, UBaseType_t priority ){
+	TickType_t first;
+	USER_Job_t job;
+	uint8_t i;
+	uint8_t j;
+
+	configASSERT( count > 0 && count <= USER_JOBS_MAX );
+	configASSERT( priority < configTIMER_TASK_PRIORITY );
+
+	/* Insertion sort, stable so equal jobs keep the table order */
+	for( i = 1; i < count; i++ ){
+		job = jobs[ i ];
+		for( j = i; j > 0 && USER_Jobs_Before( &job, &jobs[ j - 1 ] ); j-- )
+			jobs[ j ] = jobs[ j - 1 ];
+		jobs[ j ] = job;
+	}
+
+	USER_Jobs_Load = 0;
+	for( i = 0; i < count; i++ ){
+		jobs[ i ].priority = i;
+		USER_Jobs_Load += ( jobs[ i ].wcet_us + jobs[ i ].period_ms - 1U ) / jobs[ i ].period_ms;//	us per ms is permille
+		configASSERT( jobs[ i ].period_ms > 0 );
+		configASSERT( jobs[ i ].wcet_us <= jobs[ i ].deadline_us );
+		configASSERT( jobs[ i ].deadline_us <= jobs[ i ].period_ms * 1000UL );
+	}
+	/* Above 100 % the set never fits, below it the blocking can still break a deadline */
+	configASSERT( USER_Jobs_Load <= 1000U );
+	USER_Jobs_Fit = 1;
+	for( i = 0; i < count; i++ )
+		if( USER_Jobs_Response( jobs, count, i ) == 0 )
+			USER_Jobs_Fit = 0;
+
+	USER_Jobs = jobs;
+	USER_Jobs_Count = count;
+	USER_Jobs_Handle = xTaskCreateStatic( USER_Jobs_Worker, "Jobs", USER_JOBS_STACK_DEPTH, NULL, priority,
+										  USER_Jobs_Stack, &USER_Jobs_TCB );
+
+	/* Queued on the timer command queue, they start counting with the scheduler */
+	for( i = 0; i < count; i++ ){
+		first = pdMS_TO_TICKS( jobs[ i ].phase_ms ? jobs[ i ].phase_ms : jobs[ i ].period_ms );
+		jobs[ i ].timer = xTimerCreateStatic( jobs[ i ].name, first, pdTRUE, ( void * )( uintptr_t )i,
+											  USER_Jobs_Release, &jobs[ i ].timer_buffer );
+		xTimerStart( jobs[ i ].timer, 0 );
+	}
+}
+
+/* NULL past the end of the table, in priority order */
+const USER_Job_t *USER_Jobs_Get( uint8_t index ){
+	if( index >= USER_Jobs_Count )
+		return NULL;
+	return &USER_Jobs[ index ];
+}
+
+/* Declared load in permille, 0x8000 0000 is added when a declared deadline can be missed */
+uint32_t USER_Jobs_Utilization( void ){
+	if( USER_Jobs_Count && !USER_Jobs_Fit )
+		return USER_Jobs_Load | 0x80000000UL;
+	return USER_Jobs_Load;
+}
+
+static void USER_Jobs_Run( USER_Job_t *job, TickType_t release ){
+	uint32_t start;
+	uint32_t exec;
+	uint32_t response;
+
+	start = USER_Micros( );
+	response = ( xTaskGetTickCount( ) - release ) * ( portTICK_PERIOD_MS * 1000U );
+	job->run( );
+	exec = USER_Micros( ) - start;
+	response += exec;
+
+	job->runs++;
+	if( exec > job->max_exec_us )
+		job->max_exec_us = exec;
+	if( exec > job->wcet_us )
+		job->overruns++;
+	if( response > job->max_response_us )
+		job->max_response_us = response;
+	if( response > job->deadline_us )
+		job->misses++;
+}
+
+void USER_Jobs_Worker( void *pvParameters ){
+	TickType_t release;
+	uint32_t released;
+	uint8_t i;
+
+	( void )pvParameters;
+
+	for(;;){
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+		/* One job per pass, the highest priority released one, then look again */
+		for(;;){
+			taskENTER_CRITICAL( );
+			released = USER_Jobs_Released;
+			for( i = 0; i < USER_Jobs_Count && !( released & ( 0x1UL << i ) ); i++ );
+			if( i < USER_Jobs_Count ){
+				USER_Jobs_Released &= ~( 0x1UL << i );
+				release = USER_Jobs[ i ].release;
+			}
+			taskEXIT_CRITICAL( );
+			if( i == USER_Jobs_Count )
+				break;
+			USER_Jobs_Run( &USER_Jobs[ i ], release );
+		}
+	}
+}
@@ -0,0 +1,243 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "user_uart.h"
+#include "user_tim.h"
+#include "TractorLink.h"
+#include "user_link.h"
+
+/*
+ * Owner of the ESP32 link on USART1: frame receiver, sequence numbers and the
+ * baud negotiation described in TractorLink.h. Receive side runs in the USART1
+ * ISR, the transmit side and the negotiation run in the task sending the inputs,
+ * so the baud rate only changes between two transmitted frames.
+ *
+ * Once a faster rate is agreed the same task keeps the ESP32 clock in sync
+ * (TractorLink.h) and marks one INPUT frame every TL_TRACE_PERIOD_MS with a
+ * trace id and the sample and send times on the ESP32 clock.
+ */
+
+typedef struct {
+	uint32_t rtt;//		Round trip minus the ESP32 turnaround
+	uint32_t local;//	STM32 time the request reached the wire end
+	uint32_t offset;//	ESP32 minus STM32 time at 'local'
+} USER_Link_Sync_Sample_t;
+
+TractorLink_Rx_t USER_Link_Rx;
+USER_Link_Stats_t USER_Link_Stats = { TL_BAUD_DEFAULT, 0, 0, 0, 0, 0, 0, 0 };
+
+static const uint32_t USER_Link_Rates[ TL_BAUD_RATE_COUNT ] = TL_BAUD_RATES_INIT;
+static uint8_t USER_Link_Candidate = 0;//			Index of the rate offered next
+static uint8_t USER_Link_Tx_Seq = 0;
+static TickType_t USER_Link_Next_Offer = 0;
+static volatile uint32_t USER_Link_Ack_Baud = 0;//	Set by the ISR, consumed by the task
+static volatile TickType_t USER_Link_Last_Rx = 0;//	Tick of the last valid frame
+static volatile uint8_t USER_Link_Errors = 0;//		Bad frames or line errors in a row
+
+static TickType_t USER_Link_Next_Sync = 0;
+static volatile uint32_t USER_Link_Sync_t1 = 0;//	Request in flight, echoed by its answer
+static volatile uint32_t USER_Link_Sync_Sent = 0;//	Its end on the wire
+static volatile uint32_t USER_Link_Sync_Wire = 0;//	Time on the wire of an answer at the current rate
+static volatile uint8_t USER_Link_Sync_Answers = 0;//	In the current window, the ISR stops at USER_LINK_SYNC_SAMPLES
+static USER_Link_Sync_Sample_t USER_Link_Sync_Best;//	Shortest round trip of the window
+static USER_Link_Sync_Sample_t USER_Link_Clock;//	Applied by the task
+static uint8_t USER_Link_Clock_Valid = 0;
+static uint16_t USER_Link_Trace_Id = 0;
+static TickType_t USER_Link_Next_Trace = 0;
+static uint8_t USER_Link_Slow_Count = 0;//	INPUT calls since the last sent at TL_BAUD_DEFAULT
+
+void USER_Link_Init( void ){
+	TractorLink_Rx_Init( &USER_Link_Rx );
+}
+
+/* Sync answer from the ISR, t4 stamped when its frame completed */
+static USER_RAMFUNC void USER_Link_Sync_Answer( const TractorLink_Sync_t *sync, uint32_t t4 ){
+	uint32_t sent = USER_Link_Sync_Sent;
+	uint32_t rtt;
+
+	if( sync->t1 != USER_Link_Sync_t1 || USER_Link_Sync_Answers >= USER_LINK_SYNC_SAMPLES )
+		return;//	Answer to an older request, or the task has not taken the window yet
+	USER_Link_Sync_t1 = ~sync->t1;
+
+	/* Back to the first byte of the answer, written by the ESP32 at t3 */
+	t4 -= USER_Link_Sync_Wire;
+	rtt = ( t4 - sent ) - ( sync->t3 - sync->t2 );
+	if( ( int32_t )rtt < 0 )
+		rtt = 0;
+	if( USER_Link_Sync_Answers == 0 || rtt < USER_Link_Sync_Best.rtt ){
+		/* Both legs taken as equal, the shortest exchange is the one where that holds best */
+		USER_Link_Sync_Best.rtt = rtt;
+		USER_Link_Sync_Best.local = sent;
+		USER_Link_Sync_Best.offset = sync->t2 - sent - ( rtt >> 1U );
+	}
+	USER_Link_Sync_Answers++;
+}
+
+/* Called for every received byte, returns 1 when 'msg' holds an application message */
+USER_RAMFUNC uint8_t USER_Link_Rx_Byte( uint8_t byte, TractorLink_Msg_t *msg ){
+	TractorLink_Sync_t sync;
+	uint32_t bad;
+	uint32_t baud;
+	uint32_t now;
+
+	bad = USER_Link_Rx.stats.crc_errors + USER_Link_Rx.stats.format_errors;
+	if( TractorLink_Rx_Byte( &USER_Link_Rx, byte, msg ) ){
+		USER_Link_Last_Rx = xTaskGetTickCountFromISR( );
+		USER_Link_Errors = 0;
+		if( msg->type == TL_MSG_BAUD_ACK ){
+			if( TractorLink_Decode_Baud( msg, &baud ) == TL_OK )
+				USER_Link_Ack_Baud = baud;
+			return 0;
+		}
+		if( msg->type == TL_MSG_SYNC_ACK ){
+			now = USER_Micros( );
+			if( TractorLink_Decode_Sync( msg, &sync ) == TL_OK )
+				USER_Link_Sync_Answer( &sync, now );
+			return 0;
+		}
+		return 1;
+	}
+	if( bad != USER_Link_Rx.stats.crc_errors + USER_Link_Rx.stats.format_errors )
+		USER_Link_Errors++;
+	return 0;
+}
+
+/* Framing, noise or overrun flag seen by the ISR */
+void USER_Link_Rx_Error( void ){
+	USER_Link_Stats.line_errors++;
+	USER_Link_Errors++;
+}
+
+static void USER_Link_Send( uint8_t *frame, size_t length ){
+	if( length )
+		USER_UART1_Transmit( frame, ( uint16_t )length );
+}
+
+/* Microseconds on the wire for 'bytes' at the current rate, 10 bits per byte */
+static uint32_t USER_Link_Wire_us( uint32_t bytes ){
+	return ( uint32_t )( ( uint64_t )bytes * 10000000U / USER_Link_Stats.baud );
+}
+
+/* Applies a full window of sync answers, then sends the next request when due */
+static void USER_Link_Sync( TickType_t now ){
+	TractorLink_Sync_t sync = { 0, 0, 0 };
+	uint8_t frame[ TL_MAX_FRAME ];
+	int32_t skew;
+	size_t length;
+
+	if( USER_Link_Sync_Answers >= USER_LINK_SYNC_SAMPLES ){
+		if( USER_Link_Clock_Valid ){
+			/* Offset change over the window gives the rate, averaged over the last few windows */
+			skew = ( int32_t )( ( int64_t )( int32_t )( USER_Link_Sync_Best.offset - USER_Link_Clock.offset ) * 1000000
+								/ ( int32_t )( USER_Link_Sync_Best.local - USER_Link_Clock.local ) );
+			if( skew > USER_LINK_SKEW_MAX_PPM || skew < -USER_LINK_SKEW_MAX_PPM )
+				USER_Link_Stats.sync_skew_ppm = 0;
+			else if( USER_Link_Stats.sync_updates < 2U )
+				USER_Link_Stats.sync_skew_ppm = skew;
+			else
+				USER_Link_Stats.sync_skew_ppm += ( skew - USER_Link_Stats.sync_skew_ppm ) / 4;
+		}
+		USER_Link_Clock = USER_Link_Sync_Best;
+		USER_Link_Clock_Valid = 1;
+		USER_Link_Stats.sync_rtt_us = USER_Link_Clock.rtt;
+		USER_Link_Stats.sync_updates++;
+		USER_Link_Sync_Answers = 0;
+	}
+
+	if( ( int32_t )( now - USER_Link_Next_Sync ) < 0 )
+		return;
+	USER_Link_Next_Sync = now + pdMS_TO_TICKS( TL_SYNC_PERIOD_MS );
+	sync.t1 = USER_Micros( );
+	length = TractorLink_Encode_Sync( TL_MSG_SYNC_REQ, &sync, USER_Link_Tx_Seq++, frame );
+	/* Set before sending, the answer can only come after the last byte */
+	USER_Link_Sync_Wire = USER_Link_Wire_us( TL_HEADER_SIZE + TL_SYNC_ACK_SIZE + TL_CRC_SIZE + 2U );
+	USER_Link_Sync_Sent = sync.t1 + USER_Link_Wire_us( USER_UART1_Tx_Pending( ) + length );
+	USER_Link_Sync_t1 = sync.t1;
+	USER_Link_Send( frame, length );
+}
+
+/* ESP32 micros() for a USER_Micros time, 0 while the clocks are not in sync */
+uint8_t USER_Link_To_Peer( uint32_t local_us, uint32_t *peer_us ){
+	int32_t elapsed;
+
+	if( !USER_Link_Clock_Valid )
+		return 0;
+	elapsed = ( int32_t )( local_us - USER_Link_Clock.local );
+	*peer_us = local_us + USER_Link_Clock.offset
+			   + ( uint32_t )( int32_t )( ( int64_t )elapsed * USER_Link_Stats.sync_skew_ppm / 1000000 );
+	return 1;
+}
+
+/* Negotiation step, runs before every transmitted frame */
+static void USER_Link_Poll( void ){
+	TickType_t now = xTaskGetTickCount( );
+	uint8_t frame[ TL_MAX_FRAME ];
+	uint32_t baud;
+
+	baud = USER_Link_Ack_Baud;
+	if( baud && !USER_UART1_Tx_Idle( ) )
+		return;//	The agreed rate waits for the last bytes at the old one, nothing else is queued
+	if( baud ){
+		USER_Link_Ack_Baud = 0;
+		/* The ESP32 switched right after its acknowledge, follow it */
+		if( USER_Link_Stats.baud == TL_BAUD_DEFAULT && baud == USER_Link_Rates[ USER_Link_Candidate ] ){
+			USER_UART1_Set_Baud( baud );
+			USER_Link_Stats.baud = baud;
+			USER_Link_Stats.switches++;
+			USER_Link_Last_Rx = now;
+			USER_Link_Errors = 0;
+		}
+	} else if( USER_Link_Stats.baud != TL_BAUD_DEFAULT ){
+		if( ( now - USER_Link_Last_Rx ) > pdMS_TO_TICKS( TL_LINK_TIMEOUT_MS ) || USER_Link_Errors >= TL_LINK_MAX_ERRORS ){
+			/* The ESP32 applies the same rule, both meet again at the default rate */
+			USER_UART1_Set_Baud( TL_BAUD_DEFAULT );
+			USER_Link_Stats.baud = TL_BAUD_DEFAULT;
+			USER_Link_Stats.fallbacks++;
+			if( USER_Link_Candidate < TL_BAUD_RATE_COUNT - 1U )
+				USER_Link_Candidate++;
+			USER_Link_Next_Offer = now + pdMS_TO_TICKS( USER_LINK_RETRY_MS );
+			USER_Link_Errors = 0;
+			/* The ESP32 may have restarted, and its clock with it */
+			USER_Link_Clock_Valid = 0;
+			USER_Link_Sync_Answers = 0;
+			USER_Link_Stats.sync_skew_ppm = 0;
+			USER_Link_Stats.sync_updates = 0;
+		}
+	} else if( ( int32_t )( now - USER_Link_Next_Offer ) >= 0 ){
+		USER_Link_Send( frame, TractorLink_Encode_Baud( TL_MSG_BAUD_REQ, USER_Link_Rates[ USER_Link_Candidate ],
+														USER_Link_Tx_Seq++, frame ) );
+		USER_Link_Next_Offer = now + pdMS_TO_TICKS( USER_LINK_REQ_PERIOD_MS );
+	}
+
+	/* At 9600 baud the sync and trace frames would not fit in the Emit period */
+	if( USER_Link_Stats.baud != TL_BAUD_DEFAULT )
+		USER_Link_Sync( now );
+}
+
+/* 'sample_us' is the USER_Micros time the input was read, used when the frame is traced */
+void USER_Link_Send_Input( const TractorLink_Input_t *input, uint32_t sample_us ){
+	TractorLink_Input_t sent = *input;
+	TickType_t now;
+	uint8_t frame[ TL_MAX_FRAME ];
+
+	USER_Link_Poll( );
+	if( USER_Link_Ack_Baud )
+		return;//	Rate switch still waiting for the ring to drain
+	/* At TL_BAUD_DEFAULT a frame outlasts the Emit period, the newest sample goes out once the line can take it */
+	if( USER_Link_Stats.baud == TL_BAUD_DEFAULT && ++USER_Link_Slow_Count < USER_LINK_SLOW_EVERY )
+		return;
+	USER_Link_Slow_Count = 0;
+	now = xTaskGetTickCount( );
+	sent.trace_id = 0;
+	if( USER_Link_Clock_Valid && ( int32_t )( now - USER_Link_Next_Trace ) >= 0 ){
+		if( ++USER_Link_Trace_Id == 0 )
+			USER_Link_Trace_Id = 1;//	0 means untraced
+		sent.trace_id = USER_Link_Trace_Id;
+		USER_Link_To_Peer( sample_us, &sent.sample_us );
+		USER_Link_To_Peer( USER_Micros( ) + USER_Link_Wire_us( USER_UART1_Tx_Pending( ) ), &sent.tx_us );
+		USER_Link_Next_Trace = now + pdMS_TO_TICKS( TL_TRACE_PERIOD_MS );
+		USER_Link_Stats.traces++;
+	}
+	USER_Link_Send( frame, TractorLink_Encode_Input( &sent, USER_Link_Tx_Seq++, frame ) );
+}
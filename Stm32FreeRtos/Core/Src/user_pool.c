@@ -0,0 +1,82 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "user_pool.h"
+
+static USER_Pool_t *USER_Pools[ USER_POOL_MAX ];
+static uint8_t USER_Pools_Count = 0;
+
+/* Builds the free list, before any allocation, from main or the first task */
+void USER_Pool_Init( USER_Pool_t *pool ){
+	USER_Pool_Header_t *header;
+
+	configASSERT( pool->blocks > 0 && ( pool->block_size & 0x3U ) == 0 );
+
+	pool->free = NULL;
+	for( uint16_t i = pool->blocks; i > 0; i-- ){
+		header = ( USER_Pool_Header_t * )( pool->storage + ( uint32_t )( i - 1U ) * pool->block_size );
+		header->next = pool->free;
+		pool->free = header;
+	}
+	pool->in_use = 0;
+	if( USER_Pools_Count < USER_POOL_MAX )
+		USER_Pools[ USER_Pools_Count++ ] = pool;
+}
+
+/* A block with one reference, NULL when the pool is empty */
+USER_RAMFUNC void *USER_Pool_Alloc( USER_Pool_t *pool ){
+	USER_Pool_Header_t *header;
+	uint32_t primask;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	header = pool->free;
+	if( header != NULL ){
+		pool->free = header->next;
+		header->refs = 1U;
+		if( ++pool->in_use > pool->peak )
+			pool->peak = pool->in_use;
+	} else {
+		pool->fails++;
+	}
+	__set_PRIMASK( primask );
+
+	return ( header != NULL ) ? ( void * )( header + 1 ) : NULL;
+}
+
+/* One more reference to a block already held by the caller */
+USER_RAMFUNC void USER_Pool_Retain( void *block ){
+	USER_Pool_Header_t *header = ( USER_Pool_Header_t * )block - 1;
+	uint32_t primask;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	header->refs++;
+	__set_PRIMASK( primask );
+}
+
+/* Drops one reference, the last one returns the block to 'pool' */
+USER_RAMFUNC void USER_Pool_Release( USER_Pool_t *pool, void *block ){
+	USER_Pool_Header_t *header = ( USER_Pool_Header_t * )block - 1;
+	uint32_t primask;
+
+	configASSERT( ( uint8_t * )header >= pool->storage
+				  && ( uint8_t * )header < pool->storage + ( uint32_t )pool->blocks * pool->block_size );
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	if( --header->refs == 0U ){
+		header->next = pool->free;
+		pool->free = header;
+		pool->in_use--;
+	}
+	__set_PRIMASK( primask );
+}
+
+/* NULL past the last initialized pool */
+const USER_Pool_t *USER_Pool_Get( uint8_t index ){
+	if( index >= USER_Pools_Count )
+		return NULL;
+	return USER_Pools[ index ];
+}
@@ -0,0 +1,273 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "user_tim.h"
+#include "adclib.h"
+#include "user_uart.h"
+#include "user_prof.h"
+#include "user_power.h"
+
+/*
+ * The C031 has no low-power timer, the wake-up comes from the RTC alarm A on
+ * the LSI. The prescalers are set so the sub-second counter (SSR) counts single
+ * LSI periods, about 31 us, and the alarm compares only that counter. The LSI
+ * is measured against TIM14 once at init, its spread is too wide to trust the
+ * nominal 32 kHz.
+ *
+ * In SLEEP every clock keeps running, the time asleep comes from USER_Micros.
+ * In STOP TIM14 stops too, the time asleep comes from the RTC and TIM14 is
+ * moved forward by it afterwards. The wake-up sources are the RTC alarm, any
+ * EXTI line and a byte on USART1 (kernel clock on HSIKER, UESM set in
+ * USER_UART1_Init). USART2 cannot wake the core, a console character typed
+ * during STOP is lost.
+ *
+ * The RTC stays unlocked (WPR) after init, only this file writes it.
+ */
+
+USER_Power_Stats_t USER_Power_Stats;
+
+static uint32_t USER_PWR_LSI_Hz = 32000U;
+static uint32_t USER_PWR_Last_us;
+static uint64_t USER_PWR_Last_Sleep_us;
+static uint64_t USER_PWR_Last_Stop_us;
+
+/* Sub-second counter, counts down from 0x7FFF. Read twice, it runs on the LSI */
+static uint32_t USER_Power_SS( void ){
+	uint32_t ss;
+
+	do {
+		ss = RTC->SSR;
+	} while( ss != RTC->SSR );
+	return ss;
+}
+
+static uint32_t USER_Power_Counts_To_us( uint32_t counts ){
+	return ( uint32_t )( ( uint64_t )counts * 1000000U / USER_PWR_LSI_Hz );
+}
+
+static uint32_t USER_Power_us_To_Counts( uint32_t us ){
+	return ( uint32_t )( ( uint64_t )us * USER_PWR_LSI_Hz / 1000000U );
+}
+
+void USER_Power_Init( void ){
+	uint32_t ss;
+	uint32_t start;
+
+	RCC->APBENR1	|=  ( 0x1UL << 28U )//	PWR clock enabled
+					|   ( 0x1UL << 10U );//	RTC APB clock enabled
+	RCC->CSR2		|=  ( 0x1UL <<  0U );//	LSI on
+	while(!( RCC->CSR2 & ( 0x1UL <<  1U )));//	wait until LSIRDY
+	if(( RCC->CSR1 & ( 0x3UL <<  8U )) != ( 0x2UL <<  8U )){
+		/* RTCSEL is write-once, a clock left by other firmware needs an RTC domain reset */
+		RCC->CSR1	|=  ( 0x1UL << 16U );//	RTCRST
+		RCC->CSR1	&= ~( 0x1UL << 16U );
+		RCC->CSR1	|=  ( 0x2UL <<  8U );//	RTCSEL = LSI
+	}
+	RCC->CSR1		|=  ( 0x1UL << 15U );//	RTC clock enabled
+
+	RTC->WPR		 =  0xCAU;//				Write protection key
+	RTC->WPR		 =  0x53U;
+	RTC->ICSR		|=  ( 0x1UL <<  7U );//	INIT
+	while(!( RTC->ICSR & ( 0x1UL <<  6U )));//	wait until INITF
+	RTC->PRER		 =  0x7FFFU;//			PREDIV_A = 0, PREDIV_S = 32767: SSR counts LSI periods
+	RTC->CR			|=  ( 0x1UL <<  5U );//	BYPSHAD, SSR read straight from the counter
+	RTC->ICSR		&= ~( 0x1UL <<  7U );//	Calendar running
+
+	RTC->CR			&= ~( 0x1UL <<  8U );//	Alarm A disabled to configure it
+	while(!( RTC->ICSR & ( 0x1UL <<  0U )));//	wait until ALRAWF
+	RTC->ALRMAR		 =  ( 0x1UL << 31U ) | ( 0x1UL << 23U )
+					|   ( 0x1UL << 15U ) | ( 0x1UL <<  7U );//	Date, hours, minutes and seconds masked
+	RTC->ALRMASSR	 =  ( 0xFUL << 24U );//	MASKSS = 15, SS[14:0] compared
+	RTC->SCR		 =  ( 0x1UL <<  0U );//	CALRAF
+	RTC->CR			|=  ( 0x1UL << 12U );//	Alarm A interrupt enabled
+
+	EXTI->IMR1		|=  ( 0x1UL << 19U )//	RTC wake-up line
+					|   ( 0x1UL << 25U );//	USART1 wake-up line
+	NVIC_SetPriority( RTC_IRQn, 3 );
+	NVIC->ISER[0] = ( 0x1UL <<  2U );//	RTC interrupt
+
+	PWR->CR1		&= ~( 0x7UL <<  0U );//	LPMS = STOP when SLEEPDEEP is set
+#ifdef DEBUG
+	RCC->APBENR1	|=  ( 0x1UL << 27U );//	DBG clock enabled
+	DBG->CR			|=  ( 0x1UL <<  1U );//	Debugger stays attached in STOP
+#endif
+
+	/* LSI frequency from USER_PWR_CAL_COUNTS periods timed on TIM14, from an SSR edge */
+	ss = USER_Power_SS( );
+	while( USER_Power_SS( ) == ss );
+	ss = USER_Power_SS( );
+	start = USER_Micros( );
+	while((( ss - USER_Power_SS( )) & 0x7FFFU ) < USER_PWR_CAL_COUNTS );
+	USER_PWR_LSI_Hz = ( uint32_t )( ( uint64_t )USER_PWR_CAL_COUNTS * 1000000U / ( USER_Micros( ) - start ) );
+	USER_PWR_Last_us = USER_Micros( );
+}
+
+/* Alarm A at sub-second count 'ss', ALRAE must be cleared to change it */
+static void USER_Power_Alarm( uint32_t ss ){
+	RTC->CR			&= ~( 0x1UL <<  8U );
+	while(!( RTC->ICSR & ( 0x1UL <<  0U )));//	wait until ALRAWF
+	RTC->ALRMASSR	 =  ( 0xFUL << 24U ) | ss;
+	RTC->SCR		 =  ( 0x1UL <<  0U );//	CALRAF, a stale match must not end the sleep at once
+	RTC->CR			|=  ( 0x1UL <<  8U );//	Alarm A enabled
+}
+
+/* Only the alarm's wake-up is wanted, the flag is cleared and nothing else happens */
+void RTC_IRQHandler( void ){
+	RTC->SCR = ( 0x1UL <<  0U );//	CALRAF
+}
+
+/*
+ * STOP halts every clock but the LSI. Whatever runs on them must be idle or
+ * able to pick up where it left off: TIM3 would freeze the PWM pins at their
+ * level (safe only at zero duty), TIM16 steps the LCD, a TIM14 compare times
+ * the button debounce, a frame in a USART shift register would be cut. The ADC scan is stopped and restarted around it.
+ */
+static uint8_t USER_Power_Can_Stop( uint32_t expected ){
+#ifdef USER_NO_STOP
+	( void )expected;
+	return 0;
+#else
+	if( expected < USER_PWR_STOP_MIN_TICKS )
+		return 0;
+	if( TIM3->CCR1 | TIM3->CCR2 | TIM3->CCR3 | TIM3->CCR4 )
+		return 0;
+	if( TIM16->CR1 & ( 0x1UL <<  0U ) )
+		return 0;
+	if( TIM14->DIER & ( 0x1UL <<  1U ) )//	CC1IE
+		return 0;
+	if( !USER_UART1_Tx_Idle( ) || !( USART2->ISR & ( 0x1UL <<  6U )))//	USART1 ring, TC
+		return 0;
+	return 1;
+#endif
+}
+
+/* portSUPPRESS_TICKS_AND_SLEEP, run by the idle task with the scheduler suspended */
+void USER_Power_Sleep( uint32_t expected ){
+	const uint32_t tick_us = 1000000U / configTICK_RATE_HZ;
+	uint32_t counts_per_us = SystemCoreClock / 1000000U;//	SysTick runs on the CPU clock
+	uint32_t to_tick_us;
+	uint32_t sleep_us;
+	uint32_t slept_us;
+	uint32_t counts;
+	uint32_t entry_ss;
+	uint32_t exit_ss;
+	uint32_t target;
+	uint32_t start;
+	uint32_t stopped_us;
+	uint32_t ticks;
+	uint32_t remaining_us;
+	uint8_t stop;
+
+	if( expected > USER_PWR_MAX_IDLE_TICKS )
+		expected = USER_PWR_MAX_IDLE_TICKS;
+
+	/* PRIMASK, not a critical section: the interrupts must still end the WFI */
+	__asm volatile( "cpsid i" ::: "memory" );
+	__asm volatile( "dsb" );
+	__asm volatile( "isb" );
+	if( eTaskConfirmSleepModeStatus( ) == eAbortSleep ){
+		__asm volatile( "cpsie i" ::: "memory" );
+		return;
+	}
+
+	SysTick->CTRL	&= ~SysTick_CTRL_ENABLE_Msk;
+	start = USER_Micros( );
+	if( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk ){
+		/* A tick is already due, let it run instead */
+		SysTick->CTRL	|=  SysTick_CTRL_ENABLE_Msk;
+		__asm volatile( "cpsie i" ::: "memory" );
+		return;
+	}
+
+	/* Rest of the current tick, then the whole ticks after it, woken a few LSI periods early */
+	to_tick_us = SysTick->VAL / counts_per_us;
+	sleep_us = to_tick_us + ( expected - 1U ) * tick_us;
+	counts = USER_Power_us_To_Counts( sleep_us );
+	counts -= counts / 128U + 2U;//	Calibration error and the SSR read
+	stop = USER_Power_Can_Stop( expected );
+
+	entry_ss = USER_Power_SS( );
+	target = ( entry_ss - counts ) & 0x7FFFU;
+	USER_Power_Alarm( target );
+	HAL_SuspendTick( );
+	USER_Prof_Pause( );
+	if( stop ){
+		USER_ADC_Suspend( );
+		SCB->SCR	|=  SCB_SCR_SLEEPDEEP_Msk;
+	}
+
+	__asm volatile( "dsb" ::: "memory" );
+	__asm volatile( "wfi" );
+	__asm volatile( "isb" );
+
+	exit_ss = USER_Power_SS( );
+	if( RTC->SR & ( 0x1UL <<  0U ) ){
+		/* Woken by the alarm: how long after the match the core runs again */
+		USER_Power_Stats.wake_last_us = USER_Power_Counts_To_us( ( target - exit_ss ) & 0x7FFFU );
+		if( USER_Power_Stats.wake_last_us > USER_Power_Stats.wake_max_us )
+			USER_Power_Stats.wake_max_us = USER_Power_Stats.wake_last_us;
+	}
+	if( stop ){
+		SCB->SCR	&= ~SCB_SCR_SLEEPDEEP_Msk;
+		/* TIM14 only counted the few microseconds around the WFI, the RTC the whole STOP */
+		stopped_us = USER_Power_Counts_To_us( ( entry_ss - exit_ss ) & 0x7FFFU );
+		if( stopped_us > USER_Micros( ) - start )
+			USER_TIM14_Advance( stopped_us - ( USER_Micros( ) - start ) );
+		USER_ADC_Resume( );
+		USER_TIM3_Jitter_Restart( );
+	}
+	USER_Prof_Resume( );
+	HAL_ResumeTick( );
+
+	/* Whole ticks slept, and what is left of the tick in progress */
+	slept_us = USER_Micros( ) - start;
+	if( slept_us < to_tick_us ){
+		ticks = 0;
+		remaining_us = to_tick_us - slept_us;
+	} else {
+		slept_us -= to_tick_us;
+		ticks = 1U + slept_us / tick_us;
+		remaining_us = tick_us - slept_us % tick_us;
+	}
+	if( ticks > expected ){
+		ticks = expected;
+		remaining_us = tick_us;
+	}
+
+	/* SysTick restarts on the rest of the tick, the next reload is a full tick again */
+	SysTick->LOAD	 =  remaining_us * counts_per_us - 1U;
+	SysTick->VAL	 =  0U;
+	SysTick->CTRL	|=  SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD	 =  SystemCoreClock / configTICK_RATE_HZ - 1U;
+	vTaskStepTick( ticks );
+
+	slept_us = USER_Micros( ) - start;
+	if( stop ){
+		USER_Power_Stats.stops++;
+		USER_Power_Stats.stop_us += slept_us;
+	} else {
+		USER_Power_Stats.sleeps++;
+		USER_Power_Stats.sleep_us += slept_us;
+	}
+	__asm volatile( "cpsie i" ::: "memory" );
+}
+
+/* Estimated supply current since the previous call, from the time spent in each state */
+uint32_t USER_Power_Average_uA( void ){
+	uint32_t now = USER_Micros( );
+	uint32_t interval = now - USER_PWR_Last_us;
+	uint32_t sleep = ( uint32_t )( USER_Power_Stats.sleep_us - USER_PWR_Last_Sleep_us );
+	uint32_t stop = ( uint32_t )( USER_Power_Stats.stop_us - USER_PWR_Last_Stop_us );
+	uint64_t charge;
+
+	USER_PWR_Last_us = now;
+	USER_PWR_Last_Sleep_us = USER_Power_Stats.sleep_us;
+	USER_PWR_Last_Stop_us = USER_Power_Stats.stop_us;
+	if( interval == 0 || sleep + stop > interval )
+		return 0;
+	charge = ( uint64_t )( interval - sleep - stop ) * USER_PWR_RUN_UA
+		   + ( uint64_t )sleep * USER_PWR_SLEEP_UA
+		   + ( uint64_t )stop * USER_PWR_STOP_UA;
+	return ( uint32_t )( charge / interval );
+}
@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include "main.h"
+#include "user_uart.h"
+#include "user_fmt.h"
+#include "user_prof.h"
+
+#if USER_PROF_ENABLED
+
+/*
+ * Probe statistics, dumped on USART2 by the 'p' console command (user_stats.c):
+ *
+ *   PROF <overhead cycles>
+ *   P <probe> <count> <min> <mean> <max> <bucket 0> ... <bucket 19>
+ *   END
+ *
+ * Cycles at 48 MHz, the overhead of an empty BEGIN/END pair is already taken
+ * out of every sample. Counts are totals since boot, a probe updating while it
+ * is dumped can show one sample in some fields and not in others.
+ */
+
+typedef struct {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t buckets[ USER_PROF_BUCKETS ];
+} USER_Prof_Stats_t;
+
+static const char *const USER_Prof_Names[ PROF_COUNT ] = { "usart1", "tim3", "adc", "lcd" };
+
+volatile uint16_t USER_Prof_Overflows = 0;
+static USER_Prof_Stats_t USER_Prof_Stats[ PROF_COUNT ];
+static uint32_t USER_Prof_Overhead = 0;
+static char USER_Prof_Line[ 32 ];
+
+void USER_Prof_Init( void ){
+	uint32_t start;
+	uint32_t cycles;
+
+	RCC->APBENR2	|=  ( 0x1UL << 11U );//	TIM1 clock enabled
+	TIM1->CR1		 =  ( 0x1UL <<  2U );//	Up counter, only the overflow raises UIF
+	TIM1->PSC		 =  0U;//				Counts CPU cycles
+	TIM1->ARR		 =  0xFFFFU;//			Overflow every 1.37 ms
+	TIM1->EGR		 =  ( 0x1UL <<  0U );//	Load PSC and ARR
+	TIM1->SR		 =  0U;
+	TIM1->DIER		 =  ( 0x1UL <<  0U );//	Update interrupt extends the count to 32 bits
+	NVIC_SetPriority( TIM1_BRK_UP_TRG_COM_IRQn, 0 );//	Never held back long enough to lose an overflow
+	NVIC->ISER[0] = ( 0x1UL << 13U );//	TIM1 update interrupt
+	TIM1->CR1		|=  ( 0x1UL <<  0U );//	Counter enabled, only paused while the idle task sleeps
+
+	/* Cost of an empty probe, the smallest of a few tries */
+	USER_Prof_Overhead = UINT32_MAX;
+	for( uint8_t i = 0; i < 8U; i++ ){
+		start = USER_Prof_Now( );
+		cycles = USER_Prof_Now( ) - start;
+		if( cycles < USER_Prof_Overhead )
+			USER_Prof_Overhead = cycles;
+	}
+	for( uint8_t i = 0; i < PROF_COUNT; i++ )
+		USER_Prof_Stats[ i ].min = UINT32_MAX;
+}
+
+void TIM1_BRK_UP_TRG_COM_IRQHandler( void ){
+	if( TIM1->SR & ( 0x1UL << 0U ) ){
+		TIM1->SR = ~( 0x1UL << 0U );//	rc_w0, the other flags are left as they are
+		USER_Prof_Overflows++;
+	}
+}
+
+/* floor( log2( cycles ) ) without CLZ, which the M0+ lacks, capped to the last bucket */
+static uint32_t USER_Prof_Bucket( uint32_t cycles ){
+	uint32_t bucket = 0;
+
+	if( cycles >= ( 0x1UL << 16U ) ){ cycles >>= 16U; bucket += 16U; }
+	if( cycles >= ( 0x1UL <<  8U ) ){ cycles >>=  8U; bucket +=  8U; }
+	if( cycles >= ( 0x1UL <<  4U ) ){ cycles >>=  4U; bucket +=  4U; }
+	if( cycles >= ( 0x1UL <<  2U ) ){ cycles >>=  2U; bucket +=  2U; }
+	if( cycles >= ( 0x1UL <<  1U ) ){ bucket +=  1U; }
+	return ( bucket < USER_PROF_BUCKETS ) ? bucket : USER_PROF_BUCKETS - 1U;
+}
+
+USER_RAMFUNC void USER_Prof_Record( USER_Prof_Probe_t probe, uint32_t cycles ){
+	USER_Prof_Stats_t *stats = &USER_Prof_Stats[ probe ];
+
+	cycles = ( cycles > USER_Prof_Overhead ) ? cycles - USER_Prof_Overhead : 0U;
+	stats->count++;
+	stats->total += cycles;
+	if( cycles < stats->min )
+		stats->min = cycles;
+	if( cycles > stats->max )
+		stats->max = cycles;
+	stats->buckets[ USER_Prof_Bucket( cycles ) ]++;
+}
+
+/* 'end' is what the last USER_Fmt_ call returned */
+static void USER_Prof_Send( const char *end ){
+	USER_UART2_Transmit( ( uint8_t * )USER_Prof_Line, ( uint16_t )( end - USER_Prof_Line ) );
+}
+
+static char *USER_Prof_Field( char *p, uint32_t value ){
+	p = USER_Fmt_Char( p, ' ' );
+	return USER_Fmt_Uint( p, value );
+}
+
+void USER_Prof_Dump( void ){
+	const USER_Prof_Stats_t *stats;
+	char *p;
+
+	p = USER_Fmt_Str( USER_Prof_Line, "PROF" );
+	p = USER_Prof_Field( p, USER_Prof_Overhead );
+	USER_Prof_Send( USER_Fmt_Str( p, "\r\n" ) );
+	for( uint8_t i = 0; i < PROF_COUNT; i++ ){
+		stats = &USER_Prof_Stats[ i ];
+		p = USER_Fmt_Str( USER_Prof_Line, "P " );
+		p = USER_Fmt_Str( p, USER_Prof_Names[ i ] );
+		p = USER_Prof_Field( p, stats->count );
+		USER_Prof_Send( p );
+		p = USER_Prof_Field( USER_Prof_Line, stats->count ? stats->min : 0U );
+		p = USER_Prof_Field( p, stats->count ? ( uint32_t )( stats->total / stats->count ) : 0U );
+		p = USER_Prof_Field( p, stats->max );
+		USER_Prof_Send( p );
+		for( uint8_t k = 0; k < USER_PROF_BUCKETS; k += 2U ){
+			p = USER_Prof_Field( USER_Prof_Line, stats->buckets[ k ] );
+			p = USER_Prof_Field( p, stats->buckets[ k + 1U ] );
+			USER_Prof_Send( p );
+		}
+		USER_Prof_Send( USER_Fmt_Str( USER_Prof_Line, "\r\n" ) );
+	}
+	USER_Prof_Send( USER_Fmt_Str( USER_Prof_Line, "END\r\n" ) );
+}
+
+#endif /* USER_PROF_ENABLED */
@@ -0,0 +1,50 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*
+ * Kernel glue that used to come from the CMSIS-RTOS2 wrapper (cmsis_os2.c).
+ * The application calls the FreeRTOS API directly, and the wrapper refuses to
+ * compile unless configMAX_PRIORITIES is 56, one ready list per CMSIS priority
+ * (about 1.1 KB here). Without it the kernel only gets the priorities in use.
+ */
+
+extern void xPortSysTickHandler( void );
+
+/* The RTOS tick. HAL keeps its own timebase on a TIM, see stm32c0xx_hal_timebase_tim.c */
+void SysTick_Handler( void ){
+	if( xTaskGetSchedulerState( ) != taskSCHEDULER_NOT_STARTED )
+		xPortSysTickHandler( );
+}
+
+void vApplicationMallocFailedHook( void ){
+	configASSERT( 0 );
+}
+
+void vApplicationStackOverflowHook( TaskHandle_t xTask, char *pcTaskName ){
+	( void )xTask;
+	( void )pcTaskName;
+	configASSERT( 0 );
+}
+
+/* Idle and timer service task memory, sized in FreeRTOSConfig.h */
+void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer,
+									uint32_t *pulIdleTaskStackSize ){
+	static StaticTask_t USER_Idle_TCB;
+	static StackType_t USER_Idle_Stack[ configMINIMAL_STACK_SIZE ];
+
+	*ppxIdleTaskTCBBuffer = &USER_Idle_TCB;
+	*ppxIdleTaskStackBuffer = USER_Idle_Stack;
+	*pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory( StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer,
+									 uint32_t *pulTimerTaskStackSize ){
+	static StaticTask_t USER_Timer_TCB;
+	static StackType_t USER_Timer_Stack[ configTIMER_TASK_STACK_DEPTH ];
+
+	*ppxTimerTaskTCBBuffer = &USER_Timer_TCB;
+	*ppxTimerTaskStackBuffer = USER_Timer_Stack;
+	*pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
@@ -0,0 +1,301 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "queue.h"
+#include "user_uart.h"
+#include "user_trace.h"
+#include "user_fmt.h"
+#include "user_jobs.h"
+#include "user_prof.h"
+#include "user_power.h"
+#include "user_pool.h"
+#include "TractorLink.h"
+#include "user_link.h"
+#include "user_stats.h"
+
+/*
+ * Every USER_STATS_PERIOD_MS one line goes out on the debug UART (USART2):
+ *
+ *   STATS <uptime ms> <free heap> <min free heap> <task>:<cpu permille>:<stack hwm words> ...
+ *
+ * CPU is the share of the run-time counter (TIM14, 1 us) each task used since the
+ * previous line. A second line reports the periodic jobs of user_jobs.c:
+ *
+ *   JOBS <load permille>[!] <job>:<runs>:<misses>:<overruns>:<skipped>:<max exec us>:<max response us> ...
+ *
+ * with '!' when the response-time test of user_jobs.c finds a job that can
+ * miss its deadline. A third line gives the tickless idle of user_power.c,
+ * the estimated average supply current since the previous line, the sleeps
+ * and stops with their total time, and the RTC alarm to wake-up latency:
+ *
+ *   PWR <avg uA> sleep:<count>:<ms> stop:<count>:<ms> wake:<last us>:<max us>
+ *
+ * and a fourth the fixed-block pools of user_pool.c:
+ *
+ *   POOL <pool>:<blocks>:<in use>:<peak>:<fails> ...
+ *
+ * and a fifth the ESP32 link of user_link.c, its rate, the clock sync round
+ * trip and rate difference and the latency traces sent:
+ *
+ *   LINK <baud> sync:<rtt us>:<skew ppm> traces:<count> [state:<velocity x100>:<rpm>:<gear>]
+ *
+ * The state is the newest STATE message, left out until the first one
+ * arrives. It is a second reference to the pool block the display job gets
+ * (USER_Stats_Post_State), not a copy.
+ *
+ * Counts are totals since boot. Tools/stats_series.py turns the lines into a
+ * time series.
+ *
+ * The same task serves single character commands received on USART2:
+ *   't'  dump the kernel trace ring (user_trace.c)
+ *   'p'  dump the code path profiler, DEBUG builds only (user_prof.c)
+ */
+
+static StaticTask_t USER_Stats_TCB;
+static StackType_t USER_Stats_Stack[ USER_STATS_STACK_DEPTH ];
+static TaskStatus_t USER_Stats_Status[ USER_STATS_MAX_TASKS ];
+static configRUN_TIME_COUNTER_TYPE USER_Stats_Previous[ USER_STATS_MAX_TASKS ];
+static char USER_Stats_Line[ 48 ];
+static TaskHandle_t USER_Stats_Handle;
+
+/* One-slot mailbox of the newest STATE block, the ISR replaces one not taken yet */
+static StaticQueue_t USER_Stats_State_Buffer;
+static uint8_t USER_Stats_State_Storage[ sizeof( TractorLink_State_t * ) ];
+static QueueHandle_t USER_Stats_State_Queue = NULL;
+static USER_Pool_t *USER_Stats_State_Pool = NULL;
+
+void USER_Stats_Init( UBaseType_t priority ){
+	USER_Stats_Handle = xTaskCreateStatic( USER_Stats_Task, "Stats", USER_STATS_STACK_DEPTH, NULL, priority,
+										   USER_Stats_Stack, &USER_Stats_TCB );
+	USER_Stats_State_Queue = xQueueCreateStatic( 1U, sizeof( TractorLink_State_t * ), USER_Stats_State_Storage,
+												 &USER_Stats_State_Buffer );
+
+	/* Commands arrive on the debug UART receiver */
+	USART2->CR1	|=  ( 0x1UL <<  5U );//	RXNE interrupt enabled
+	NVIC_SetPriority( USART2_IRQn, 3 );//	Lowest priority, a console can wait
+	NVIC->ISER[0] = ( 0x1UL << 28U );//	USART2 interrupt
+}
+
+/* USART1 ISR, with a block it holds: one more reference for the LINK line */
+USER_RAMFUNC void USER_Stats_Post_State( USER_Pool_t *pool, TractorLink_State_t *state, BaseType_t *woken ){
+	TractorLink_State_t *old;
+
+	if( USER_Stats_State_Queue == NULL )
+		return;
+	USER_Stats_State_Pool = pool;
+	if( xQueueReceiveFromISR( USER_Stats_State_Queue, &old, woken ) == pdPASS )
+		USER_Pool_Release( pool, old );
+	USER_Pool_Retain( state );
+	xQueueSendFromISR( USER_Stats_State_Queue, &state, woken );//	Never full, only this ISR sends
+}
+
+/* The received character is handed to the task as its notification value */
+void USART2_IRQHandler( void ){
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	USER_TRACE_ISR_BEGIN( USART2_IRQn );
+	if( USART2->ISR & ( 0x1UL << 3U ) )
+		USART2->ICR = ( 0x1UL << 3U );//	Clear the overrun, it would keep the interrupt asserted
+	if( USART2->ISR & ( 0x1UL << 5U ) )
+		xTaskNotifyFromISR( USER_Stats_Handle, USART2->RDR, eSetValueWithOverwrite, &xHigherPriorityTaskWoken );
+	USER_TRACE_ISR_END( USART2_IRQn );
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+}
+
+static void USER_Stats_Command( uint32_t command ){
+	switch( command ){
+	case USER_STATS_CMD_TRACE:
+		USER_Trace_Dump( );
+		break;
+	case USER_STATS_CMD_PROF:
+		USER_Prof_Dump( );
+		break;
+	default:
+		break;
+	}
+}
+
+/* Run-time counter consumed by the task since the last report, indexed by task number */
+static configRUN_TIME_COUNTER_TYPE USER_Stats_Delta( const TaskStatus_t *status ){
+	configRUN_TIME_COUNTER_TYPE delta;
+	UBaseType_t slot = status->xTaskNumber % USER_STATS_MAX_TASKS;
+
+	delta = status->ulRunTimeCounter - USER_Stats_Previous[ slot ];
+	USER_Stats_Previous[ slot ] = status->ulRunTimeCounter;
+	return delta;
+}
+
+/* 'end' is what the last USER_Fmt_ call returned */
+static void USER_Stats_Send( const char *end ){
+	USER_UART2_Transmit( ( uint8_t * )USER_Stats_Line, ( uint16_t )( end - USER_Stats_Line ) );
+}
+
+static void USER_Stats_Jobs( void ){
+	const USER_Job_t *job;
+	uint32_t load = USER_Jobs_Utilization( );
+	uint8_t i;
+	char *p;
+
+	p = USER_Fmt_Str( USER_Stats_Line, "JOBS " );
+	p = USER_Fmt_Uint( p, load & 0x7FFFFFFFUL );
+	if( load & 0x80000000UL )
+		p = USER_Fmt_Char( p, '!' );
+	USER_Stats_Send( p );
+	for( i = 0; ( job = USER_Jobs_Get( i ) ) != NULL; i++ ){
+		p = USER_Fmt_Char( USER_Stats_Line, ' ' );
+		p = USER_Fmt_Str( p, job->name );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, job->runs );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, job->misses );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, job->overruns );
+		USER_Stats_Send( p );
+		p = USER_Fmt_Char( USER_Stats_Line, ':' );
+		p = USER_Fmt_Uint( p, job->skipped );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, job->max_exec_us );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, job->max_response_us );
+		USER_Stats_Send( p );
+	}
+	USER_Stats_Send( USER_Fmt_Str( USER_Stats_Line, "\r\n" ) );
+}
+
+static void USER_Stats_Power_Field( const char *name, uint32_t a, uint32_t b ){
+	char *p;
+
+	p = USER_Fmt_Char( USER_Stats_Line, ' ' );
+	p = USER_Fmt_Str( p, name );
+	p = USER_Fmt_Char( p, ':' );
+	p = USER_Fmt_Uint( p, a );
+	p = USER_Fmt_Char( p, ':' );
+	p = USER_Fmt_Uint( p, b );
+	USER_Stats_Send( p );
+}
+
+static void USER_Stats_Power( void ){
+	char *p;
+
+	p = USER_Fmt_Str( USER_Stats_Line, "PWR " );
+	p = USER_Fmt_Uint( p, USER_Power_Average_uA( ) );
+	USER_Stats_Send( p );
+	USER_Stats_Power_Field( "sleep", USER_Power_Stats.sleeps, ( uint32_t )( USER_Power_Stats.sleep_us / 1000U ) );
+	USER_Stats_Power_Field( "stop", USER_Power_Stats.stops, ( uint32_t )( USER_Power_Stats.stop_us / 1000U ) );
+	USER_Stats_Power_Field( "wake", USER_Power_Stats.wake_last_us, USER_Power_Stats.wake_max_us );
+	USER_Stats_Send( USER_Fmt_Str( USER_Stats_Line, "\r\n" ) );
+}
+
+static void USER_Stats_Pools( void ){
+	const USER_Pool_t *pool;
+	char *p;
+
+	USER_Stats_Send( USER_Fmt_Str( USER_Stats_Line, "POOL" ) );
+	for( uint8_t i = 0; ( pool = USER_Pool_Get( i ) ) != NULL; i++ ){
+		p = USER_Fmt_Char( USER_Stats_Line, ' ' );
+		p = USER_Fmt_Str( p, pool->name );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, pool->blocks );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, pool->in_use );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, pool->peak );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, pool->fails );
+		USER_Stats_Send( p );
+	}
+	USER_Stats_Send( USER_Fmt_Str( USER_Stats_Line, "\r\n" ) );
+}
+
+static void USER_Stats_Link( void ){
+	static TractorLink_State_t *state = NULL;//	Newest reported, held until a newer one arrives
+	TractorLink_State_t *next;
+	char *p;
+
+	if( xQueueReceive( USER_Stats_State_Queue, &next, 0 ) == pdPASS ){
+		if( state != NULL )
+			USER_Pool_Release( USER_Stats_State_Pool, state );
+		state = next;
+	}
+
+	p = USER_Fmt_Str( USER_Stats_Line, "LINK " );
+	p = USER_Fmt_Uint( p, USER_Link_Stats.baud );
+	p = USER_Fmt_Str( p, " sync:" );
+	p = USER_Fmt_Uint( p, USER_Link_Stats.sync_rtt_us );
+	p = USER_Fmt_Char( p, ':' );
+	p = USER_Fmt_Int( p, USER_Link_Stats.sync_skew_ppm );
+	USER_Stats_Send( p );
+	p = USER_Fmt_Str( USER_Stats_Line, " traces:" );
+	p = USER_Fmt_Uint( p, USER_Link_Stats.traces );
+	if( state != NULL ){
+		p = USER_Fmt_Str( p, " state:" );
+		p = USER_Fmt_Int( p, state->velocity_x100 );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, state->rpm );
+		p = USER_Fmt_Char( p, ':' );
+		p = USER_Fmt_Uint( p, state->gear );
+	}
+	p = USER_Fmt_Str( p, "\r\n" );
+	USER_Stats_Send( p );
+}
+
+void USER_Stats_Task( void *pvParameters ){
+	TickType_t last_wake = xTaskGetTickCount( );
+	TickType_t wait;
+	uint32_t command;
+	configRUN_TIME_COUNTER_TYPE total;
+	configRUN_TIME_COUNTER_TYPE previous_total = 0;
+	configRUN_TIME_COUNTER_TYPE elapsed;
+	configRUN_TIME_COUNTER_TYPE delta[ USER_STATS_MAX_TASKS ];
+	UBaseType_t count;
+	UBaseType_t i;
+	uint32_t permille;
+	char *p;
+
+	( void )pvParameters;
+
+	for(;;){
+		/* Wait for the next report, serving console commands in between */
+		wait = last_wake + pdMS_TO_TICKS( USER_STATS_PERIOD_MS ) - xTaskGetTickCount( );
+		if( wait <= pdMS_TO_TICKS( USER_STATS_PERIOD_MS ) &&
+			xTaskNotifyWait( 0U, UINT32_MAX, &command, wait ) == pdTRUE ){
+			USER_Stats_Command( command );
+			continue;
+		}
+		last_wake += pdMS_TO_TICKS( USER_STATS_PERIOD_MS );
+
+		count = uxTaskGetSystemState( USER_Stats_Status, USER_STATS_MAX_TASKS, &total );
+		elapsed = total - previous_total;
+		previous_total = total;
+		for( i = 0; i < count; i++ )
+			delta[ i ] = USER_Stats_Delta( &USER_Stats_Status[ i ] );
+		if( elapsed == 0 )
+			continue;
+
+		/* Sampled first, the UART takes a few ms and must not show up in this line */
+		p = USER_Fmt_Str( USER_Stats_Line, "STATS " );
+		p = USER_Fmt_Uint( p, last_wake * portTICK_PERIOD_MS );
+		p = USER_Fmt_Char( p, ' ' );
+		p = USER_Fmt_Uint( p, xPortGetFreeHeapSize( ) );
+		p = USER_Fmt_Char( p, ' ' );
+		p = USER_Fmt_Uint( p, xPortGetMinimumEverFreeHeapSize( ) );
+		USER_Stats_Send( p );
+		for( i = 0; i < count; i++ ){
+			permille = ( uint32_t )( ( ( uint64_t )delta[ i ] * 1000U ) / elapsed );
+			p = USER_Fmt_Char( USER_Stats_Line, ' ' );
+			p = USER_Fmt_Str( p, USER_Stats_Status[ i ].pcTaskName );//	at most configMAX_TASK_NAME_LEN - 1
+			p = USER_Fmt_Char( p, ':' );
+			p = USER_Fmt_Uint( p, permille );
+			p = USER_Fmt_Char( p, ':' );
+			p = USER_Fmt_Uint( p, USER_Stats_Status[ i ].usStackHighWaterMark );
+			USER_Stats_Send( p );
+		}
+		USER_Stats_Send( USER_Fmt_Str( USER_Stats_Line, "\r\n" ) );
+		USER_Stats_Jobs( );
+		USER_Stats_Power( );
+		USER_Stats_Pools( );
+		USER_Stats_Link( );
+	}
+}
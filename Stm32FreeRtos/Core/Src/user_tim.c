@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include "main.h"
 #include "user_tim.h"
+#include "user_trace.h"
+#include "user_prof.h"
 
 void USER_TIM3_PWM_Init( void ){
 	/* STEP 0. Enable the clock signal for the TIM3 and GPIOB peripherals */
@@ -49,7 +51,7 @@ void USER_TIM3_PWM_Init( void ){
 
 	/* STEP 3. Configure the prescaler, the period and the duty cycle register values */
 	TIM3->PSC			 = 0U;
-	TIM3->ARR			 = 47999U;//	for 1 KHz frequency
+	TIM3->ARR			 = USER_TIM3_ARR;//	for 1 KHz frequency
 	///////////////////////////////////////////////////////////////////////
 	TIM3->CCR1		 = USER_Duty_Cycle( 0 );//	for 25% of duty cycle
 	TIM3->CCR2		 = USER_Duty_Cycle( 0 );//	for 25% of duty cycle
@@ -123,6 +125,61 @@ void USER_TIM3_PWM_Init( void ){
 	TIM3->CR1			|=  ( 0x1UL <<  0U );
 }
 
+/* Control loop hook run from the TIM3 update interrupt, once per PWM period */
+static void ( *USER_TIM3_Control )( void ) = 0;
+static uint32_t USER_TIM3_Last_us = 0;
+static volatile uint8_t USER_TIM3_Resync = 0;
+USER_Jitter_Stats_t USER_TIM3_Jitter = { 0, UINT32_MAX, 0, 0, 0 };
+
+void USER_TIM3_Attach_Control( void ( *hook )( void ) ){
+	USER_TIM3_Control = hook;
+	TIM3->SR			&= ~( 0x1UL <<  0U );
+	TIM3->DIER		|=  ( 0x1UL <<  0U );//		Update interrupt at every PWM period
+	NVIC_SetPriority( TIM3_IRQn, 0 );//	Highest priority, the loop must not drift
+	NVIC->ISER[0] = ( 0x1UL << 16U );//	TIM3 interrupt
+}
+
+/* The next period is not measured, the counter was stopped in between (STOP mode, user_power.c) */
+void USER_TIM3_Jitter_Restart( void ){
+	USER_TIM3_Resync = 1;
+}
+
+USER_RAMFUNC void TIM3_IRQHandler( void ){
+	uint32_t now;
+	uint32_t period;
+	uint32_t jitter;
+
+	PROF_BEGIN( PROF_TIM3 );
+	USER_TRACE_ISR_BEGIN( TIM3_IRQn );
+	now = USER_Micros( );
+	if( TIM3->SR & ( 0x1UL << 0U ) ){
+		TIM3->SR &= ~( 0x1UL << 0U );
+
+		/* Distance between two consecutive loop entries against the nominal PWM period */
+		if( USER_TIM3_Jitter.count && !USER_TIM3_Resync ){
+			period = now - USER_TIM3_Last_us;
+			jitter = ( period > USER_TIM3_PERIOD_US ) ? period - USER_TIM3_PERIOD_US
+													  : USER_TIM3_PERIOD_US - period;
+			USER_TIM3_Jitter.last = jitter;
+			if( period < USER_TIM3_Jitter.min_period ) USER_TIM3_Jitter.min_period = period;
+			if( period > USER_TIM3_Jitter.max_period ) USER_TIM3_Jitter.max_period = period;
+			if( jitter > USER_TIM3_Jitter.max_jitter ) USER_TIM3_Jitter.max_jitter = jitter;
+		}
+		USER_TIM3_Last_us = now;
+		USER_TIM3_Resync = 0;
+		USER_TIM3_Jitter.count++;
+
+		/* CCRx are preloaded, whatever the loop writes is latched on the next UEV */
+		if( USER_TIM3_Control )
+			USER_TIM3_Control( );
+	}
+	USER_TRACE_ISR_END( TIM3_IRQn );
+	PROF_END( PROF_TIM3 );
+}
+
+/* High half of the microsecond timebase, incremented on every TIM14 overflow */
+static volatile uint16_t USER_TIM14_Overflows = 0;
+
 void USER_TIM14_Init(void) {
 	RCC->APBENR2 |=  (0x1UL <<  15U);
 	TIM14->SMCR	 &= ~( 0x1UL << 16U)
@@ -130,23 +187,95 @@ void USER_TIM14_Init(void) {
 	TIM14->CR1	 &= ~( 0x1UL << 7U)
 				 &  ~( 0x3UL << 5U)
 				 &  ~( 0x1UL << 4U)
+				 &  ~( 0x1UL << 3U)//		Free-running, no one-pulse mode
 				 &  ~( 0x1UL << 1U);
+	TIM14->CR1	 |=  ( 0x1UL << 2U);//		Only the overflow raises UIF
+	TIM14->PSC	  =  47U;//					48 MHz / (47+1) = 1 MHz, 1 tick = 1 us
+	TIM14->ARR	  =  0xFFFFU;//				Full 16-bit range, overflow every 65.536 ms
+	TIM14->EGR	 |=  ( 0x1UL << 0U);//		Load PSC and ARR
+	TIM14->SR	 &= ~( 0x1UL << 0U);
+	TIM14->DIER	 |=  ( 0x1UL << 0U);//		Update interrupt extends the count to 32 bits
+	NVIC->ISER[0] = ( 0x1UL << 19U );//	TIM14 interrupt
+	TIM14->CR1	 |=  ( 0x1UL << 0U);//		Counter enabled, never stopped again
 }
 
-void USER_TIM14_Delay(uint16_t us) {
-    TIM14->CR1 &= ~(1UL << 0);           // Deshabilita el timer
+/* One-shot hook on the TIM14 channel 1 compare, armed by USER_TIM14_Compare_In */
+static void ( *USER_TIM14_Compare )( void ) = 0;
 
-    TIM14->PSC = 47;                     // Prescaler: (48 MHz / (47+1)) = 1 MHz → 1 tick = 1 µs
-    TIM14->ARR = us;                     // Número de microsegundos a esperar
+void USER_TIM14_Attach_Compare( void ( *hook )( void ) ){
+	USER_TIM14_Compare = hook;
+}
 
-    TIM14->EGR |= (1UL << 0);            // Generar evento de actualización
-    TIM14->SR &= ~(1UL << 0);            // Limpia bandera de actualización
-    TIM14->CR1 |= (1UL << 0);            // Habilita el timer
+/* Runs the compare hook from the TIM14 interrupt 'us' from now */
+void USER_TIM14_Compare_In( uint16_t us ){
+	TIM14->CCR1	  =  ( uint16_t )( TIM14->CNT + us );
+	TIM14->SR	  = ~( 0x1UL << 1U );//		rc_w0, only CC1IF is cleared
+	TIM14->DIER	 |=  ( 0x1UL << 1U );//		CC1 interrupt enabled
+}
 
-    while (!(TIM14->SR & (1UL << 0)));   // Espera a que llegue el overflow
+void TIM14_IRQHandler(void) {
+	/* Flags cleared by writing the others as 1, a read-modify-write could drop the one just raised */
+	if( TIM14->SR & ( 0x1UL << 0U ) ){
+		TIM14->SR = ~( 0x1UL << 0U );
+		USER_TIM14_Overflows++;
+	}
+	if( ( TIM14->DIER & ( 0x1UL << 1U ) ) && ( TIM14->SR & ( 0x1UL << 1U ) ) ){
+		TIM14->SR = ~( 0x1UL << 1U );
+		TIM14->DIER	&= ~( 0x1UL << 1U );//	One-shot
+		if( USER_TIM14_Compare )
+			USER_TIM14_Compare( );
+	}
+}
 
-    TIM14->CR1 &= ~(1UL << 0);           // Deshabilita el timer
-    TIM14->SR &= ~(1UL << 0);            // Limpia bandera nuevamente
+/* Microseconds since USER_TIM14_Init, wraps after ~71 minutes. Safe from tasks and ISRs */
+USER_RAMFUNC uint32_t USER_Micros(void) {
+	uint32_t primask;
+	uint32_t high;
+	uint32_t low;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	high = USER_TIM14_Overflows;
+	low  = TIM14->CNT;
+	/* Overflow already happened but its interrupt has not run yet */
+	if( ( TIM14->SR & ( 0x1UL << 0U ) ) && low < 0x8000U )
+		high++;
+	__set_PRIMASK( primask );
+
+	return ( high << 16U ) | low;
+}
+
+/* Moves USER_Micros forward by the 'us' TIM14 missed while its clock was stopped (STOP mode, user_power.c) */
+void USER_TIM14_Advance(uint32_t us) {
+	uint32_t primask;
+	uint32_t now;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	now = USER_Micros( ) + us;
+	TIM14->CR1	&= ~( 0x1UL << 0U);
+	TIM14->CNT	  =  now & 0xFFFFU;
+	USER_TIM14_Overflows = ( uint16_t )( now >> 16U );
+	TIM14->SR	&= ~( 0x1UL << 0U);//		A pending overflow is already in the new count
+	TIM14->CR1	|=  ( 0x1UL << 0U);
+	__set_PRIMASK( primask );
+}
+
+/* Busy-wait for at least 'us' microseconds on the free-running TIM14 */
+void USER_Delay_us(uint32_t us) {
+	uint16_t start;
+	uint32_t start32;
+
+	if( us < 0x8000U ) {
+		/* Short delays only need the 16-bit counter, no interrupt masking. Kept
+		 * below half its range so a reading delayed by an interrupt still lands
+		 * past 'us' instead of wrapping around for another 65 ms. */
+		start = TIM14->CNT;
+		while( (uint16_t)( TIM14->CNT - start ) <= us );
+	} else {
+		start32 = USER_Micros( );
+		while( ( USER_Micros( ) - start32 ) <= us );
+	}
 }
 
 void USER_TIM17_Init_Timer( void ){
@@ -160,6 +289,33 @@ void USER_TIM17_Init_Timer( void ){
 }
 
 
+/* CPU cycles since 'start', a SysTick->VAL reading less than one RTOS tick ago */
+USER_RAMFUNC uint32_t USER_Cycles_Since( uint32_t start ){
+	uint32_t end = SysTick->VAL;
+
+	/* SysTick counts down and reloads every RTOS tick */
+	if( start >= end )
+		return start - end;
+	return start + ( SysTick->LOAD + 1U ) - end;
+}
+
+/* Cycles spent in the last USER_TIM3_Set_Duty4 call, measured on SysTick */
+volatile uint32_t USER_TIM3_Update_Cycles = 0;
+
+/* Loads the four CCRs so they are latched together on the same update event */
+USER_RAMFUNC void USER_TIM3_Set_Duty4( const uint16_t ccr[ 4 ] ){
+	uint32_t start;
+
+	start = SysTick->VAL;
+	TIM3->CR1			|=  ( 0x1UL <<  1U );//		UEV disabled, the shadow CCRs keep their value
+	TIM3->CCR1		 = ccr[ 0 ];
+	TIM3->CCR2		 = ccr[ 1 ];
+	TIM3->CCR3		 = ccr[ 2 ];
+	TIM3->CCR4		 = ccr[ 3 ];
+	TIM3->CR1			&= ~( 0x1UL <<  1U );//		UEV enabled, all four are loaded on the next one
+	USER_TIM3_Update_Cycles = USER_Cycles_Since( start );
+}
+
 void update_cycle(uint8_t duty, uint8_t pin){
 	switch(pin){
 	case 1:
@@ -181,9 +337,17 @@ void update_cycle(uint8_t duty, uint8_t pin){
 }
 
 uint16_t USER_Duty_Cycle( uint8_t duty ){
-	/* duty can be a value between 0% and 100% */
+	/* duty can be a value between 0% and 100%, one multiply, no software floating point */
 	if( duty <= 100 )
-		return (( duty / 100.0 )*( TIM3->ARR + 1));
+		return duty * USER_TIM3_COUNTS_PER_PERCENT;
+	else
+		return 0;
+}
+
+USER_RAMFUNC uint16_t USER_Duty_Cycle_Permille( uint16_t permille ){
+	/* permille can be a value between 0 and 1000, 0.1% steps of 48 counts */
+	if( permille <= 1000U )
+		return permille * USER_TIM3_COUNTS_PER_PERMILLE;
 	else
 		return 0;
 }
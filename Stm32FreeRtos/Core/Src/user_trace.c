@@ -0,0 +1,99 @@
+#include <stdint.h>
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "user_tim.h"
+#include "user_uart.h"
+#include "user_trace.h"
+#include "user_fmt.h"
+
+/*
+ * Ring buffer of the last USER_TRACE_EVENTS kernel and interrupt events, stamped
+ * with the TIM14 microsecond timebase. Old events are overwritten, recording is
+ * paused only while USER_Trace_Dump sends the buffer on USART2:
+ *
+ *   TRACE <events> <lost>
+ *   TASK <number> <name>
+ *   EV <time_us:8 hex><type:2 hex><id:2 hex><arg:4 hex>
+ *   END
+ *
+ * Tools/trace_to_chrome.py turns the dump into Chrome trace / Perfetto JSON.
+ */
+
+static USER_Trace_Event_t USER_Trace_Ring[ USER_TRACE_EVENTS ];
+static volatile uint32_t USER_Trace_Head = 0;
+static volatile uint8_t USER_Trace_Paused = 0;
+static const char *USER_Trace_Names[ USER_TRACE_MAX_TASKS ];
+static char USER_Trace_Line[ 32 ];
+
+volatile uint32_t USER_Trace_IRQ_Mask = USER_TRACE_IRQ_DEFAULT;
+
+USER_RAMFUNC void USER_Trace_Record( uint8_t type, uint8_t id, uint16_t arg ){
+	uint32_t primask;
+	USER_Trace_Event_t *event;
+
+	if( USER_Trace_Paused )
+		return;
+
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	event = &USER_Trace_Ring[ USER_Trace_Head & ( USER_TRACE_EVENTS - 1U ) ];
+	USER_Trace_Head++;
+	event->time_us = USER_Micros( );
+	event->type = type;
+	event->id = id;
+	event->arg = arg;
+	__set_PRIMASK( primask );
+}
+
+/* Called from traceTASK_CREATE, the name lives in the TCB for the life of the task */
+void USER_Trace_Task_Name( uint8_t id, const char *name ){
+	if( id < USER_TRACE_MAX_TASKS )
+		USER_Trace_Names[ id ] = name;
+}
+
+/* 'end' is what the last USER_Fmt_ call returned */
+static void USER_Trace_Send( const char *end ){
+	USER_UART2_Transmit( ( uint8_t * )USER_Trace_Line, ( uint16_t )( end - USER_Trace_Line ) );
+}
+
+/* Sends the ring oldest first on the debug UART, then starts recording again */
+void USER_Trace_Dump( void ){
+	uint32_t head;
+	uint32_t count;
+	uint32_t i;
+	const USER_Trace_Event_t *event;
+	char *p;
+
+	USER_Trace_Paused = 1;
+	head = USER_Trace_Head;
+	count = ( head < USER_TRACE_EVENTS ) ? head : USER_TRACE_EVENTS;
+
+	p = USER_Fmt_Str( USER_Trace_Line, "TRACE " );
+	p = USER_Fmt_Uint( p, count );
+	p = USER_Fmt_Char( p, ' ' );
+	p = USER_Fmt_Uint( p, head - count );
+	USER_Trace_Send( USER_Fmt_Str( p, "\r\n" ) );
+	for( i = 0; i < USER_TRACE_MAX_TASKS; i++ ){
+		if( USER_Trace_Names[ i ] ){
+			p = USER_Fmt_Str( USER_Trace_Line, "TASK " );
+			p = USER_Fmt_Uint( p, i );
+			p = USER_Fmt_Char( p, ' ' );
+			p = USER_Fmt_Str( p, USER_Trace_Names[ i ] );
+			USER_Trace_Send( USER_Fmt_Str( p, "\r\n" ) );
+		}
+	}
+	for( i = head - count; i != head; i++ ){
+		event = &USER_Trace_Ring[ i & ( USER_TRACE_EVENTS - 1U ) ];
+		p = USER_Fmt_Str( USER_Trace_Line, "EV " );
+		p = USER_Fmt_Hex( p, event->time_us, 8 );
+		p = USER_Fmt_Hex( p, event->type, 2 );
+		p = USER_Fmt_Hex( p, event->id, 2 );
+		p = USER_Fmt_Hex( p, event->arg, 4 );
+		USER_Trace_Send( USER_Fmt_Str( p, "\r\n" ) );
+	}
+	USER_Trace_Send( USER_Fmt_Str( USER_Trace_Line, "END\r\n" ) );
+
+	USER_Trace_Head = 0;
+	USER_Trace_Paused = 0;
+}
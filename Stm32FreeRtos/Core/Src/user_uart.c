@@ -1,7 +1,16 @@
 #include "main.h"
 #include "user_uart.h"
 
-
+/*
+ * USART1 sends from a ring: USER_UART1_Transmit copies the frame and enables
+ * TXEIE, the USART1 interrupt writes one byte per TXE (USER_UART1_Tx_Next).
+ * A frame that does not fit is dropped whole and counted, the link protocol
+ * resynchronizes on the next delimiter anyway.
+ */
+static uint8_t USER_UART1_Tx_Buffer[ USER_UART1_TX_SIZE ];
+static volatile uint16_t USER_UART1_Tx_Head = 0;//	Written by the task
+static volatile uint16_t USER_UART1_Tx_Tail = 0;//	Written by the ISR
+volatile uint32_t USER_UART1_Tx_Dropped = 0;
 
 void USER_UART1_Init(void) {
     // Activar reloj de GPIOA y USART1
@@ -16,8 +25,13 @@ void USER_UART1_Init(void) {
     GPIOA->MODER &= ~((0x3 << 18) | (0x3 << 20));
     GPIOA->MODER |=  (0x2 << 18) | (0x2 << 20);
 
+    // Reloj del USART1: HSIKER sin división (48 MHz, el mismo BRR), el único que puede despertar de STOP
+    RCC->CR &= ~(0x7UL << 5U);                                  // HSIKERDIV = 1
+    RCC->CCIPR = (RCC->CCIPR & ~(0x3UL << 0U)) | (0x2UL << 0U); // USART1SEL = HSIKER
+
     // Configuración USART1: 8 bits, 1 stop bit, baudrate
     USART1->CR1 &= ~((1 << 28) | (1 << 12));
+    USART1->CR1 |= (1 << 1);  // UESM: un byte recibido despierta de STOP (user_power.c)
     USART1->CR2 &= ~(0x3 << 12);
     USART1->BRR  = 5000;  // Para 9600 baudios @ 48 MHz
 
@@ -65,13 +79,65 @@ int _write(int file, char *ptr, int len){
 }
 ///////////////////////////////////////////////////////////////////////////////////////
 
-static void USER_UART1_Send_8bit( uint8_t Data ){
-	while(!( USART1->ISR & ( 0x1UL <<  7U)));//	wait until next data can be written
-	USART1->TDR = Data;// Data to send
+/* Changes the USART1 rate once the last frame has left the shift register */
+void USER_UART1_Set_Baud( uint32_t baud ){
+	while( !USER_UART1_Tx_Idle( ) );
+	USART1->CR1 &= ~( 0x1UL <<  0U );//	USART disabled, BRR is only writable with UE = 0
+	USART1->BRR  =  ( 48000000UL + baud / 2U ) / baud;//	Nearest divider, 52 for 921600 (+0.16%)
+	USART1->CR1 |=  ( 0x1UL <<  0U );
 }
 
+/* Bytes still in the ring, the one in the shift register not counted */
+uint16_t USER_UART1_Tx_Pending( void ){
+	return ( uint16_t )( ( USER_UART1_Tx_Head - USER_UART1_Tx_Tail ) & ( USER_UART1_TX_SIZE - 1U ) );
+}
+
+/* Ring empty and the last byte out of the shift register */
+uint8_t USER_UART1_Tx_Idle( void ){
+	return USER_UART1_Tx_Head == USER_UART1_Tx_Tail && ( USART1->ISR & ( 0x1UL <<  6U ) );//	TC
+}
+
+/* Queues the whole frame or nothing, never waits for the line */
 void USER_UART1_Transmit( uint8_t *pData, uint16_t size ){
+	uint16_t head = USER_UART1_Tx_Head;
+	uint32_t primask;
+
+	if( size > USER_UART1_TX_SIZE - 1U - USER_UART1_Tx_Pending( ) ){
+		USER_UART1_Tx_Dropped++;
+		return;
+	}
+	while( size-- ){
+		USER_UART1_Tx_Buffer[ head ] = *pData++;
+		head = ( head + 1U ) & ( USER_UART1_TX_SIZE - 1U );
+	}
+	USER_UART1_Tx_Head = head;
+
+	/* The ISR clears TXEIE when the ring runs empty */
+	primask = __get_PRIMASK( );
+	__disable_irq( );
+	USART1->CR1 |=  ( 0x1UL <<  7U );//	TXEIE
+	__set_PRIMASK( primask );
+}
+
+/* USART1 interrupt, TXE: next byte of the ring, or stop the interrupt */
+USER_RAMFUNC void USER_UART1_Tx_Next( void ){
+	uint16_t tail = USER_UART1_Tx_Tail;
+
+	if( tail == USER_UART1_Tx_Head ){
+		USART1->CR1 &= ~( 0x1UL <<  7U );//	TXEIE
+		return;
+	}
+	USART1->TDR = USER_UART1_Tx_Buffer[ tail ];
+	USER_UART1_Tx_Tail = ( tail + 1U ) & ( USER_UART1_TX_SIZE - 1U );
+}
+
+static void USER_UART2_Send_8bit( uint8_t Data ){
+	while(!( USART2->ISR & ( 0x1UL <<  7U)));//	wait until next data can be written
+	USART2->TDR = Data;// Data to send
+}
+
+void USER_UART2_Transmit( uint8_t *pData, uint16_t size ){
 	for( int i = 0; i < size; i++ ){
-		USER_UART1_Send_8bit( *pData++ );
+		USER_UART2_Send_8bit( *pData++ );
 	}
 }
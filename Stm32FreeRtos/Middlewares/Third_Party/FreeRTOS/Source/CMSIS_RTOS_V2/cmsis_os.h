@@ -1,34 +0,0 @@
-/*
- * Copyright (c) 2013-2019 ARM Limited. All rights reserved.
- *
- * SPDX-License-Identifier: Apache-2.0
- *
- * Licensed under the Apache License, Version 2.0 (the License); you may
- * not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an AS IS BASIS, WITHOUT
- * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- *
- * ----------------------------------------------------------------------
- *
- * $Date:        10. January 2017
- * $Revision:    V2.1.0
- *
- * Project:      CMSIS-RTOS API
- * Title:        cmsis_os.h FreeRTOS header file
- *---------------------------------------------------------------------------*/
-
-#ifndef CMSIS_OS_H_
-#define CMSIS_OS_H_
-
-#define osCMSIS               0x20001U  ///< API version (main[31:16].sub[15:0])
-
-#include "cmsis_os2.h"
-
-#endif  // CMSIS_OS_H_
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+RAM budget report for the STM32C031 (12 KB) build
+Reads the GNU ld map file written by STM32CubeIDE (Debug/Stm32FreeRtos.map)
+and lists what every object and input section takes from RAM.
+
+    python3 Tools/ram_budget.py Debug/Stm32FreeRtos.map
+    python3 Tools/ram_budget.py Debug/Stm32FreeRtos.map --top 30 --by object
+"""
+
+import argparse
+import re
+import sys
+from collections import defaultdict
+
+HEX = r"0x[0-9a-fA-F]+"
+MEMORY_LINE = re.compile(rf"^(\w+)\s+({HEX})\s+({HEX})\s+\S+")
+OUTPUT_SECTION = re.compile(rf"^(\.[\w.]+|[A-Za-z_][\w.]*)\s+({HEX})\s+({HEX})")
+OUTPUT_SECTION_NAME = re.compile(r"^(\.[\w.]+)\s*$")
+INPUT_SECTION = re.compile(rf"^ (\S+)\s+({HEX})\s+({HEX})\s+(\S.*)$")
+INPUT_SECTION_NAME = re.compile(r"^ (\S+)\s*$")
+INPUT_CONTINUATION = re.compile(rf"^\s+({HEX})\s+({HEX})\s+(\S.*)$")
+
+
+def parse_memory(lines):
+    """Regions declared in the 'Memory Configuration' block"""
+    regions = {}
+    inside = False
+    for line in lines:
+        if line.startswith("Memory Configuration"):
+            inside = True
+            continue
+        if inside and line.startswith("Linker script and memory map"):
+            break
+        match = MEMORY_LINE.match(line) if inside else None
+        if match and match.group(1) != "Name":
+            regions[match.group(1)] = (int(match.group(2), 16), int(match.group(3), 16))
+    return regions
+
+
+def parse_sections(lines, start, length):
+    """Output and input sections placed in [start, start + length)"""
+    outputs = {}
+    entries = []
+    output = None
+    pending = None
+    end = start + length
+    mapped = False
+
+    for line in lines:
+        if line.startswith("Linker script and memory map"):
+            mapped = True
+            continue
+        if not mapped:
+            continue
+
+        match = OUTPUT_SECTION.match(line)
+        if match:
+            output = match.group(1)
+            pending = None
+            address, size = int(match.group(2), 16), int(match.group(3), 16)
+            if size and start <= address < end:
+                outputs[output] = size
+            continue
+        match = OUTPUT_SECTION_NAME.match(line)
+        if match:
+            output = match.group(1)
+            pending = output
+            continue
+
+        # Long input section names push address, size and object to the next line
+        if pending is not None:
+            match = INPUT_CONTINUATION.match(line)
+            pending_name, pending = pending, None
+            if match and pending_name == output:
+                # Output section with a long name, e.g. ._user_heap_stack
+                address, size = int(match.group(1), 16), int(match.group(2), 16)
+                if size and start <= address < end:
+                    outputs[output] = size
+                continue
+            if match:
+                address, size, obj = int(match.group(1), 16), int(match.group(2), 16), match.group(3)
+                if size and start <= address < end:
+                    entries.append((output, pending_name, obj.strip(), size))
+                continue
+
+        match = INPUT_SECTION.match(line)
+        if match and not match.group(1).startswith("*"):
+            address, size = int(match.group(2), 16), int(match.group(3), 16)
+            if size and start <= address < end:
+                entries.append((output, match.group(1), match.group(4).strip(), size))
+            continue
+        match = INPUT_SECTION_NAME.match(line)
+        if match and not match.group(1).startswith("*"):
+            pending = match.group(1)
+
+    return outputs, entries
+
+
+def short_object(obj):
+    """./Core/Src/main.o -> main.o, libc_nano.a(lib_a-impure.o) -> libc_nano.a(impure.o)"""
+    obj = obj.split("/")[-1]
+    return obj.replace("lib_a-", "")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="RAM budget from a GNU ld map file")
+    parser.add_argument("map", help="map file, e.g. Debug/Stm32FreeRtos.map")
+    parser.add_argument("--region", default="RAM", help="memory region name (default RAM)")
+    parser.add_argument("--by", choices=("section", "object"), default="section",
+                        help="group the detail table per input section or per object")
+    parser.add_argument("--top", type=int, default=20, help="rows in the detail table")
+    args = parser.parse_args()
+
+    with open(args.map, encoding="utf-8", errors="replace") as file:
+        lines = file.read().splitlines()
+
+    regions = parse_memory(lines)
+    if args.region not in regions:
+        sys.exit(f"region {args.region} not found in {args.map}")
+    start, length = regions[args.region]
+    outputs, entries = parse_sections(lines, start, length)
+    used = sum(outputs.values())
+
+    # Space not claimed by any input section: alignment, MSP stack and newlib heap reserve
+    claimed = defaultdict(int)
+    for output, _, _, size in entries:
+        claimed[output] += size
+    for output, size in outputs.items():
+        if size > claimed[output]:
+            entries.append((output, f"{output} (reserved)", "linker script", size - claimed[output]))
+
+    print(f"{args.region}: {used} of {length} bytes used, {length - used} free "
+          f"({100.0 * used / length:.1f}%)")
+    # Code copied to RAM (USER_RAMFUNC in main.h), part of .data
+    ramfunc = sum(size for _, name, _, size in entries if name.startswith(".RamFunc"))
+    print(f".RamFunc: {ramfunc} bytes of code in {args.region} ({100.0 * ramfunc / length:.1f}%)")
+    print()
+    print(f"{'output section':<24}{'bytes':>8}")
+    for output, size in sorted(outputs.items(), key=lambda item: -item[1]):
+        print(f"{output:<24}{size:>8}")
+    print()
+
+    if args.by == "object":
+        detail = defaultdict(int)
+        for _, _, obj, size in entries:
+            detail[short_object(obj)] += size
+        rows = [(name, "", size) for name, size in detail.items()]
+    else:
+        rows = [(name, short_object(obj), size) for _, name, obj, size in entries]
+
+    rows.sort(key=lambda row: -row[2])
+    print(f"{'name':<40}{'object':<28}{'bytes':>8}")
+    for name, obj, size in rows[:args.top]:
+        print(f"{name:<40}{obj:<28}{size:>8}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+Run-time stats time series
+Turns the 'STATS ...' lines printed by user_stats.c on the debug UART (USART2,
+115200 8N1) into a CSV with one row per report and one column per task metric.
+
+    python3 Tools/stats_series.py --port /dev/ttyACM0 -o stats.csv
+    python3 Tools/stats_series.py capture.log -o stats.csv
+    python3 Tools/stats_series.py capture.log --plot
+    python3 Tools/stats_series.py capture.log --stacks > /dev/null
+
+Line format: STATS <uptime ms> <free heap> <min free heap> <task>:<cpu permille>:<stack hwm words> ...
+followed by: JOBS <load permille>[!] <job>:<runs>:<misses>:<overruns>:<skipped>:<max exec us>:<max response us> ...
+and:         PWR <avg uA> sleep:<count>:<ms> stop:<count>:<ms> wake:<last us>:<max us>
+and:         POOL <pool>:<blocks>:<in use>:<peak>:<fails> ...
+and:         LINK <baud> sync:<rtt us>:<skew ppm> traces:<count> [state:<velocity x100>:<rpm>:<gear>]
+whose columns are added to the row of the STATS line before them.
+"""
+
+import argparse
+import csv
+import sys
+
+
+def parse_line(line):
+    """One report as a flat dict, or None for anything that is not a STATS line"""
+    fields = line.strip().split()
+    if len(fields) < 4 or fields[0] != "STATS":
+        return None
+    try:
+        row = {
+            "time_ms": int(fields[1]),
+            "heap_free": int(fields[2]),
+            "heap_min": int(fields[3]),
+        }
+        prefix = ""
+        for field in fields[4:]:
+            # "Tmr Svc" has a space, glue the pieces back until the ':' fields show up
+            if field.count(":") < 2:
+                prefix += field + "_"
+                continue
+            name, cpu, hwm = (prefix + field).rsplit(":", 2)
+            prefix = ""
+            row[f"{name}.cpu_pct"] = int(cpu) / 10.0
+            row[f"{name}.stack_hwm"] = int(hwm)
+    except ValueError:
+        return None
+    return row
+
+
+JOB_FIELDS = ("runs", "misses", "overruns", "skipped", "max_exec_us", "max_response_us")
+
+
+def parse_jobs(line):
+    """Job columns of a JOBS line, or None for anything else"""
+    fields = line.strip().split()
+    if len(fields) < 2 or fields[0] != "JOBS":
+        return None
+    try:
+        row = {"jobs.load_pct": int(fields[1].rstrip("!")) / 10.0,
+               "jobs.unschedulable": int(fields[1].endswith("!"))}
+        for field in fields[2:]:
+            name, *values = field.split(":")
+            if len(values) != len(JOB_FIELDS):
+                return None
+            for key, value in zip(JOB_FIELDS, values):
+                row[f"{name}.{key}"] = int(value)
+    except ValueError:
+        return None
+    return row
+
+
+PWR_FIELDS = {
+    "sleep": ("count", "ms"),
+    "stop": ("count", "ms"),
+    "wake": ("last_us", "max_us"),
+}
+
+
+def parse_pwr(line):
+    """Tickless idle columns of a PWR line, or None for anything else"""
+    fields = line.strip().split()
+    if len(fields) < 2 or fields[0] != "PWR":
+        return None
+    try:
+        row = {"pwr.avg_ua": int(fields[1])}
+        for field in fields[2:]:
+            name, *values = field.split(":")
+            keys = PWR_FIELDS.get(name)
+            if keys is None or len(values) != len(keys):
+                return None
+            for key, value in zip(keys, values):
+                row[f"pwr.{name}.{key}"] = int(value)
+    except ValueError:
+        return None
+    return row
+
+
+POOL_FIELDS = ("blocks", "in_use", "peak", "fails")
+
+
+def parse_pool(line):
+    """Pool columns of a POOL line, or None for anything else"""
+    fields = line.strip().split()
+    if not fields or fields[0] != "POOL":
+        return None
+    row = {}
+    try:
+        for field in fields[1:]:
+            name, *values = field.split(":")
+            if len(values) != len(POOL_FIELDS):
+                return None
+            for key, value in zip(POOL_FIELDS, values):
+                row[f"pool.{name}.{key}"] = int(value)
+    except ValueError:
+        return None
+    return row
+
+
+LINK_FIELDS = {
+    "sync": ("rtt_us", "skew_ppm"),
+    "traces": ("count",),
+    "state": ("velocity_x100", "rpm", "gear"),
+}
+
+
+def parse_link(line):
+    """ESP32 link columns of a LINK line, or None for anything else"""
+    fields = line.strip().split()
+    if len(fields) < 2 or fields[0] != "LINK":
+        return None
+    try:
+        row = {"link.baud": int(fields[1])}
+        for field in fields[2:]:
+            name, *values = field.split(":")
+            keys = LINK_FIELDS.get(name)
+            if keys is None or len(values) != len(keys):
+                return None
+            for key, value in zip(keys, values):
+                row[f"link.{name}.{key}"] = int(value)
+    except ValueError:
+        return None
+    return row
+
+
+def read_lines(args):
+    if args.port:
+        import serial  # pyserial, only needed for live capture
+        with serial.Serial(args.port, args.baud, timeout=1) as port:
+            while True:
+                raw = port.readline()
+                if raw:
+                    yield raw.decode("ascii", errors="replace")
+    elif args.input == "-":
+        yield from sys.stdin
+    else:
+        with open(args.input, encoding="ascii", errors="replace") as file:
+            yield from file
+
+
+def plot(rows, columns):
+    import matplotlib.pyplot as plt
+
+    time_s = [row["time_ms"] / 1000.0 for row in rows]
+    figure, (cpu_axis, stack_axis) = plt.subplots(2, 1, sharex=True)
+    for column in columns:
+        values = [row.get(column) for row in rows]
+        if column.endswith(".cpu_pct"):
+            cpu_axis.plot(time_s, values, label=column[:-len(".cpu_pct")])
+        elif column.endswith(".stack_hwm"):
+            stack_axis.plot(time_s, values, label=column[:-len(".stack_hwm")])
+    cpu_axis.set_ylabel("CPU %")
+    stack_axis.set_ylabel("stack HWM (words)")
+    stack_axis.set_xlabel("uptime (s)")
+    cpu_axis.legend(loc="upper right", fontsize="small")
+    stack_axis.legend(loc="upper right", fontsize="small")
+    figure.tight_layout()
+    plt.show()
+
+
+STACK_SPARE_WORDS = 16  # kept free on top of the deepest use seen
+
+
+def stack_report(rows, out):
+    """Lowest stack high-water mark of every task over the capture, and the words a depth can lose"""
+    lowest = {}
+    for row in rows:
+        for key, value in row.items():
+            if key.endswith(".stack_hwm"):
+                name = key[:-len(".stack_hwm")]
+                lowest[name] = min(value, lowest.get(name, value))
+    out.write(f"{'task':<16} {'min free':>8} {'can trim':>8}  (words, {STACK_SPARE_WORDS} kept spare)\n")
+    for name, free in lowest.items():
+        out.write(f"{name:<16} {free:>8} {free - STACK_SPARE_WORDS:>8}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="STATS lines to a CSV time series")
+    parser.add_argument("input", nargs="?", default="-", help="capture file, '-' for stdin")
+    parser.add_argument("--port", help="read live from a serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("-o", "--output", help="CSV file (default stdout)")
+    parser.add_argument("--plot", action="store_true", help="plot CPU and stack with matplotlib")
+    parser.add_argument("--stacks", action="store_true",
+                        help="print the lowest stack high-water mark per task on stderr, "
+                             "to size the stack depths")
+    args = parser.parse_args()
+
+    rows = []
+    try:
+        for line in read_lines(args):
+            row = parse_line(line)
+            if row is not None:
+                rows.append(row)
+                continue
+            extra = (parse_jobs(line) or parse_pwr(line) or parse_pool(line)
+                     or parse_link(line))
+            if extra is not None and rows:
+                rows[-1].update(extra)
+    except KeyboardInterrupt:
+        pass
+
+    # Tasks can appear later (created after boot), keep the columns in first-seen order
+    columns = ["time_ms", "heap_free", "heap_min"]
+    for row in rows:
+        for key in row:
+            if key not in columns:
+                columns.append(key)
+
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+    try:
+        writer = csv.DictWriter(output, fieldnames=columns)
+        writer.writeheader()
+        writer.writerows(rows)
+    finally:
+        if args.output:
+            output.close()
+
+    if args.stacks:
+        stack_report(rows, sys.stderr)
+
+    if args.plot and rows:
+        plot(rows, columns)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+Kernel trace decoder
+Converts the dump printed by USER_Trace_Dump (send 't' on the debug UART,
+USART2 115200 8N1) into Chrome trace JSON, viewable in chrome://tracing or
+https://ui.perfetto.dev.
+
+    python3 Tools/trace_to_chrome.py capture.log -o trace.json
+    python3 Tools/trace_to_chrome.py --port /dev/ttyACM0 -o trace.json
+
+Tasks become one track each with a slice per time they hold the CPU, from the
+switch in to the switch out. Interrupts get their own track per IRQ, for the
+IRQs in USER_Trace_IRQ_Mask (TIM3 is off by default). Queue, notification and delay events are instants
+on the task that was running, priority inheritance is an instant on the holder.
+"""
+
+import argparse
+import json
+import sys
+
+TASK_IN = 1
+ISR_ENTER = 2
+ISR_EXIT = 3
+QUEUE_SEND = 4
+QUEUE_RECEIVE = 5
+QUEUE_BLOCK_RX = 6
+QUEUE_BLOCK_TX = 7
+QUEUE_SEND_ISR = 8
+NOTIFY_GIVE_ISR = 9
+NOTIFY_TAKE = 10
+NOTIFY_BLOCK = 11
+PRIO_INHERIT = 12
+PRIO_DISINHERIT = 13
+DELAY = 14
+TASK_OUT = 15
+
+INSTANT_NAMES = {
+    QUEUE_SEND: "queue send",
+    QUEUE_RECEIVE: "queue receive",
+    QUEUE_BLOCK_RX: "block on queue receive",
+    QUEUE_BLOCK_TX: "block on queue send",
+    QUEUE_SEND_ISR: "queue send from ISR",
+    NOTIFY_GIVE_ISR: "notify give from ISR",
+    NOTIFY_TAKE: "notify take",
+    NOTIFY_BLOCK: "block on notify",
+    DELAY: "delay",
+}
+
+# STM32C031 vector numbers, the ones this firmware traces plus the usual suspects
+IRQ_NAMES = {
+    7: "EXTI4_15", 9: "DMA1_Ch1", 13: "TIM1_BRK_UP", 16: "TIM3", 19: "TIM14",
+    21: "TIM16", 22: "TIM17", 27: "USART1", 28: "USART2",
+}
+
+PID = 1
+IRQ_TID_BASE = 1000
+
+
+def read_dump(lines):
+    """Task names and (time_us, type, id, arg) tuples of the last complete dump"""
+    names, events, inside = {}, [], False
+    for line in lines:
+        fields = line.strip().split()
+        if not fields:
+            continue
+        if fields[0] == "TRACE":
+            names, events, inside = {}, [], True
+        elif not inside:
+            continue
+        elif fields[0] == "TASK" and len(fields) >= 3:
+            names[int(fields[1])] = " ".join(fields[2:])
+        elif fields[0] == "EV" and len(fields) == 2 and len(fields[1]) == 16:
+            word = fields[1]
+            events.append((int(word[0:8], 16), int(word[8:10], 16),
+                           int(word[10:12], 16), int(word[12:16], 16)))
+        elif fields[0] == "END":
+            return names, events
+    if inside:
+        print("warning: dump not terminated by END, using what arrived", file=sys.stderr)
+    return names, events
+
+
+def unwrap(events):
+    """32-bit microsecond stamps wrap every ~71 minutes, make them monotonic"""
+    offset, previous, result = 0, None, []
+    for time_us, kind, ident, arg in events:
+        if previous is not None and time_us < previous and previous - time_us > 0x80000000:
+            offset += 1 << 32
+        previous = time_us
+        result.append((time_us + offset, kind, ident, arg))
+    return result
+
+
+def to_chrome(names, events):
+    trace = []
+    for number, name in sorted(names.items()):
+        trace.append({"ph": "M", "pid": PID, "tid": number, "name": "thread_name",
+                      "args": {"name": f"{name} ({number})"}})
+        trace.append({"ph": "M", "pid": PID, "tid": number, "name": "thread_sort_index",
+                      "args": {"sort_index": number}})
+
+    seen_irqs = set()
+    current = None
+    current_start = None
+    current_priority = None
+    open_isrs = {}
+    start = events[0][0] if events else 0
+
+    def close_task(at):
+        if current is not None:
+            trace.append({"ph": "X", "pid": PID, "tid": current,
+                          "name": names.get(current, f"task {current}"),
+                          "ts": current_start - start, "dur": at - current_start,
+                          "args": {"priority": current_priority}})
+
+    for time_us, kind, ident, arg in events:
+        ts = time_us - start
+        if kind == TASK_IN:
+            close_task(time_us)
+            current, current_start, current_priority = ident, time_us, arg
+        elif kind == TASK_OUT:
+            # Dumps from before TASK_OUT existed end the slice at the next switch in instead
+            close_task(time_us)
+            current = None
+        elif kind in (ISR_ENTER, ISR_EXIT):
+            tid = IRQ_TID_BASE + ident
+            if ident not in seen_irqs:
+                seen_irqs.add(ident)
+                trace.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_name",
+                              "args": {"name": f"IRQ {IRQ_NAMES.get(ident, ident)}"}})
+            if kind == ISR_ENTER:
+                open_isrs[ident] = time_us
+            elif ident in open_isrs:
+                begin = open_isrs.pop(ident)
+                trace.append({"ph": "X", "pid": PID, "tid": tid,
+                              "name": IRQ_NAMES.get(ident, f"IRQ {ident}"),
+                              "ts": begin - start, "dur": time_us - begin})
+        elif kind in (PRIO_INHERIT, PRIO_DISINHERIT):
+            label = "priority inherit" if kind == PRIO_INHERIT else "priority disinherit"
+            trace.append({"ph": "i", "s": "t", "pid": PID, "tid": ident, "ts": ts,
+                          "name": label, "args": {"priority": arg}})
+        elif kind in INSTANT_NAMES:
+            args = {}
+            if kind in (QUEUE_SEND, QUEUE_RECEIVE, QUEUE_BLOCK_RX, QUEUE_BLOCK_TX, QUEUE_SEND_ISR):
+                args = {"queue_type": ident, "queue": f"0x{arg:04x}"}
+            elif kind == NOTIFY_GIVE_ISR:
+                args = {"task": names.get(ident, ident), "index": arg}
+            elif kind in (NOTIFY_TAKE, NOTIFY_BLOCK):
+                args = {"index": arg}
+            tid = current if current is not None else 0
+            trace.append({"ph": "i", "s": "t", "pid": PID, "tid": tid, "ts": ts,
+                          "name": INSTANT_NAMES[kind], "args": args})
+
+    if events:
+        close_task(events[-1][0])
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def read_lines(args):
+    if args.port:
+        import serial  # pyserial, only needed for live capture
+        with serial.Serial(args.port, args.baud, timeout=2) as port:
+            port.write(b"t")
+            while True:
+                raw = port.readline()
+                if not raw:
+                    return
+                line = raw.decode("ascii", errors="replace")
+                yield line
+                if line.strip() == "END":
+                    return
+    elif args.input == "-":
+        yield from sys.stdin
+    else:
+        with open(args.input, encoding="ascii", errors="replace") as file:
+            yield from file
+
+
+def main():
+    parser = argparse.ArgumentParser(description="USER_Trace_Dump output to Chrome trace JSON")
+    parser.add_argument("input", nargs="?", default="-", help="capture file, '-' for stdin")
+    parser.add_argument("--port", help="request the dump on a serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("-o", "--output", help="JSON file (default stdout)")
+    args = parser.parse_args()
+
+    names, events = read_dump(read_lines(args))
+    if not events:
+        sys.exit("no trace events found")
+    chrome = to_chrome(names, unwrap(events))
+
+    if args.output:
+        with open(args.output, "w") as file:
+            json.dump(chrome, file)
+    else:
+        json.dump(chrome, sys.stdout)
+        print()
+
+
+if __name__ == "__main__":
+    main()
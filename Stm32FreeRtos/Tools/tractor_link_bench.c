@@ -0,0 +1,152 @@
+/*
+ * Host throughput benchmark for the TractorLink frames (software CRC build).
+ *
+ *   gcc -O2 -ICore/Inc Tools/tractor_link_bench.c Core/Src/TractorLink.c -o tractor_link_bench
+ *   ./tractor_link_bench [iterations]
+ *
+ * Round-trips every frame through the byte-wise receiver and checks the fields,
+ * then the traced INPUT and the two clock sync messages once each, and compares
+ * the wire size with the old text link.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "TractorLink.h"
+
+static double Bench_Seconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void Bench_Report(const char *name, unsigned long count, size_t bytes, double seconds)
+{
+  printf("%-22s %10.0f frames/s %8.2f MB/s %8.1f ns/frame\n", name, count / seconds,
+         count * (double)bytes / seconds / 1e6, seconds * 1e9 / count);
+}
+
+/* Feeds one frame to a fresh receiver, 1 when it yields exactly one message */
+static int Bench_Receive(const uint8_t *frame, size_t length, TractorLink_Msg_t *msg)
+{
+  TractorLink_Rx_t rx;
+  size_t k;
+  int messages = 0;
+
+  TractorLink_Rx_Init(&rx);
+  for (k = 0; k < length; k++) {
+    messages += TractorLink_Rx_Byte(&rx, frame[k], msg);
+  }
+  return messages == 1;
+}
+
+/* Traced INPUT, SYNC_REQ and SYNC_ACK through encode, receive and decode, 0 on success */
+static int Bench_Check_Messages(void)
+{
+  uint8_t frame[TL_MAX_FRAME];
+  TractorLink_Msg_t msg;
+  TractorLink_Input_t input = { 1234U, 1U, 42U, 0x89ABCDEFUL, 0x89ABCE10UL };
+  TractorLink_Input_t input_rx;
+  TractorLink_Sync_t req = { 0xDEADBEEFUL, 0U, 0U };
+  TractorLink_Sync_t ack = { 0x01020304UL, 0x11223344UL, 0x55667788UL };
+  TractorLink_Sync_t sync_rx;
+
+  if (!Bench_Receive(frame, TractorLink_Encode_Input(&input, 7U, frame), &msg) ||
+      msg.length != TL_INPUT_TRACE_SIZE || TractorLink_Decode_Input(&msg, &input_rx) != TL_OK ||
+      input_rx.adc != input.adc || input_rx.button != input.button ||
+      input_rx.trace_id != input.trace_id || input_rx.sample_us != input.sample_us ||
+      input_rx.tx_us != input.tx_us) {
+    fprintf(stderr, "traced input round trip mismatch\n");
+    return 1;
+  }
+  if (!Bench_Receive(frame, TractorLink_Encode_Sync(TL_MSG_SYNC_REQ, &req, 8U, frame), &msg) ||
+      msg.type != TL_MSG_SYNC_REQ || TractorLink_Decode_Sync(&msg, &sync_rx) != TL_OK ||
+      sync_rx.t1 != req.t1 || sync_rx.t2 != 0U || sync_rx.t3 != 0U) {
+    fprintf(stderr, "sync request round trip mismatch\n");
+    return 1;
+  }
+  if (!Bench_Receive(frame, TractorLink_Encode_Sync(TL_MSG_SYNC_ACK, &ack, 9U, frame), &msg) ||
+      msg.type != TL_MSG_SYNC_ACK || TractorLink_Decode_Sync(&msg, &sync_rx) != TL_OK ||
+      sync_rx.t1 != ack.t1 || sync_rx.t2 != ack.t2 || sync_rx.t3 != ack.t3) {
+    fprintf(stderr, "sync answer round trip mismatch\n");
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long iterations = (argc > 1) ? strtoul(argv[1], NULL, 10) : 2000000UL;
+  uint8_t frame[TL_MAX_FRAME];
+  TractorLink_Rx_t rx;
+  TractorLink_Msg_t msg;
+  TractorLink_State_t state;
+  TractorLink_State_t decoded;
+  TractorLink_Input_t input = { 4095U, 1U, 0U, 0U, 0U };//	No trace, the size the text link had
+  char text[32];
+  size_t length = 0;
+  unsigned long i;
+  unsigned long checksum = 0;
+  double start;
+
+  start = Bench_Seconds();
+  for (i = 0; i < iterations; i++) {
+    state.velocity_x100 = (int16_t)i;
+    state.rpm = (uint16_t)(i >> 3);
+    state.gear = (uint8_t)(i & 7U);
+    length = TractorLink_Encode_State(&state, (uint8_t)i, frame);
+    checksum += frame[1];
+  }
+  Bench_Report("encode state", iterations, length, Bench_Seconds() - start);
+
+  TractorLink_Rx_Init(&rx);
+  start = Bench_Seconds();
+  for (i = 0; i < iterations; i++) {
+    size_t k;
+    state.velocity_x100 = (int16_t)i;
+    state.rpm = (uint16_t)(i >> 3);
+    state.gear = (uint8_t)(i & 7U);
+    length = TractorLink_Encode_State(&state, (uint8_t)i, frame);
+    for (k = 0; k < length; k++) {
+      if (TractorLink_Rx_Byte(&rx, frame[k], &msg)) {
+        if (TractorLink_Decode_State(&msg, &decoded) != TL_OK ||
+            decoded.velocity_x100 != state.velocity_x100 || decoded.rpm != state.rpm ||
+            decoded.gear != state.gear) {
+          fprintf(stderr, "round trip mismatch at frame %lu\n", i);
+          return 1;
+        }
+      }
+    }
+  }
+  Bench_Report("encode + receive", iterations, length, Bench_Seconds() - start);
+  if (rx.stats.frames != iterations || rx.stats.lost || rx.stats.crc_errors) {
+    fprintf(stderr, "receiver stats: %lu frames, %lu lost, %lu crc errors\n",
+            (unsigned long)rx.stats.frames, (unsigned long)rx.stats.lost,
+            (unsigned long)rx.stats.crc_errors);
+    return 1;
+  }
+
+  if (Bench_Check_Messages()) {
+    return 1;
+  }
+
+  start = Bench_Seconds();
+  for (i = 0; i < iterations; i++) {
+    checksum += TractorLink_Crc16(frame, length);
+  }
+  Bench_Report("crc16 (software)", iterations, length, Bench_Seconds() - start);
+
+  /* Wire size against the text link it replaces */
+  printf("\ninput  frame %2zu bytes, text \"{adc: %%u, button: %%u}\\n\" %2d bytes\n",
+         TractorLink_Encode_Input(&input, 0, frame),
+         snprintf(text, sizeof(text), "{adc: %u, button: %u}\n", input.adc, input.button));
+  state.velocity_x100 = 12345;
+  state.rpm = 5432;
+  state.gear = 3;
+  printf("state  frame %2zu bytes, text \"%%.2fV%%.2fS%%.2fE\"     %2d bytes\n",
+         TractorLink_Encode_State(&state, 0, frame),
+         snprintf(text, sizeof(text), "%.2fV%.2fS%.2fE", 123.45, 5432.0, 3.0));
+  printf("(checksum %lu)\n", checksum);
+  return 0;
+}
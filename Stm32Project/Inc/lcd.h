@@ -46,5 +46,8 @@ char LCD_Busy(void);
 void LCD_Pulse_EN(void);
 void LCD_BarGraphic(int16_t value, int16_t size);
 void LCD_BarGraphicXY(int16_t pos_x, int16_t pos_y, int16_t value);
+void LCD_Frame_Init(void);
+void LCD_Frame_Put_Str(uint8_t line, uint8_t column, const char * str);
+void LCD_Frame_Step(void);
 
 #endif /* INC_LCD_H_ */
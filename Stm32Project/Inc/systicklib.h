@@ -31,6 +31,10 @@ typedef struct
 #define NVIC    			(( NVIC_TypeDef * )NVIC_BASE )
 
 void USER_SysTick_Init( void );
+void SysTick_Handler( void );
+uint32_t SysTick_Get_Ticks( void );
+uint32_t SysTick_Micros( void );
 void SysTick_Delay( uint32_t time );
+void SysTick_Delay_Us( uint32_t time );
 
 #endif /* USER_CORE_CM0PLUS_H_ */
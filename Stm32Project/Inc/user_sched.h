@@ -0,0 +1,25 @@
+#ifndef USER_SCHED_H_
+#define USER_SCHED_H_
+
+/*
+ * Job of the time-triggered executive, declared in a table by the application.
+ * The scheduler owns the fields after 'offset_ms', leave them zero.
+ */
+typedef struct {
+	const char *name;
+	void ( *run )( void );
+	uint16_t period_ms;//	Must be at least 1
+	uint16_t offset_ms;//	First release after USER_Sched_Init, spreads the jobs over the ticks
+
+	uint32_t release;//	Tick of the next release
+	uint32_t runs;
+	uint32_t overruns;//	Still running at its next release
+	uint32_t skipped;//	Releases lost because other jobs held the CPU for a full period
+	uint32_t max_exec_us;
+	uint32_t max_delay_us;//	Release to start of the run
+} USER_Job_t;
+
+void USER_Sched_Init( USER_Job_t *jobs, uint8_t count );
+void USER_Sched_Dispatch( void );
+
+#endif /* USER_SCHED_H_ */
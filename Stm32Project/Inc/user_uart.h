@@ -27,6 +27,7 @@ typedef struct
 #define USART1	(( USART_TypeDef *)USART1_BASE )
 
 void USER_USART1_Init( void );
+void USER_UART1_Tx_Next( void ); // TXE interrupt, called from USART1_IRQHandler
 int _write(int file, char *ptr, int len); // to change printf function
 
 
@@ -38,14 +38,14 @@ void USER_ADC_Init(void) {
     // Habilitar regulador interno
 
     ADC->CR |= (1 << 28);       // ADVREGEN
-    SysTick_Delay(1);            // Delay > 10 us
+    SysTick_Delay_Us(20);        // Delay > 10 us
 
     // Calibración
     while (!USER_ADC_Calibration());
 
     // Habilitar ADC
     ADC->CR |= (1 << 0);         // ADEN
-    for (uint32_t i = 0; i < 1000 && !(ADC->ISR & (1 << 0)); i++) SysTick_Delay(1); // Wait up to 1ms
+    for (uint32_t i = 0; i < 1000 && !(ADC->ISR & (1 << 0)); i++) SysTick_Delay_Us(1); // Wait up to 1ms
     if (!(ADC->ISR & (1 << 0))) return;  // Fail if ADRDY not set
 }
 
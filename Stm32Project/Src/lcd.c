@@ -224,7 +224,7 @@ char LCD_Busy(void){
 	GPIOB->BSRR	  =	 LCD_RS_PIN_LOW;
 	GPIOB->BSRR	  =	 LCD_RW_PIN_HIGH;
 	GPIOB->BSRR	  =	 LCD_EN_PIN_HIGH;
-	SysTick_Delay( 1 );
+	SysTick_Delay_Us( 1 );//	t_DDR < 360 ns
 	if(( GPIOB->IDR	& LCD_D7_PIN_HIGH )) {
 		GPIOB->BSRR	=  LCD_EN_PIN_LOW;
 		GPIOB->BSRR	=	 LCD_RW_PIN_LOW;
@@ -253,11 +253,11 @@ char LCD_Busy(void){
 //Funcion que genera un pulso en el pin EN del LCD
 void LCD_Pulse_EN(void){
 	GPIOB->BSRR	=	LCD_EN_PIN_LOW;//
-	SysTick_Delay( 1 );
-	GPIOB->BSRR	=	LCD_EN_PIN_HIGH;
-	SysTick_Delay( 1 );
-	GPIOB->BSRR	=	LCD_EN_PIN_LOW;
-	SysTick_Delay( 1 );
+	SysTick_Delay_Us( 1 );
+	GPIOB->BSRR	=	LCD_EN_PIN_HIGH;//	PW_EH > 450 ns
+	SysTick_Delay_Us( 1 );
+	GPIOB->BSRR	=	LCD_EN_PIN_LOW;//	t_cycE > 1 us
+	SysTick_Delay_Us( 1 );
 }
 
 /*
@@ -295,3 +295,66 @@ void LCD_BarGraphicXY(int16_t pos_x, int16_t pos_y, int16_t value){
 		}
 	}
 }
+
+/*
+ * Refresco por pasos: LCD_Frame_Put_Str solo escribe en la copia en RAM y
+ * LCD_Frame_Step, llamado en cada tick de 1 ms, manda al LCD una sola
+ * operacion (mover el cursor o un caracter) de una celda que cambio. Sin
+ * espera de busy: el LCD ejecuta en 37 us, mucho antes del siguiente tick.
+ */
+static char LCD_Frame[ 2 ][ 16 ];//	Lo que se quiere mostrar
+static char LCD_Shown[ 2 ][ 16 ];//	Lo que ya tiene la DDRAM
+static uint8_t LCD_Frame_Cell = 0;//	Celda 0..31 donde sigue la busqueda
+static uint8_t LCD_Frame_Cursor = 0xFFU;//	Celda a la que apunta el cursor, 0xFF si no se sabe
+
+//Funcion que inicia la copia en RAM, llamar despues de LCD_Clear
+void LCD_Frame_Init(void){
+	for( uint8_t i = 0; i < 32; i++ ){
+		LCD_Frame[ i / 16 ][ i % 16 ] = ' ';
+		LCD_Shown[ i / 16 ][ i % 16 ] = ' ';
+	}
+	LCD_Frame_Cell = 0;
+	LCD_Frame_Cursor = 0xFFU;
+}
+
+//Funcion que escribe una cadena en la copia en RAM, linea y columna desde 1
+void LCD_Frame_Put_Str(uint8_t line, uint8_t column, const char * str){
+	line--;
+	column--;
+	for( ; column < 16 && *str != 0; column++, str++ )
+		LCD_Frame[ line ][ column ] = *str;
+}
+
+//Funcion que manda un byte sin esperar busy, el siguiente paso llega un tick despues
+static void LCD_Write_Byte_Step(uint8_t val){
+	LCD_Out_Data4( ( val >> 4 ) & 0x0FU );
+	LCD_Pulse_EN( );
+	LCD_Out_Data4( val & 0x0FU );
+	LCD_Pulse_EN( );
+}
+
+//Funcion que hace un paso del refresco, a lo mas un byte al LCD
+void LCD_Frame_Step(void){
+	uint8_t cell = LCD_Frame_Cell;
+	uint8_t line;
+	uint8_t column;
+
+	for( uint8_t n = 0; n < 32; n++, cell = ( cell + 1U ) & 31U ){
+		line = cell / 16U;
+		column = cell % 16U;
+		if( LCD_Frame[ line ][ column ] == LCD_Shown[ line ][ column ] )
+			continue;
+		LCD_Frame_Cell = cell;
+		if( LCD_Frame_Cursor != cell ){
+			GPIOB->BSRR	=	LCD_RS_PIN_LOW;
+			LCD_Write_Byte_Step( 0x80U + ( line * 0x40U ) + column );
+			LCD_Frame_Cursor = cell;
+			return;
+		}
+		GPIOB->BSRR	=	LCD_RS_PIN_HIGH;
+		LCD_Write_Byte_Step( LCD_Frame[ line ][ column ] );
+		LCD_Shown[ line ][ column ] = LCD_Frame[ line ][ column ];
+		LCD_Frame_Cursor = ( column == 15U ) ? 0xFFU : cell + 1U;//	El contador de la DDRAM avanza solo
+		return;
+	}
+}
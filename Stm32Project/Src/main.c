@@ -15,6 +15,8 @@
 #include "user_uart.h"
 #include "lcd.h"
 #include "adclib.h"
+#include "systicklib.h"
+#include "user_sched.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h> /* strtod */
@@ -32,8 +34,33 @@ int index_k = 0;
 uint8_t button_status = 0;
 uint16_t val;
 
+void Read_adc();
+void Show_data();
+void Set_pwm();
+void Send_data();
+
+/*
+ * Time-triggered schedule, 1 ms ticks. Every job finishes well inside a tick:
+ * Show_data only fills the LCD frame in RAM and lcd_step sends one byte of it
+ * per tick, Send_data only copies into the USART1 transmit ring. A full
+ * refresh of the 32 cells takes about 40 ticks. The offsets put the other
+ * jobs on different ticks. USART1 reception is interrupt driven, Manage_msg
+ * is not scheduled.
+ */
+USER_Job_t Jobs[] = {
+	/* name		 run		period	offset */
+	{ "lcd_step", LCD_Frame_Step, 1U,	 0U },
+	{ "adc",	 Read_adc,	 10U,	 0U },
+	{ "pwm",	 Set_pwm,	 20U,	 5U },
+	{ "send",	 Send_data,	100U,	 7U },
+	{ "lcd",	 Show_data,	500U,	 3U },
+};
+#define JOBS_COUNT	( sizeof( Jobs ) / sizeof( Jobs[0] ) )
+
 void USART1_IRQHandler(void)
 {
+	if ((USART1->CR1 & (0x1UL << 7U)) && (USART1->ISR & (0x1UL << 7U)))
+		USER_UART1_Tx_Next(); // TXE with TXEIE set: next byte of the transmit ring
 	if ((USART1->ISR & (0x1UL << 5U)))
 	{ // wait until a data is received (ISR register)
 		char received = USART1->RDR;
@@ -78,15 +105,17 @@ int main(void)
 {
 	/* Declarations and Initializations */
 	System_init();
+	USER_SysTick_Init( );//	After the 48 MHz clock, the LCD and ADC delays count its ticks
 	USER_TIM3_PWM_Init( );
-//	USART_initialization();
-//	USER_ADC_Init();
-//	Lcd_initialization();
+	USART_initialization();
+	USER_ADC_Init();
+	Lcd_initialization();
+	USER_Sched_Init( Jobs, JOBS_COUNT );
 
 	/* Repetitive block */
 	for (;;)
 	{
-
+		USER_Sched_Dispatch( );
 	}
 }
 
@@ -142,6 +171,7 @@ void USART_initialization(){
 void Lcd_initialization(){
 	LCD_Init();
 	LCD_Clear();
+	LCD_Frame_Init();
 }
 
 void Read_adc(){
@@ -157,16 +187,11 @@ void Read_adc(){
 }
 
 void Show_data(){
-			LCD_Set_Cursor(1, 1);
-			LCD_Put_Str("Vel:       G:  ");
-			LCD_Set_Cursor(1, 5);
-			LCD_Put_Str(buffer_vel);
-			LCD_Set_Cursor(1, 14);
-			LCD_Put_Str(buffer_gear);
-			LCD_Set_Cursor(2, 1);
-			LCD_Put_Str("RPM:       ");
-			LCD_Set_Cursor(2, 5);
-			LCD_Put_Str(buffer_rpm);
+			LCD_Frame_Put_Str(1, 1, "Vel:       G:  ");
+			LCD_Frame_Put_Str(1, 5, buffer_vel);
+			LCD_Frame_Put_Str(1, 14, buffer_gear);
+			LCD_Frame_Put_Str(2, 1, "RPM:       ");
+			LCD_Frame_Put_Str(2, 5, buffer_rpm);
 
 }
 
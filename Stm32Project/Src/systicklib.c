@@ -2,6 +2,8 @@
 #include "main.h"
 #include "systicklib.h"
 
+static volatile uint32_t SysTick_Ticks = 0;//	Milisegundos desde USER_SysTick_Init
+
 void USER_SysTick_Init( void ){
   // Reloj del sistema = 48 MHz
   // SysTick es de 24 bits, así que máximo 2^24-1 = 16,777,215
@@ -9,13 +11,38 @@ void USER_SysTick_Init( void ){
   Systick->RVR  = 48000 - 1;//          Carga para 1ms
   Systick->CVR  = 0;//                  Reinicia el contador
   Systick->CSR |=  ( 0x1UL <<  2U );//  Selecciona el reloj del procesador como el Systick
+  Systick->CSR |=  ( 0x1UL <<  1U );//  Interrupcion en cada desborde (tick de 1 ms)
+  Systick->CSR |=  ( 0x1UL <<  0U );//  Inicia el Systick, ya no se detiene
+}
+
+void SysTick_Handler( void ){
+  SysTick_Ticks++;
 }
 
+uint32_t SysTick_Get_Ticks( void ){
+  return SysTick_Ticks;
+}
+
+// Microsegundos desde USER_SysTick_Init, el tick mas la cuenta actual del Systick
+uint32_t SysTick_Micros( void ){
+  uint32_t ticks;
+  uint32_t count;
+
+  do {
+    ticks = SysTick_Ticks;
+    count = Systick->CVR;
+  } while( ticks != SysTick_Ticks );//  Se repite si hubo un tick entre las dos lecturas
+  return ticks * 1000U + ( 47999U - count ) / 48U;
+}
+
+// Espera 'time' milisegundos completos desde la llamada, solo desde el programa principal (el tick es una interrupcion)
 void SysTick_Delay( uint32_t time ) {
-  Systick->CSR |=  ( 0x1UL <<  0U );//  Inicia el Systick
-  for(uint32_t i = 0; i < time; i++){
-    // Espera a que el bit COUNTFLAG se ponga en 1 (cuando se desborda)
-    while(!( Systick->CSR & ( 0x1UL << 16U )));
-  }
-  Systick->CSR &= ~( 0x1UL <<  0U );//  Detiene el SysTick
+  SysTick_Delay_Us( time * 1000U );
+}
+
+// Espera 'time' microsegundos sobre SysTick_Micros, cuenta tambien la fraccion del tick actual
+void SysTick_Delay_Us( uint32_t time ) {
+  uint32_t start = SysTick_Micros( );
+
+  while(( SysTick_Micros( ) - start ) < time );
 }
@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include "main.h"
+#include "systicklib.h"
+#include "user_sched.h"
+
+/*
+ * Time-triggered cooperative executive on the 1 ms SysTick. The tick interrupt
+ * only counts, the jobs run from the superloop: every pass runs the released
+ * jobs in table order, each to completion, then sleeps until the next tick.
+ * Releases are absolute ticks (offset + k * period), so the rate never drifts
+ * with the execution time and the schedule repeats every hyperperiod.
+ *
+ * A job is never preempted by another one, a long job delays the ones released
+ * while it runs. The table counts it: 'overruns' when a job is still running
+ * at its own next release, 'skipped' when a release was lost entirely.
+ */
+
+static USER_Job_t *USER_Jobs;
+static uint8_t USER_Jobs_Count;
+
+void USER_Sched_Init( USER_Job_t *jobs, uint8_t count ){
+	uint32_t now = SysTick_Get_Ticks( );
+
+	for( uint8_t i = 0; i < count; i++ ){
+		if( jobs[ i ].period_ms == 0U )
+			jobs[ i ].period_ms = 1U;
+		jobs[ i ].release = now + jobs[ i ].offset_ms;
+	}
+	USER_Jobs = jobs;
+	USER_Jobs_Count = count;
+}
+
+static void USER_Sched_Run( USER_Job_t *job, uint32_t now ){
+	uint32_t release_us;
+	uint32_t start;
+	uint32_t exec;
+
+	/* A release more than a period old means the later ones were never run */
+	while(( now - job->release ) >= job->period_ms ){
+		job->release += job->period_ms;
+		job->skipped++;
+	}
+
+	release_us = job->release * 1000U;
+	start = SysTick_Micros( );
+	job->run( );
+	exec = SysTick_Micros( ) - start;
+
+	job->runs++;
+	job->release += job->period_ms;
+	if(( int32_t )( SysTick_Get_Ticks( ) - job->release ) >= 0 )
+		job->overruns++;
+	if( exec > job->max_exec_us )
+		job->max_exec_us = exec;
+	if(( start - release_us ) > job->max_delay_us )
+		job->max_delay_us = start - release_us;
+}
+
+void USER_Sched_Dispatch( void ){
+	uint32_t now = SysTick_Get_Ticks( );
+	uint8_t ran = 0;
+
+	for( uint8_t i = 0; i < USER_Jobs_Count; i++ ){
+		if(( int32_t )( now - USER_Jobs[ i ].release ) >= 0 ){
+			USER_Sched_Run( &USER_Jobs[ i ], now );
+			ran = 1;
+		}
+	}
+	if( ran )
+		return;//	Jobs may have taken ticks, check again before sleeping
+
+	/* Sleep until the next tick, with PRIMASK set a tick arriving after the check still ends the WFI */
+	__asm volatile( "cpsid i" );
+	if( SysTick_Get_Ticks( ) == now )
+		__asm volatile( "wfi" );
+	__asm volatile( "cpsie i" );
+}
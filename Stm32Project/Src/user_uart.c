@@ -50,16 +50,44 @@ void USER_UART1_Init( void ){ //uart initialization function
 }
 
 
+/*
+ * Transmit ring filled by _write and drained by the TXE interrupt, so printf
+ * returns after copying instead of waiting 1 ms per character at 9600 baud.
+ * One writer (the superloop) and one reader (USART1_IRQHandler), each index
+ * is written by one side only.
+ */
+#define UART1_TX_SIZE	128U//	Power of two, holds a few Send_data lines
+
+static volatile char UART1_Tx_Buf[ UART1_TX_SIZE ];
+static volatile uint16_t UART1_Tx_Head = 0;//	Next free slot, written by _write
+static volatile uint16_t UART1_Tx_Tail = 0;//	Next byte to send, written by the interrupt
+volatile uint32_t UART1_Tx_Dropped = 0;//	Bytes lost with the ring full
+
+//	TXE interrupt: sends the next byte, turns TXEIE off when the ring is empty
+void USER_UART1_Tx_Next( void ){
+	if( UART1_Tx_Tail == UART1_Tx_Head ){
+		USART1->CR1 = USART1->CR1 & ~(0x1UL << 7U);
+		return;
+	}
+	USART1->TDR = UART1_Tx_Buf[ UART1_Tx_Tail ];
+	UART1_Tx_Tail = ( UART1_Tx_Tail + 1U ) & ( UART1_TX_SIZE - 1U );
+}
+
 //PRINTF FUNCTION EDITED
 ////////////////////////////////////////////////////////////////////////////////////////
 int _write(int file, char *ptr, int len){
 	int DataIdx;
+	uint16_t next;
 	 for(DataIdx=0; DataIdx<len; DataIdx++){
-		while(!( USART1->ISR & (0x1UL << 7U)));
-		 	 USART1->TDR = *ptr++;
+		next = ( UART1_Tx_Head + 1U ) & ( UART1_TX_SIZE - 1U );
+		if( next == UART1_Tx_Tail ){
+			UART1_Tx_Dropped += len - DataIdx;//	Never wait, newlib would retry a short count
+			break;
+		}
+		UART1_Tx_Buf[ UART1_Tx_Head ] = *ptr++;
+		UART1_Tx_Head = next;
 	 }
+	USART1->CR1 = USART1->CR1 | (0x1UL << 7U);//	TXEIE, the interrupt takes it from here
 	return len;
 }
 ///////////////////////////////////////////////////////////////////////////////////////
-
-
@@ -1,7 +1,6 @@
 #ifndef ADCLIB_H_
 #define ADCLIB_H_
 
-static uint8_t USER_ADC_Calibration( void );
 void USER_ADC_Init( void );
 uint16_t USER_ADC_Read( void );
 
@@ -6,5 +6,9 @@ void update_cycle(uint8_t duty, uint8_t pin);
 uint16_t USER_Duty_Cycle( uint8_t duty );
 void USER_TIM14_Init(void);
 void USER_TIM14_Delay(uint16_t ms);
+void USER_Delay_ms( uint16_t ms );
+void USER_TIM16_Boot_Start( void );
+uint16_t USER_TIM16_Boot_Us( void );
+void USER_Delay_us( uint16_t us );
 
 #endif /* USER_TIM_H_ */
@@ -5,6 +5,6 @@
 void USER_EXTI1_Init( void ){
   EXTI->IMR1    |=  (  0x1UL <<  25U );//  Enable interrupt
   EXTI->EMR1    &=  ~(  0x1UL <<  25U );//  Disable event generation
-  NVIC->IPR[6]  &= ~( 0x00UL <<  3U );
-  NVIC->ISER    |=  (  0x1UL <<  27U );
+  NVIC->IP[6]   &= ~( 0x00UL <<  3U );
+  NVIC->ISER[0] =   (  0x1UL <<  27U );
 }
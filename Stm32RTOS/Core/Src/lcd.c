@@ -77,7 +77,7 @@ void LCD_Init(void){
 	GPIOB->BSRR	 =	 LCD_D5_PIN_LOW;
 	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
 	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
-	USER_TIM14_Delay(50);
+	USER_Delay_ms(50);
 
 	/* Special case of 'Function Set'	*/
 	GPIOB->BSRR	 =	 LCD_D4_PIN_HIGH;
@@ -85,7 +85,7 @@ void LCD_Init(void){
 	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
 	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
 	LCD_Pulse_EN( );
-	USER_TIM14_Delay(50);
+	USER_Delay_ms(50);
 
 	/* Special case of 'Function Set' */
 	GPIOB->BSRR	 =	 LCD_D4_PIN_HIGH;
@@ -93,7 +93,7 @@ void LCD_Init(void){
 	GPIOB->BSRR	 =	 LCD_D6_PIN_LOW;
 	GPIOB->BSRR	 =	 LCD_D7_PIN_LOW;
 	LCD_Pulse_EN( );
-	USER_TIM14_Delay(50);
+	USER_Delay_ms(50);
 
 	/* Special case of 'Function Set' */
 	GPIOB->BSRR	 =	 LCD_D4_PIN_HIGH;
@@ -125,7 +125,7 @@ void LCD_Init(void){
 	LCD_Write_Cmd( 0x40 );
 	p = &UserFont[0][0];
 
-	for( int i = 0; i < sizeof( UserFont ); i++, p++ )
+	for( unsigned int i = 0; i < sizeof( UserFont ); i++, p++ )
 		LCD_Put_Char( *p );
 
 	/*	Set DDRAM address in address			*/
@@ -216,48 +216,37 @@ void LCD_Put_Num(int16_t num){
 
 //Funcion que provoca tiempos de espera en el LCD
 char LCD_Busy(void){
+	char busy;
 /**
-  * Configuracion de D7 as input floating
+  * Configuracion de D4-D7 as input floating, antes de subir RW: el LCD maneja
+  * el bus mientras EN esta en alto
   */
-	GPIOB->PUPDR &= ~( 0x3UL << 30U );
-  GPIOB->MODER &= ~( 0x3UL << 30U );
+	GPIOB->PUPDR &= ~( 0xFFUL << 24U );
+	GPIOB->MODER &= ~( 0xFFUL << 24U );
 	GPIOB->BSRR	  =	 LCD_RS_PIN_LOW;
 	GPIOB->BSRR	  =	 LCD_RW_PIN_HIGH;
 	GPIOB->BSRR	  =	 LCD_EN_PIN_HIGH;
-	USER_TIM14_Delay(1);
-	if(( GPIOB->IDR	& LCD_D7_PIN_HIGH )) {
-		GPIOB->BSRR	=  LCD_EN_PIN_LOW;
-		GPIOB->BSRR	=	 LCD_RW_PIN_LOW;
+	USER_Delay_us(1);
+	busy = ( GPIOB->IDR & LCD_D7_PIN_HIGH ) ? 1 : 0;
+	GPIOB->BSRR	=  LCD_EN_PIN_LOW;
+	GPIOB->BSRR	=	 LCD_RW_PIN_LOW;
 /**
-  * Configuracion de D7 as output push-pull
+  * Configuracion de D4-D7 as output push-pull, despues de bajar RW
   */
-		GPIOB->PUPDR  &= ~( 0x3UL << 30U );
-  	GPIOB->OTYPER &= ~( 0x1UL << 15U );
-  	GPIOB->MODER  &= ~( 0x2UL << 30U );
-  	GPIOB->MODER  |=  ( 0x1UL << 30U );
-		return 1;
-	} else {
-		GPIOB->BSRR	=  LCD_EN_PIN_LOW;
-		GPIOB->BSRR	=	 LCD_RW_PIN_LOW;
-/**
-  * Configuracion de D7 as output push-pull
-  */
-		GPIOB->PUPDR  &= ~( 0x3UL << 30U );
-  	GPIOB->OTYPER &= ~( 0x1UL << 15U );
-  	GPIOB->MODER  &= ~( 0x2UL << 30U );
-  	GPIOB->MODER  |=  ( 0x1UL << 30U );
-		return 0;
-	}
+	GPIOB->OTYPER &= ~( 0xFUL << 12U );
+	GPIOB->MODER  &= ~( 0xFFUL << 24U );
+	GPIOB->MODER  |=  ( 0x55UL << 24U );
+	return busy;
 }
 
 //Funcion que genera un pulso en el pin EN del LCD
 void LCD_Pulse_EN(void){
 	GPIOB->BSRR	=	LCD_EN_PIN_LOW;//
-	USER_TIM14_Delay(1);
+	USER_Delay_us(1);
 	GPIOB->BSRR	=	LCD_EN_PIN_HIGH;
-	USER_TIM14_Delay(1);
+	USER_Delay_us(1);
 	GPIOB->BSRR	=	LCD_EN_PIN_LOW;
-	USER_TIM14_Delay(1);
+	USER_Delay_us(1);
 }
 
 /*
@@ -18,7 +18,11 @@
 TaskHandle_t Task1Handle;
 
 void USER_RCC_Init( void );
+void USER_GPIO_Init( void );
+void System_init( void );
+void System_init_background( void );
 void StartTask1( void *pvParameters );
+void TIM3_IRQHandler( void );
 
 
 #define BUFFER_SIZE 8
@@ -33,6 +37,7 @@ int index_k = 0;
 
 uint8_t button_status = 0;
 uint16_t val;
+volatile uint16_t boot_pwm_us;//	Clock setup to the first PWM period, the startup code and HAL_Init before it are not counted
 
 
 
@@ -49,7 +54,7 @@ int main(void)
 	xTaskCreate(StartTask1, "Task1", 128, NULL, 2, &Task1Handle);
 
 	/* Start the scheduler */
-	printf("Heap Available: %u bytes\r\n", xPortGetFreeHeapSize());
+	printf("Heap Available: %u bytes\r\n", (unsigned int)xPortGetFreeHeapSize());
 	printf("Initializing Scheduler...\r\n");
 	vTaskStartScheduler();
 
@@ -61,17 +66,28 @@ int main(void)
 
 // Task1 function
 void StartTask1(void *pvParameters) {
+  (void)pvParameters;
+  System_init_background();
+  printf("Boot: PWM running %u us after the clock setup\r\n", boot_pwm_us);
 
   /* Infinite loop */
   for(;;) {
 	  char* msg = "Test papu \r\n";
-	  USER_UART2_Transmit( msg, sizeof( msg ));
+	  USER_UART2_Transmit( ( uint8_t * )msg, strlen( msg ));
 	  vTaskDelay(1000);
   }
 }
 
 
 
+// First TIM3 update event: the compare values reach the pins from this period on
+void TIM3_IRQHandler(void)
+{
+	TIM3->SR &= ~(0x1UL << 0U);
+	TIM3->DIER &= ~(0x1UL << 0U);// Only the first one is wanted
+	boot_pwm_us = USER_TIM16_Boot_Us();
+}
+
 void USART1_IRQHandler(void)
 {
 	if ((USART1->ISR & (0x1UL << 5U)))
@@ -150,19 +166,27 @@ void Manage_msg(){
 }
 
 
+/* Control path only: clock, console and link UARTs, PWM outputs. Everything with long waits is left to System_init_background */
 void System_init(){
 	USER_RCC_Init();
+	USER_TIM16_Boot_Start();
 	USER_GPIO_Init();
-	USER_UART1_Init();
-	USER_UART2_Init();
 	USER_TIM14_Init();
 	USER_TIM3_PWM_Init( );
-	USER_ADC_Init();
+	/* The UG of the init set UIF, the stamp waits for the first update of the running counter */
+	TIM3->SR &= ~(0x1UL << 0U);
+	TIM3->DIER |= (0x1UL << 0U);
+	NVIC->ISER[0] = (0x1UL << 16U);
+	USER_UART1_Init();
+	USER_UART2_Init();
 	USER_EXTI1_Init();
-	Lcd_Init();
-	LCD_Clear();
-
+}
 
+/* From Task1 once the scheduler runs: the ADC regulator start-up and the LCD power-up waits block the task, not the boot */
+void System_init_background(){
+	USER_ADC_Init();
+	LCD_Init();
+	LCD_Clear();
 }
 
 void Read_adc(){
@@ -1,7 +1,8 @@
-#include "user_tim.c"
-
 #include <stdint.h>
 #include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "user_tim.h"
 
 void USER_TIM3_PWM_Init( void ){
 	/* STEP 0. Enable the clock signal for the TIM3 and GPIOB peripherals */
@@ -9,29 +10,29 @@ void USER_TIM3_PWM_Init( void ){
 	RCC->APBENR1	|=  ( 0x1UL <<  1U );
 
 	/* STEP 0. Configure TIM3_CH1 (PB4) to output the PWM signal */
-	GPIOB->AFRL		&= ~( 0xEUL << 16U );
-	GPIOB->AFRL		|=  ( 0x1UL << 16U );
+	GPIOB->AFR[0]		&= ~( 0xEUL << 16U );
+	GPIOB->AFR[0]		|=  ( 0x1UL << 16U );
 	GPIOB->PUPDR  &= ~( 0x3UL <<  8U );
 	GPIOB->OTYPER	&= ~( 0x1UL <<  4U );
 	GPIOB->MODER  &= ~( 0x1UL <<  8U );
 	GPIOB->MODER  |=  ( 0x2UL <<  8U );
 	/* STEP 0. Configure TIM3_CH1 (PB5) to output the PWM signal */
-	GPIOB->AFRL		&= ~( 0xEUL << 20U );
-	GPIOB->AFRL		|=  ( 0x1UL << 20U );
+	GPIOB->AFR[0]		&= ~( 0xEUL << 20U );
+	GPIOB->AFR[0]		|=  ( 0x1UL << 20U );
 	GPIOB->PUPDR  &= ~( 0x3UL <<  10U );
 	GPIOB->OTYPER	&= ~( 0x1UL <<  5U );
 	GPIOB->MODER  &= ~( 0x1UL <<  10U );
 	GPIOB->MODER  |=  ( 0x2UL <<  10U );
 
-	GPIOB->AFRL		&= ~( 0xEUL << 0U );
-		GPIOB->AFRL		|=  ( 0x1UL << 0U );
+	GPIOB->AFR[0]		&= ~( 0xEUL << 0U );
+		GPIOB->AFR[0]		|=  ( 0x1UL << 0U );
 		GPIOB->PUPDR  &= ~( 0x3UL <<  0U );
 		GPIOB->OTYPER	&= ~( 0x1UL <<  0U );
 		GPIOB->MODER  &= ~( 0x1UL <<  0U );
 		GPIOB->MODER  |=  ( 0x2UL <<  0U );
 
-		GPIOB->AFRL		&= ~( 0xEUL << 4U );
-			GPIOB->AFRL		|=  ( 0x1UL << 4U );
+		GPIOB->AFR[0]		&= ~( 0xEUL << 4U );
+			GPIOB->AFR[0]		|=  ( 0x1UL << 4U );
 			GPIOB->PUPDR  &= ~( 0x3UL <<  2U );
 			GPIOB->OTYPER	&= ~( 0x1UL <<  1U );
 			GPIOB->MODER  &= ~( 0x1UL <<  2U );
@@ -135,10 +136,12 @@ void USER_TIM14_Init(void) {
 }
 
 void USER_TIM14_Delay(uint16_t ms) {
+	if (ms == 0)
+		return;//	ARR would wrap to 0xFFFF
 	TIM14->CR1 &= ~(1UL << 0);
 
 	TIM14->PSC = 4799;
-	TIM14->ARR = ms * 100;
+	TIM14->ARR = ms * 10U - 1U;//	10 KHz counter, 10 counts per ms
 	TIM14->EGR |= (1UL << 0);
 
 	TIM14->SR &= ~(1UL << 0);
@@ -151,6 +154,34 @@ void USER_TIM14_Delay(uint16_t ms) {
 	TIM14->SR &= ~(1UL << 0);
 }
 
+/* At least 'ms': blocks the calling task once the scheduler runs, busy-waits on TIM14 before. For the long waits only, a task delay is two ticks at least */
+void USER_Delay_ms( uint16_t ms ){
+	if( xTaskGetSchedulerState( ) == taskSCHEDULER_RUNNING )
+		vTaskDelay( pdMS_TO_TICKS( ms ) + 1U );//	The next tick can be a moment away
+	else
+		USER_TIM14_Delay( ms );
+}
+
+/* Boot stopwatch and USER_Delay_us timebase, TIM16 free running at 1 MHz: microseconds since the start, 65 ms range */
+void USER_TIM16_Boot_Start( void ){
+	RCC->APBENR2	|=  ( 0x1UL << 17U );//	TIM16 clock enabled
+	TIM16->PSC		 =  47U;//				1 MHz counter at 48 MHz
+	TIM16->ARR		 =  0xFFFFU;
+	TIM16->EGR		 =  ( 0x1UL <<  0U );//	Load PSC, counter cleared
+	TIM16->CR1		|=  ( 0x1UL <<  0U );
+}
+
+uint16_t USER_TIM16_Boot_Us( void ){
+	return ( uint16_t )TIM16->CNT;
+}
+
+/* At least 'us', up to 32767, busy-waits on TIM16 in any context. For the LCD and ADC set-up times */
+void USER_Delay_us( uint16_t us ){
+	uint16_t start = ( uint16_t )TIM16->CNT;
+
+	while( ( uint16_t )( TIM16->CNT - start ) <= us );//	The first count can come right away
+}
+
 void update_cycle(uint8_t duty, uint8_t pin){
 	switch(pin){
 	case 1:
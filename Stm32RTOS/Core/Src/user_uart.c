@@ -6,6 +6,7 @@
 int _write(int file, uint8_t *ptr, int len)
 {
   int DataIdx;
+  (void)file;
   for( DataIdx = 0; DataIdx < len; DataIdx++ ){
     while(!( USART1->ISR & ( 0x1UL << 7U )));
     USART2->TDR = *ptr++;
@@ -48,8 +49,8 @@ void USER_UART1_Init( void ){ //uart initialization function
 	RCC->IOPENR = RCC->IOPENR  | (0x1UL << 0U);
 	RCC->APBENR2 = RCC->APBENR2 | (0x1UL << 14U);
   /* STEP 0. Configure the TX pin (PA9) as Alternate Function Push-Pull */
-	GPIOA->AFRH = GPIOA->AFRH & ~(0xEUL << 4U);
-	GPIOA->AFRH = GPIOA->AFRH | (0x1UL << 4U);
+	GPIOA->AFR[1] = GPIOA->AFR[1] & ~(0xEUL << 4U);
+	GPIOA->AFR[1] = GPIOA->AFR[1] | (0x1UL << 4U);
 	GPIOA->PUPDR = GPIOA->PUPDR & ~(0x3UL << 18U);
 	GPIOA->OTYPER = GPIOA->OTYPER & ~(0x1UL << 9U);
 	GPIOA->MODER = GPIOA->MODER & ~(0x1UL << 18U);
@@ -57,8 +58,8 @@ void USER_UART1_Init( void ){ //uart initialization function
 
   /* STEP 0.1 Configure the Rx pin (PA10) as Alternate Function Push-Pull */
 	//MODE 10 OTYPE 0 PUPDR 00 Set as alternate function
-	GPIOA->AFRH = GPIOA->AFRH & ~(0xEUL << 8U);
-	GPIOA->AFRH = GPIOA->AFRH | (0x1UL << 8U);
+	GPIOA->AFR[1] = GPIOA->AFR[1] & ~(0xEUL << 8U);
+	GPIOA->AFR[1] = GPIOA->AFR[1] | (0x1UL << 8U);
 	GPIOA->PUPDR = GPIOA->PUPDR & ~(0x3UL << 20U);
 	GPIOA->OTYPER = GPIOA->OTYPER & ~(0x1UL << 10U);
 	GPIOA->MODER = GPIOA->MODER & ~(0x1UL << 20U);
@@ -0,0 +1,113 @@
+/*
+ * File: host_periph.h
+ *
+ * Register-level model of the STM32C031 peripherals the drivers of Core/Src
+ * use, running in virtual time.
+ *
+ * Time is counted in HSI48 cycles from Host_Periph_Init (power on). It moves
+ * only when the application touches a register: every access costs
+ * HOST_ACCESS_CYCLES of SYSCLK, and a loop that reads the same status register
+ * three times in a row with the same result jumps straight to the next peripheral event
+ * (timer update, end of a UART frame or ADC conversion) instead of spinning.
+ * Code between register accesses is free, so the measured times are the
+ * peripheral and wait times the drivers impose, not CPU load.
+ *
+ * Models (clock tree: HSIDIV of RCC->CR only, PCLK = SYSCLK):
+ *   USART1/2  TXE/TC with a one byte TDR and a shift register clocked at the
+ *             BRR rate, RXNE/ORE from bytes injected or read from a pty
+ *   TIM1/3/14/16/17  PSC always preloaded, ARR preloaded when ARPE, CCRx when
+ *             OCxPE, shadows loaded on the update event or UG, UIF unless
+ *             URS/UDIS, CNT derived from time
+ *   ADC1      ADVREGEN start-up, calibration, ADEN/ADRDY, conversions timed
+ *             from CKMODE/PRESC and SMPR, EOC/EOS, OVR when DR was not read
+ *   GPIOA/B/C MODER/ODR/BSRR/BRR/IDR, PB9-PB15 wired to an HD44780 model
+ *   NVIC      ISER/ICER enable mask, interrupts dispatched by Host_Periph_Dispatch
+ */
+#ifndef HOST_PERIPH_H_
+#define HOST_PERIPH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "stm32c0xx_hal.h"
+
+#define HOST_HSI_HZ          48000000ULL
+#define HOST_ACCESS_CYCLES   4U//	SYSCLK cycles per register access, the load/store and the code around it
+
+typedef uint64_t Host_Time_t;//	HSI48 cycles
+
+/* ---------------------------------------------------------------- Virtual clock (host_clock.cpp) */
+
+/* A pending peripheral action, armed with Host_Event_Set */
+typedef struct Host_Event {
+	Host_Time_t due;
+	int armed;
+	void ( *fire )( struct Host_Event *event );
+} Host_Event_t;
+
+void Host_Clock_Reset( void );
+Host_Time_t Host_Clock_Now( void );
+uint64_t Host_Clock_Us( void );
+unsigned Host_Clock_Sysclk_Shift( void );//	SYSCLK = HSI48 >> shift
+void Host_Clock_Run( Host_Time_t cycles );
+void Host_Clock_Run_To( Host_Time_t time );//	Never goes back
+void Host_Event_Register( Host_Event_t *event, void ( *fire )( Host_Event_t *event ) );
+void Host_Event_Set( Host_Event_t *event, Host_Time_t due );
+void Host_Event_Cancel( Host_Event_t *event );
+
+/* ---------------------------------------------------------------- Peripherals (host_periph.cpp) */
+
+typedef struct {
+	uint32_t tx_bytes;
+	uint32_t tx_lost;//	TDR written while TXE was clear
+	uint32_t rx_bytes;
+	uint32_t overruns;//	Byte arrived with RXNE still set
+} Host_Usart_Stats_t;
+
+typedef struct {
+	uint32_t conversions;
+	uint32_t overruns;
+	uint32_t early;//	ADCAL/ADEN before the regulator start-up time
+} Host_ADC_Stats_t;
+
+void Host_Periph_Init( void );
+void Host_Periph_Poll( void );//	Pseudo-terminal input to the receivers
+void Host_Periph_Dispatch( void );//	Runs the handlers of the pending, enabled interrupts
+
+/* Non-blocking master of a new raw pseudo-terminal, -1 on failure (host_pty.c) */
+extern "C" int Host_Pty_Open( const char *name );
+
+/* Stimulus for the inputs the application reads */
+void Host_ADC_Set( uint16_t value );
+void Host_GPIO_Set_Input( GPIO_TypeDef *port, uint16_t pins, int level );
+void Host_Usart_Inject( USART_TypeDef *usart, const uint8_t *data, size_t length );
+
+/* Inspection */
+const Host_Usart_Stats_t *Host_Usart_Get_Stats( USART_TypeDef *usart );
+const Host_ADC_Stats_t *Host_ADC_Get_Stats( void );
+uint32_t Host_TIM_Duty_Permille( TIM_TypeDef *tim, unsigned channel );//	Effective PWM duty, shadow CCR over shadow ARR
+uint32_t Host_TIM_Updates( TIM_TypeDef *tim );
+
+/* ---------------------------------------------------------------- HD44780 on GPIOB (host_lcd.cpp) */
+
+/*
+ * RS PB9, RW PB10, E PB11, D4-D7 PB12-PB15, as in lcd.h. Writes are latched on
+ * the falling edge of E, instructions take their datasheet execution time
+ * (fosc 270 kHz) and BF reads high until then. Reads drive BF/AC6-4 on every
+ * E high, nibble pairing of 4-bit reads is not modelled.
+ */
+typedef struct {
+	uint32_t instructions;
+	uint32_t data;
+	uint32_t busy_reads;//	Reads that returned BF=1
+	uint32_t while_busy;//	Writes ignored because the controller was busy
+	uint32_t early;//	Writes in the first 40 ms after power on
+	uint32_t bus_conflicts;//	Reads with D4-D7 still driven by the MCU
+} Host_LCD_Stats_t;
+
+void Host_LCD_Reset( void );
+void Host_LCD_Pins( uint32_t odr, uint32_t moder );
+uint32_t Host_LCD_Bus( uint32_t *driven );//	Levels the LCD puts on PB12-PB15
+void Host_LCD_Line( unsigned line, char *text );//	Visible 16 characters of line 1 or 2 and a NUL, CGRAM ones as '#'
+const Host_LCD_Stats_t *Host_LCD_Get_Stats( void );
+
+#endif /* HOST_PERIPH_H_ */
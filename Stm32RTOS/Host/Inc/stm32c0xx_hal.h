@@ -0,0 +1,155 @@
+/*
+ * File: stm32c0xx_hal.h
+ *
+ * Host build stand-in for the HAL/CMSIS device header included by main.h.
+ * The peripheral blocks keep their CMSIS names and register names so the
+ * drivers in Core/Src compile unchanged, but every register is a HostReg:
+ * reads and writes go through the peripheral models of host_periph.cpp
+ * in virtual time (see host_periph.h).
+ * That needs operator overloading, the application sources are built as C++.
+ */
+#ifndef STM32C0XX_HAL_H_HOST
+#define STM32C0XX_HAL_H_HOST
+
+#ifndef __cplusplus
+#error "The host peripheral mocks need the application compiled as C++ (see Host/CMakeLists.txt)"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define __IO
+
+class HostReg;
+typedef uint32_t ( *HostReg_Read_t )( HostReg *reg );
+typedef void ( *HostReg_Write_t )( HostReg *reg, uint32_t value );
+
+/* Every access goes through these, they charge the bus time and run the hooks (host_clock.cpp) */
+extern "C" {
+uint32_t Host_Reg_Read( HostReg *reg );
+void Host_Reg_Write( HostReg *reg, uint32_t value );
+}
+
+/*
+ * One 32-bit register, plain memory unless a peripheral model hooked it.
+ * Operands are taken as 64-bit and cut to 32 bits, 'unsigned long' masks such
+ * as ~( 0x3UL << 4U ) are 64-bit on the host. 'changing' marks registers that
+ * change on every read (counters) or on being read (data registers), a polling
+ * loop on them must not skip ahead to the next peripheral event.
+ */
+class HostReg {
+public:
+	uint32_t value;
+	HostReg_Read_t on_read;
+	HostReg_Write_t on_write;
+	uint8_t changing;
+
+	operator uint32_t( ) { return Host_Reg_Read( this ); }
+	HostReg &operator=( uint64_t v ) { Host_Reg_Write( this, ( uint32_t )v ); return *this; }
+	HostReg &operator=( HostReg &other ) { return *this = ( uint64_t )( uint32_t )other; }
+	HostReg &operator|=( uint64_t v ) { return *this = ( uint64_t )( ( uint32_t )*this | ( uint32_t )v ); }
+	HostReg &operator&=( uint64_t v ) { return *this = ( uint64_t )( ( uint32_t )*this & ( uint32_t )v ); }
+	HostReg &operator^=( uint64_t v ) { return *this = ( uint64_t )( ( uint32_t )*this ^ ( uint32_t )v ); }
+
+	/* Reset value 0 and no hooks, without charging an access */
+	void reset( ) { value = 0; on_read = NULL; on_write = NULL; changing = 0; }
+};
+
+typedef struct {
+	HostReg CR, ICSCR, CFGR, RESERVED0[3], CIER, CIFR, CICR, IOPRSTR, AHBRSTR, APBRSTR1, APBRSTR2;
+	HostReg IOPENR, AHBENR, APBENR1, APBENR2, IOPSMENR, AHBSMENR, APBSMENR1, APBSMENR2, CCIPR, CCIPR2, CSR1, CSR2;
+} RCC_TypeDef;
+
+typedef struct {
+	HostReg ACR, KEYR, OPTKEYR, SR, CR, ECCR, OPTR;
+} FLASH_TypeDef;
+
+typedef struct {
+	HostReg MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR, AFR[2], BRR;
+} GPIO_TypeDef;
+
+typedef struct {
+	HostReg CR1, CR2, CR3, BRR, GTPR, RTOR, RQR, ISR, ICR, RDR, TDR, PRESC;
+} USART_TypeDef;
+
+typedef struct {
+	HostReg CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR;
+	HostReg CCR1, CCR2, CCR3, CCR4, BDTR, DCR, DMAR, OR1, CCMR3, CCR5, CCR6, AF1, AF2, TISEL;
+} TIM_TypeDef;
+
+typedef struct {
+	HostReg ISR, IER, CR, CFGR1, CFGR2, SMPR, AWD1TR, AWD2TR, CHSELR, AWD3TR, DR, AWD2CR, AWD3CR, CALFACT;
+} ADC_TypeDef;
+
+typedef struct {
+	HostReg CCR;
+} ADC_Common_TypeDef;
+
+typedef struct {
+	HostReg RTSR1, FTSR1, SWIER1, RPR1, FPR1, EXTICR[4], IMR1, EMR1;
+} EXTI_TypeDef;
+
+typedef struct {
+	HostReg ISER[1], ICER[1], ISPR[1], ICPR[1], IP[8];
+} NVIC_Type;
+
+typedef struct {
+	HostReg CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+
+extern RCC_TypeDef Host_RCC;
+extern FLASH_TypeDef Host_FLASH;
+extern GPIO_TypeDef Host_GPIOA, Host_GPIOB, Host_GPIOC;
+extern USART_TypeDef Host_USART1, Host_USART2;
+extern TIM_TypeDef Host_TIM1, Host_TIM3, Host_TIM14, Host_TIM16, Host_TIM17;
+extern ADC_TypeDef Host_ADC1;
+extern ADC_Common_TypeDef Host_ADC1_COMMON;
+extern EXTI_TypeDef Host_EXTI;
+extern NVIC_Type Host_NVIC;
+extern SysTick_Type Host_SysTick;
+
+#define RCC          ( &Host_RCC )
+#define FLASH        ( &Host_FLASH )
+#define GPIOA        ( &Host_GPIOA )
+#define GPIOB        ( &Host_GPIOB )
+#define GPIOC        ( &Host_GPIOC )
+#define USART1       ( &Host_USART1 )
+#define USART2       ( &Host_USART2 )
+#define TIM1         ( &Host_TIM1 )
+#define TIM3         ( &Host_TIM3 )
+#define TIM14        ( &Host_TIM14 )
+#define TIM16        ( &Host_TIM16 )
+#define TIM17        ( &Host_TIM17 )
+#define ADC1         ( &Host_ADC1 )
+#define ADC1_COMMON  ( &Host_ADC1_COMMON )
+#define ADC          ( ADC1_COMMON )
+#define EXTI         ( &Host_EXTI )
+#define NVIC         ( &Host_NVIC )
+#define SysTick      ( &Host_SysTick )
+
+typedef enum {
+	SysTick_IRQn = -1, RTC_IRQn = 2, EXTI4_15_IRQn = 7, DMA1_Channel1_IRQn = 9, ADC1_IRQn = 12, TIM1_BRK_UP_TRG_COM_IRQn = 13,
+	TIM3_IRQn = 16, TIM14_IRQn = 19, TIM16_IRQn = 21, TIM17_IRQn = 22, USART1_IRQn = 27, USART2_IRQn = 28
+} IRQn_Type;
+
+static inline void NVIC_EnableIRQ( IRQn_Type irq ){ NVIC->ISER[0] = ( 0x1UL << ( irq & 0x1F ) ); }
+static inline void NVIC_DisableIRQ( IRQn_Type irq ){ NVIC->ICER[0] = ( 0x1UL << ( irq & 0x1F ) ); }
+static inline void NVIC_SetPriority( IRQn_Type irq, uint32_t priority ){
+	if( irq >= 0 )
+		NVIC->IP[ irq >> 2 ] = ( ( uint32_t )NVIC->IP[ irq >> 2 ] & ~( 0xFFUL << ( 8U * ( irq & 3 ) ) ) ) |
+							   ( ( ( priority << 6 ) & 0xFFUL ) << ( 8U * ( irq & 3 ) ) );
+}
+
+#define GPIO_PIN_13  ( ( uint16_t )0x2000U )
+#define GPIO_PIN_14  ( ( uint16_t )0x4000U )
+
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+
+/* C linkage, main.h includes this header inside extern "C" */
+extern "C" {
+extern uint32_t SystemCoreClock;
+HAL_StatusTypeDef HAL_Init( void );
+uint32_t HAL_GetTick( void );
+}
+
+#endif /* STM32C0XX_HAL_H_HOST */
@@ -0,0 +1,327 @@
+/*
+ * File: port.c
+ *
+ * FreeRTOS port for the Linux host build, see portmacro.h for the model.
+ *
+ * Every thread that is not the running task waits in sem_wait, either on
+ * 'wake' (it gave the CPU away in vPortYield) or on 'resume' (the tick stopped
+ * it in the SIGUSR1 handler). Handing the CPU to a task posts the one it waits
+ * on. All switching decisions are taken with xInterruptMutex held.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define portSIGNAL_STOP         SIGUSR1
+#define portTHREAD_STACK_SIZE   ( 256U * 1024U )
+
+typedef struct {
+	pthread_t thread;
+	sem_t wake;//	Posted to run a task that yielded
+	sem_t resume;//	Posted to run a task stopped by the tick
+	volatile int parked;//	Waiting on 'resume', set and cleared by the task itself
+	UBaseType_t critical_nesting;
+	TaskFunction_t code;
+	void *parameters;
+} Thread_t;
+
+static pthread_mutex_t xInterruptMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t xInterruptOwner;
+static volatile int xInterruptsDisabled;
+static sem_t xParked;//	The running task confirms it stopped
+static sem_t xSchedulerEnd;
+static Thread_t *volatile pxRunning;
+static volatile BaseType_t xYieldPending;
+static __thread Thread_t *pxSelf;
+static __thread volatile int xAtomicNesting;
+static __thread volatile int xStopDeferred;
+
+static void prvSemWait( sem_t *sem )
+{
+	while( sem_wait( sem ) != 0 && errno == EINTR ) {
+	}
+}
+
+static Thread_t *prvCurrentThread( void )
+{
+	/* pxPortInitialiseStack returned the Thread_t as the top of stack, first TCB member */
+	return *( Thread_t ** )xTaskGetCurrentTaskHandle();
+}
+
+static void prvLock( void )
+{
+	pthread_mutex_lock( &xInterruptMutex );
+	xInterruptOwner = pthread_self();
+	xInterruptsDisabled = 1;
+}
+
+static void prvUnlock( void )
+{
+	xInterruptsDisabled = 0;
+	pthread_mutex_unlock( &xInterruptMutex );
+}
+
+static int prvLockHeld( void )
+{
+	return xInterruptsDisabled && pthread_equal( xInterruptOwner, pthread_self() );
+}
+
+/* Hands the CPU to 'thread', called with xInterruptMutex held */
+static void prvRun( Thread_t *thread )
+{
+	pxRunning = thread;
+	if( thread->parked ) {
+		sem_post( &thread->resume );
+	} else {
+		sem_post( &thread->wake );
+	}
+}
+
+/* SIGUSR1: the tick thread wants the CPU, wait here until this task is selected again */
+static void prvStopHandler( int sig )
+{
+	Thread_t *self = pxSelf;
+	int saved_errno = errno;
+
+	( void )sig;
+	if( self == NULL ) {
+		return;
+	}
+
+	/* Inside a register access, vPortHostAtomicExit stops instead */
+	if( xAtomicNesting != 0 ) {
+		xStopDeferred = 1;
+		return;
+	}
+
+	self->parked = 1;
+	sem_post( &xParked );
+	prvSemWait( &self->resume );
+	self->parked = 0;
+	errno = saved_errno;
+}
+
+static void *prvThreadEntry( void *arg )
+{
+	Thread_t *self = ( Thread_t * )arg;
+	sigset_t signals;
+
+	pxSelf = self;
+	prvSemWait( &self->wake );
+
+	/* Tasks start with interrupts enabled */
+	sigemptyset( &signals );
+	sigaddset( &signals, portSIGNAL_STOP );
+	pthread_sigmask( SIG_UNBLOCK, &signals, NULL );
+	self->code( self->parameters );
+
+	/* A FreeRTOS task must not return */
+	fprintf( stderr, "port: task returned\n" );
+	abort();
+	return NULL;
+}
+
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+	Thread_t *thread;
+	pthread_attr_t attr;
+	sigset_t signals;
+	sigset_t previous;
+
+	/* The TCB stack is not used to run the task, it only holds the thread record */
+	thread = ( Thread_t * )( ( ( uintptr_t )pxTopOfStack - sizeof( Thread_t ) ) &
+							 ~( ( uintptr_t )portBYTE_ALIGNMENT - 1U ) );
+	memset( thread, 0, sizeof( *thread ) );
+	thread->code = pxCode;
+	thread->parameters = pvParameters;
+	sem_init( &thread->wake, 0, 0 );
+	sem_init( &thread->resume, 0, 0 );
+
+	/* The new thread starts with the stop signal blocked until it first runs */
+	sigemptyset( &signals );
+	sigaddset( &signals, portSIGNAL_STOP );
+	pthread_sigmask( SIG_BLOCK, &signals, &previous );
+	pthread_attr_init( &attr );
+	pthread_attr_setstacksize( &attr, portTHREAD_STACK_SIZE );
+	if( pthread_create( &thread->thread, &attr, prvThreadEntry, thread ) != 0 ) {
+		fprintf( stderr, "port: pthread_create failed\n" );
+		abort();
+	}
+	pthread_attr_destroy( &attr );
+	pthread_sigmask( SIG_SETMASK, &previous, NULL );
+
+	return ( StackType_t * )thread;
+}
+
+static void *prvTickThread( void *arg )
+{
+	struct timespec next;
+	Thread_t *victim;
+	Thread_t *selected;
+	BaseType_t switch_required;
+	sigset_t signals;
+
+	( void )arg;
+	sigemptyset( &signals );
+	sigaddset( &signals, portSIGNAL_STOP );
+	pthread_sigmask( SIG_BLOCK, &signals, NULL );
+
+	clock_gettime( CLOCK_MONOTONIC, &next );
+	for( ;; ) {
+		next.tv_nsec += 1000000000L / configTICK_RATE_HZ;
+		if( next.tv_nsec >= 1000000000L ) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL ) == EINTR ) {
+		}
+
+		/* Waits while a task is in a critical section, then stops the running task */
+		prvLock();
+		victim = pxRunning;
+		pthread_kill( victim->thread, portSIGNAL_STOP );
+		prvSemWait( &xParked );
+
+		xYieldPending = pdFALSE;
+		switch_required = xTaskIncrementTick();
+		vPortHostInterrupts();
+		if( switch_required != pdFALSE || xYieldPending != pdFALSE ) {
+			vTaskSwitchContext();
+		}
+
+		selected = prvCurrentThread();
+		prvRun( selected );
+		prvUnlock();
+	}
+
+	return NULL;
+}
+
+BaseType_t xPortStartScheduler( void )
+{
+	struct sigaction action;
+	pthread_t tick;
+
+	memset( &action, 0, sizeof( action ) );
+	action.sa_handler = prvStopHandler;
+	action.sa_flags = SA_RESTART;
+	sigfillset( &action.sa_mask );
+	sigaction( portSIGNAL_STOP, &action, NULL );
+	sem_init( &xParked, 0, 0 );
+	sem_init( &xSchedulerEnd, 0, 0 );
+
+	/* vTaskStartScheduler disabled interrupts, the first task starts with them enabled */
+	if( !prvLockHeld() ) {
+		prvLock();
+	}
+	prvRun( prvCurrentThread() );
+	if( pthread_create( &tick, NULL, prvTickThread, NULL ) != 0 ) {
+		fprintf( stderr, "port: cannot start the tick thread\n" );
+		abort();
+	}
+	prvUnlock();
+
+	prvSemWait( &xSchedulerEnd );
+	return pdFALSE;
+}
+
+void vPortEndScheduler( void )
+{
+	sem_post( &xSchedulerEnd );
+}
+
+void vPortYield( void )
+{
+	Thread_t *self = pxSelf;
+	Thread_t *selected;
+
+	if( self->critical_nesting == 0 ) {
+		prvLock();
+	}
+
+	vTaskSwitchContext();
+	selected = prvCurrentThread();
+	if( selected != self ) {
+		prvRun( selected );
+		prvUnlock();
+		prvSemWait( &self->wake );
+		if( self->critical_nesting != 0 ) {
+			prvLock();
+		}
+	} else if( self->critical_nesting == 0 ) {
+		prvUnlock();
+	}
+}
+
+/* Interrupts run in the tick thread, the switch happens when they return */
+void vPortYieldFromISR( void )
+{
+	xYieldPending = pdTRUE;
+}
+
+void vPortDisableInterrupts( void )
+{
+	if( !prvLockHeld() ) {
+		prvLock();
+	}
+}
+
+void vPortEnableInterrupts( void )
+{
+	if( prvLockHeld() ) {
+		prvUnlock();
+	}
+}
+
+void vPortEnterCritical( void )
+{
+	/* Kernel calls from the tick thread are already exclusive */
+	if( pxSelf == NULL ) {
+		return;
+	}
+
+	if( pxSelf->critical_nesting == 0 && !prvLockHeld() ) {
+		prvLock();
+	}
+	pxSelf->critical_nesting++;
+}
+
+void vPortExitCritical( void )
+{
+	if( pxSelf == NULL ) {
+		return;
+	}
+
+	pxSelf->critical_nesting--;
+	if( pxSelf->critical_nesting == 0 ) {
+		prvUnlock();
+	}
+}
+
+void vPortHostAtomicEnter( void )
+{
+	xAtomicNesting++;
+}
+
+/* The tick sends one stop and waits for it, no second one can come in between */
+void vPortHostAtomicExit( void )
+{
+	xAtomicNesting--;
+	if( xAtomicNesting == 0 && xStopDeferred != 0 ) {
+		xStopDeferred = 0;
+		prvStopHandler( portSIGNAL_STOP );
+	}
+}
+
+__attribute__( ( weak ) ) void vPortHostInterrupts( void )
+{
+}
@@ -0,0 +1,95 @@
+/*
+ * File: portmacro.h
+ *
+ * FreeRTOS port for the Linux host build (pthreads). Every task is a POSIX
+ * thread and only the one FreeRTOS selected runs, the others wait on a
+ * semaphore. The tick is a thread that stops the running task with SIGUSR1,
+ * runs the "interrupts" and resumes whichever task the kernel picked, so
+ * preemption and blocking behave as on the Cortex-M0+ port. A critical section
+ * holds the mutex the tick thread needs, like PRIMASK holds off SysTick.
+ *
+ * Limitation: a task stopped by the tick can be inside libc (printf, malloc)
+ * and keep its lock, keep libc calls out of tasks or inside critical sections.
+ */
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Type definitions */
+#define portCHAR                char
+#define portFLOAT               float
+#define portDOUBLE              double
+#define portLONG                long
+#define portSHORT               short
+#define portSTACK_TYPE          uintptr_t
+#define portBASE_TYPE           long
+#define portPOINTER_SIZE_TYPE   size_t
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if ( configUSE_16_BIT_TICKS == 1 )
+typedef uint16_t TickType_t;
+#define portMAX_DELAY           ( TickType_t )0xffff
+#else
+typedef uint32_t TickType_t;
+#define portMAX_DELAY           ( TickType_t )0xffffffffUL
+#define portTICK_TYPE_IS_ATOMIC 1
+#endif
+
+/* Architecture specifics */
+#define portSTACK_GROWTH        ( -1 )
+#define portHAS_STACK_OVERFLOW_CHECKING 0
+#define portTICK_PERIOD_MS      ( ( TickType_t )1000 / configTICK_RATE_HZ )
+#define portBYTE_ALIGNMENT      8
+#define portNOP()
+#define portMEMORY_BARRIER()    __sync_synchronize()
+
+/* Scheduler utilities */
+void vPortYield( void );
+void vPortYieldFromISR( void );
+#define portYIELD()                         vPortYield()
+#define portEND_SWITCHING_ISR( xSwitchRequired ) do { if( xSwitchRequired ) vPortYieldFromISR(); } while( 0 )
+#define portYIELD_FROM_ISR( x )             portEND_SWITCHING_ISR( x )
+
+/* Critical sections, "interrupts" only run in the tick thread while every task is stopped */
+void vPortDisableInterrupts( void );
+void vPortEnableInterrupts( void );
+void vPortEnterCritical( void );
+void vPortExitCritical( void );
+#define portSET_INTERRUPT_MASK_FROM_ISR()       0
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x )  ( void )( x )
+#define portDISABLE_INTERRUPTS()                vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()                 vPortEnableInterrupts()
+#define portENTER_CRITICAL()                    vPortEnterCritical()
+#define portEXIT_CRITICAL()                     vPortExitCritical()
+
+/* Task function macros as described on the FreeRTOS.org WEB site */
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters )       void vFunction( void *pvParameters )
+
+/*
+ * Called once per tick in the tick thread, after the kernel tick and with every
+ * task stopped. The peripheral models raise their interrupts from here.
+ */
+void vPortHostInterrupts( void );
+
+/*
+ * A task between these is not stopped by the tick until it leaves, the
+ * peripheral models wrap every register access in them.
+ */
+void vPortHostAtomicEnter( void );
+void vPortHostAtomicExit( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PORTMACRO_H */
@@ -0,0 +1,148 @@
+/*
+ * File: host_clock.cpp
+ *
+ * Virtual time of the peripheral models and the register access path, see
+ * host_periph.h.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_periph.h"
+
+#define HOST_EVENTS_MAX		16U
+
+/*
+ * With the FreeRTOS port, the tick stops the running task with a signal. Inside
+ * these the task finishes its register access first, so an interrupt handler
+ * never sees a peripheral model half updated. Absent in builds without the port.
+ */
+extern "C" void vPortHostAtomicEnter( void ) __attribute__( ( weak ) );
+extern "C" void vPortHostAtomicExit( void ) __attribute__( ( weak ) );
+
+static Host_Time_t Host_Now;
+static Host_Event_t *Host_Events[ HOST_EVENTS_MAX ];
+static unsigned Host_Event_Count;
+
+/*
+ * Last access. A third read in a row of the same register with the same result
+ * is a polling loop: two could be a loop that just ended and the check after it.
+ */
+static HostReg *Host_Last_Read;
+static uint32_t Host_Last_Value;
+static unsigned Host_Repeats;
+
+void Host_Clock_Reset( void ){
+	Host_Now = 0;
+	Host_Event_Count = 0;
+	Host_Last_Read = NULL;
+}
+
+Host_Time_t Host_Clock_Now( void ){
+	return Host_Now;
+}
+
+uint64_t Host_Clock_Us( void ){
+	return Host_Now / ( HOST_HSI_HZ / 1000000ULL );
+}
+
+unsigned Host_Clock_Sysclk_Shift( void ){
+	return ( Host_RCC.CR.value >> 11U ) & 0x7U;//	HSIDIV, HSISYS is the only SYSCLK source modelled
+}
+
+void Host_Event_Register( Host_Event_t *event, void ( *fire )( Host_Event_t *event ) ){
+	if( Host_Event_Count == HOST_EVENTS_MAX ){
+		fprintf( stderr, "host: too many peripheral events\n" );
+		abort( );
+	}
+	event->armed = 0;
+	event->fire = fire;
+	Host_Events[ Host_Event_Count++ ] = event;
+}
+
+void Host_Event_Set( Host_Event_t *event, Host_Time_t due ){
+	event->due = due < Host_Now ? Host_Now : due;
+	event->armed = 1;
+}
+
+void Host_Event_Cancel( Host_Event_t *event ){
+	event->armed = 0;
+}
+
+static Host_Event_t *Host_Event_Next( void ){
+	Host_Event_t *next = NULL;
+	for( unsigned i = 0; i < Host_Event_Count; i++ )
+		if( Host_Events[ i ]->armed && ( next == NULL || Host_Events[ i ]->due < next->due ) )
+			next = Host_Events[ i ];
+	return next;
+}
+
+/* Fires every event due up to 'time' in order, each one sees the clock at its own due time */
+void Host_Clock_Run_To( Host_Time_t time ){
+	Host_Event_t *next;
+
+	while( ( next = Host_Event_Next( ) ) != NULL && next->due <= time ){
+		Host_Now = next->due;
+		next->armed = 0;
+		next->fire( next );
+	}
+	if( time > Host_Now )
+		Host_Now = time;
+}
+
+void Host_Clock_Run( Host_Time_t cycles ){
+	Host_Clock_Run_To( Host_Now + cycles );
+}
+
+static Host_Time_t Host_Access_Cost( void ){
+	return ( Host_Time_t )HOST_ACCESS_CYCLES << Host_Clock_Sysclk_Shift( );
+}
+
+static uint32_t Host_Reg_Value( HostReg *reg ){
+	return reg->on_read ? reg->on_read( reg ) : reg->value;
+}
+
+uint32_t Host_Reg_Read( HostReg *reg ){
+	Host_Event_t *next;
+	uint32_t value;
+
+	if( vPortHostAtomicEnter )
+		vPortHostAtomicEnter( );
+	Host_Clock_Run( Host_Access_Cost( ) );
+	value = Host_Reg_Value( reg );
+
+	if( reg == Host_Last_Read && value == Host_Last_Value )
+		Host_Repeats++;
+	else
+		Host_Repeats = 0;
+
+	/* Polling: nothing can change before the next event, go there */
+	if( !reg->changing && Host_Repeats >= 2U ){
+		next = Host_Event_Next( );
+		if( next != NULL ){
+			Host_Clock_Run_To( next->due );
+			value = Host_Reg_Value( reg );
+			if( value != Host_Last_Value )
+				Host_Repeats = 0;
+		}
+	}
+	Host_Last_Read = reg;
+	Host_Last_Value = value;
+
+	if( vPortHostAtomicExit )
+		vPortHostAtomicExit( );
+	return value;
+}
+
+void Host_Reg_Write( HostReg *reg, uint32_t value ){
+	if( vPortHostAtomicEnter )
+		vPortHostAtomicEnter( );
+	Host_Clock_Run( Host_Access_Cost( ) );
+	if( reg->on_write )
+		reg->on_write( reg, value );
+	else
+		reg->value = value;
+	Host_Last_Read = NULL;
+
+	if( vPortHostAtomicExit )
+		vPortHostAtomicExit( );
+}
@@ -0,0 +1,187 @@
+/*
+ * File: host_lcd.cpp
+ *
+ * HD44780 character LCD on PB9-PB15, see host_periph.h. Only what lcd.c
+ * uses is modelled: 8-bit and 4-bit writes, instructions, DDRAM and CGRAM,
+ * the busy flag and address counter on reads. No 5x10 font, the display
+ * shift only moves the visible window.
+ */
+#include <string.h>
+
+#include "host_periph.h"
+
+#define HOST_LCD_RS				( 0x1UL <<  9U )
+#define HOST_LCD_RW				( 0x1UL << 10U )
+#define HOST_LCD_E				( 0x1UL << 11U )
+#define HOST_LCD_DATA_SHIFT		12U
+#define HOST_LCD_DATA			( 0xFUL << HOST_LCD_DATA_SHIFT )
+
+#define HOST_LCD_US( us )		( ( Host_Time_t )( us ) * ( HOST_HSI_HZ / 1000000ULL ) )
+#define HOST_LCD_POWER_UP		HOST_LCD_US( 40000U )//	Vcc rise to the first instruction
+#define HOST_LCD_EXEC			HOST_LCD_US( 37U )//	Most instructions and data writes at 270 kHz
+#define HOST_LCD_EXEC_LONG		HOST_LCD_US( 1520U )//	Clear display, return home
+
+static struct {
+	uint32_t pins;//	RS, RW, E, D4-D7 as last seen
+	int mode8;//	DL, the interface starts in 8-bit mode
+	int nibble_pending;
+	uint8_t high;
+	uint8_t ddram[ 0x80 ];
+	uint8_t cgram[ 0x40 ];
+	uint8_t ac;
+	uint8_t cg_ac;
+	int in_cgram;//	Data writes go to CGRAM after 'Set CGRAM address'
+	int increment;
+	int shift_display;
+	int two_lines;
+	int shift;//	Display shift in characters
+	Host_Time_t busy_until;
+	Host_LCD_Stats_t stats;
+} Host_Lcd;
+
+void Host_LCD_Reset( void ){
+	memset( &Host_Lcd, 0, sizeof( Host_Lcd ) );
+	memset( Host_Lcd.ddram, ' ', sizeof( Host_Lcd.ddram ) );
+	Host_Lcd.mode8 = 1;
+	Host_Lcd.increment = 1;
+}
+
+/* Next DDRAM address in the active area: 0x00-0x4F for one line, 0x00-0x27 and 0x40-0x67 for two */
+static uint8_t Host_LCD_Step( uint8_t address, int forward ){
+	if( !Host_Lcd.two_lines )
+		return forward ? ( address >= 0x4FU ? 0x00U : address + 1U ) : ( address == 0x00U ? 0x4FU : address - 1U );
+	if( forward )
+		return address == 0x27U ? 0x40U : address >= 0x67U ? 0x00U : address + 1U;
+	return address == 0x00U ? 0x67U : address == 0x40U ? 0x27U : address - 1U;
+}
+
+static void Host_LCD_Instruction( uint8_t value ){
+	Host_Time_t exec = HOST_LCD_EXEC;
+
+	if( value & 0x80U ){//	Set DDRAM address
+		Host_Lcd.ac = value & 0x7FU;
+		Host_Lcd.in_cgram = 0;
+	} else if( value & 0x40U ){//	Set CGRAM address
+		Host_Lcd.cg_ac = value & 0x3FU;
+		Host_Lcd.in_cgram = 1;
+	} else if( value & 0x20U ){//	Function set
+		Host_Lcd.mode8 = ( value & 0x10U ) != 0;
+		Host_Lcd.two_lines = ( value & 0x08U ) != 0;
+	} else if( value & 0x10U ){//	Cursor or display shift
+		if( value & 0x08U )
+			Host_Lcd.shift += ( value & 0x04U ) ? -1 : 1;
+		else
+			Host_Lcd.ac = Host_LCD_Step( Host_Lcd.ac, ( value & 0x04U ) != 0 );
+	} else if( value & 0x08U ){//	Display on/off control, nothing visible to model
+	} else if( value & 0x04U ){//	Entry mode set
+		Host_Lcd.increment = ( value & 0x02U ) != 0;
+		Host_Lcd.shift_display = ( value & 0x01U ) != 0;
+	} else if( value & 0x02U ){//	Return home
+		Host_Lcd.ac = 0;
+		Host_Lcd.shift = 0;
+		Host_Lcd.in_cgram = 0;
+		exec = HOST_LCD_EXEC_LONG;
+	} else if( value & 0x01U ){//	Clear display
+		memset( Host_Lcd.ddram, ' ', sizeof( Host_Lcd.ddram ) );
+		Host_Lcd.ac = 0;
+		Host_Lcd.shift = 0;
+		Host_Lcd.in_cgram = 0;
+		Host_Lcd.increment = 1;
+		exec = HOST_LCD_EXEC_LONG;
+	}
+	Host_Lcd.stats.instructions++;
+	Host_Lcd.busy_until = Host_Clock_Now( ) + exec;
+}
+
+static void Host_LCD_Data( uint8_t value ){
+	if( Host_Lcd.in_cgram ){
+		Host_Lcd.cgram[ Host_Lcd.cg_ac ] = value;
+		Host_Lcd.cg_ac = ( uint8_t )( Host_Lcd.cg_ac + ( Host_Lcd.increment ? 1 : -1 ) ) & 0x3FU;
+	} else {
+		Host_Lcd.ddram[ Host_Lcd.ac ] = value;
+		Host_Lcd.ac = Host_LCD_Step( Host_Lcd.ac, Host_Lcd.increment );
+		if( Host_Lcd.shift_display )
+			Host_Lcd.shift += Host_Lcd.increment ? 1 : -1;
+	}
+	Host_Lcd.stats.data++;
+	Host_Lcd.busy_until = Host_Clock_Now( ) + HOST_LCD_EXEC;
+}
+
+static void Host_LCD_Execute( int rs, uint8_t value ){
+	Host_Time_t now = Host_Clock_Now( );
+
+	if( now < HOST_LCD_POWER_UP )
+		Host_Lcd.stats.early++;
+	if( now < Host_Lcd.busy_until ){//	Not accepted while BF = 1
+		Host_Lcd.stats.while_busy++;
+		return;
+	}
+	if( rs )
+		Host_LCD_Data( value );
+	else
+		Host_LCD_Instruction( value );
+}
+
+/* Writes latch on the falling edge of E, in 8-bit mode D0-D3 (not wired) read as 0 */
+void Host_LCD_Pins( uint32_t odr, uint32_t moder ){
+	uint32_t pins = odr & ( HOST_LCD_RS | HOST_LCD_RW | HOST_LCD_E | HOST_LCD_DATA );
+	uint32_t rising = pins & ~Host_Lcd.pins & HOST_LCD_E;
+	uint32_t falling = Host_Lcd.pins & ~pins & HOST_LCD_E;
+	uint8_t nibble = ( uint8_t )( ( Host_Lcd.pins & HOST_LCD_DATA ) >> HOST_LCD_DATA_SHIFT );
+
+	if( rising && ( pins & HOST_LCD_RW ) ){
+		for( unsigned pin = 12; pin < 16; pin++ )
+			if( ( ( moder >> ( 2U * pin ) ) & 0x3U ) == 0x1U ){
+				Host_Lcd.stats.bus_conflicts++;
+				break;
+			}
+		if( Host_Clock_Now( ) < Host_Lcd.busy_until )
+			Host_Lcd.stats.busy_reads++;
+	}
+
+	if( falling && !( Host_Lcd.pins & HOST_LCD_RW ) ){
+		if( Host_Lcd.mode8 ){
+			Host_LCD_Execute( ( Host_Lcd.pins & HOST_LCD_RS ) != 0, ( uint8_t )( nibble << 4 ) );
+		} else if( !Host_Lcd.nibble_pending ){
+			Host_Lcd.high = nibble;
+			Host_Lcd.nibble_pending = 1;
+		} else {
+			Host_Lcd.nibble_pending = 0;
+			Host_LCD_Execute( ( Host_Lcd.pins & HOST_LCD_RS ) != 0, ( uint8_t )( ( Host_Lcd.high << 4 ) | nibble ) );
+		}
+	}
+	Host_Lcd.pins = pins;
+}
+
+/* While E is high on a read the LCD drives D7 = BF and D6-D4 = AC6-AC4 */
+uint32_t Host_LCD_Bus( uint32_t *driven ){
+	uint8_t value;
+
+	if( !( Host_Lcd.pins & HOST_LCD_E ) || !( Host_Lcd.pins & HOST_LCD_RW ) || ( Host_Lcd.pins & HOST_LCD_RS ) ){
+		*driven = 0;
+		return 0;
+	}
+	value = ( uint8_t )( ( Host_Lcd.in_cgram ? Host_Lcd.cg_ac : Host_Lcd.ac ) >> 4 ) & 0x7U;
+	if( Host_Clock_Now( ) < Host_Lcd.busy_until )
+		value |= 0x8U;
+	*driven = HOST_LCD_DATA;
+	return ( uint32_t )value << HOST_LCD_DATA_SHIFT;
+}
+
+/* Line 1 or 2, CGRAM characters (0x00-0x0F) show as '#' */
+void Host_LCD_Line( unsigned line, char *text ){
+	uint8_t base = line == 2 ? 0x40U : 0x00U;
+	unsigned width = Host_Lcd.two_lines ? 40U : 80U;
+	int shift = ( ( Host_Lcd.shift % ( int )width ) + ( int )width ) % ( int )width;
+	uint8_t c;
+
+	for( unsigned i = 0; i < 16; i++ ){
+		c = Host_Lcd.ddram[ base + ( i + ( unsigned )shift ) % width ];
+		text[ i ] = c < 0x10U ? '#' : ( char )c;
+	}
+	text[ 16 ] = '\0';
+}
+
+const Host_LCD_Stats_t *Host_LCD_Get_Stats( void ){
+	return &Host_Lcd.stats;
+}
@@ -0,0 +1,838 @@
+/*
+ * File: host_periph.cpp
+ *
+ * USART, TIM, ADC, GPIO and NVIC models of the host build, see host_periph.h.
+ *
+ * Environment:
+ *   STM32_HOST_USART1, STM32_HOST_USART2  "stdout" sends TX to the standard
+ *                  output instead of a new pseudo-terminal, "none" drops it
+ *   STM32_HOST_ADC      initial ADC reading, 0 .. 4095 (default 2048)
+ */
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "host_periph.h"
+
+RCC_TypeDef Host_RCC;
+FLASH_TypeDef Host_FLASH;
+GPIO_TypeDef Host_GPIOA, Host_GPIOB, Host_GPIOC;
+USART_TypeDef Host_USART1, Host_USART2;
+TIM_TypeDef Host_TIM1, Host_TIM3, Host_TIM14, Host_TIM16, Host_TIM17;
+ADC_TypeDef Host_ADC1;
+ADC_Common_TypeDef Host_ADC1_COMMON;
+EXTI_TypeDef Host_EXTI;
+NVIC_Type Host_NVIC;
+SysTick_Type Host_SysTick;
+
+/* Defined by the application when it uses the interrupt */
+void USART1_IRQHandler( void ) __attribute__( ( weak ) );
+void USART2_IRQHandler( void ) __attribute__( ( weak ) );
+void TIM1_BRK_UP_TRG_COM_IRQHandler( void ) __attribute__( ( weak ) );
+void TIM3_IRQHandler( void ) __attribute__( ( weak ) );
+void TIM14_IRQHandler( void ) __attribute__( ( weak ) );
+void TIM16_IRQHandler( void ) __attribute__( ( weak ) );
+void TIM17_IRQHandler( void ) __attribute__( ( weak ) );
+void ADC1_IRQHandler( void ) __attribute__( ( weak ) );
+
+static int Host_IRQ_Enabled( IRQn_Type irq ){
+	return ( Host_NVIC.ISER[0].value & ( 0x1UL << irq ) ) != 0;
+}
+
+/* ---------------------------------------------------------------- USART */
+
+#define HOST_USART_FIFO		64U
+
+typedef struct {
+	USART_TypeDef *regs;
+	const char *name;
+	IRQn_Type irq;
+	void ( *handler )( void );
+	int fd;
+	Host_Event_t tx_event;//	End of the frame in the shift register
+	int tx_busy;
+	uint8_t tx_shift;
+	int tdr_full;
+	Host_Event_t rx_event;//	Next byte completely received
+	Host_Time_t rx_last;
+	uint8_t rx_fifo[ HOST_USART_FIFO ];
+	unsigned rx_head;
+	unsigned rx_count;
+	int rx_paced;//	A pty waits for RDR to be read instead of overrunning
+	Host_Usart_Stats_t stats;
+} Host_Usart_t;
+
+static Host_Usart_t Host_Usart[ 2 ];
+
+static Host_Usart_t *Host_Usart_Of( void *reg ){
+	return ( ( uintptr_t )reg - ( uintptr_t )&Host_USART1 < sizeof( USART_TypeDef ) ) ? &Host_Usart[ 0 ] : &Host_Usart[ 1 ];
+}
+
+/* Start bit, M1:M0 data bits, STOP bits, one bit is BRR clocks (OVER8 = 0) */
+static Host_Time_t Host_Usart_Frame( Host_Usart_t *usart ){
+	uint32_t cr1 = usart->regs->CR1.value;
+	uint32_t bits = ( cr1 & ( 0x1UL << 28U ) ) ? 8U : ( cr1 & ( 0x1UL << 12U ) ) ? 11U : 10U;
+
+	if( ( ( usart->regs->CR2.value >> 12U ) & 0x3U ) == 0x2U )
+		bits++;
+	return ( ( Host_Time_t )bits * usart->regs->BRR.value ) << Host_Clock_Sysclk_Shift( );
+}
+
+static void Host_Usart_Output( Host_Usart_t *usart, uint8_t byte ){
+	usart->stats.tx_bytes++;
+	if( usart->fd >= 0 && write( usart->fd, &byte, 1 ) < 0 && errno != EAGAIN )
+		perror( usart->name );
+}
+
+static void Host_Usart_Tx_Done( Host_Event_t *event ){
+	Host_Usart_t *usart = event == &Host_Usart[ 0 ].tx_event ? &Host_Usart[ 0 ] : &Host_Usart[ 1 ];
+	USART_TypeDef *regs = usart->regs;
+
+	Host_Usart_Output( usart, usart->tx_shift );
+	if( usart->tdr_full ){
+		usart->tx_shift = ( uint8_t )regs->TDR.value;
+		usart->tdr_full = 0;
+		regs->ISR.value |= ( 0x1UL << 7U );//	TXE
+		Host_Event_Set( event, Host_Clock_Now( ) + Host_Usart_Frame( usart ) );
+	} else {
+		usart->tx_busy = 0;
+		regs->ISR.value |= ( 0x1UL << 6U );//	TC
+	}
+}
+
+static void Host_Usart_TDR_Write( HostReg *reg, uint32_t value ){
+	Host_Usart_t *usart = Host_Usart_Of( reg );
+	USART_TypeDef *regs = usart->regs;
+
+	if( !( regs->CR1.value & ( 0x1UL << 0U ) ) || !( regs->CR1.value & ( 0x1UL << 3U ) ) ){
+		reg->value = value & 0x1FFU;
+		return;
+	}
+
+	if( !usart->tx_busy ){//	Straight to the shift register, TXE stays set
+		usart->tx_busy = 1;
+		usart->tx_shift = ( uint8_t )value;
+		regs->ISR.value &= ~( 0x1UL << 6U );//	TC
+		Host_Event_Set( &usart->tx_event, Host_Clock_Now( ) + Host_Usart_Frame( usart ) );
+	} else if( regs->ISR.value & ( 0x1UL << 7U ) ){
+		reg->value = value & 0x1FFU;
+		usart->tdr_full = 1;
+		regs->ISR.value &= ~( 0x1UL << 7U );
+	} else {
+		reg->value = value & 0x1FFU;//	Overwrites the byte waiting in TDR
+		usart->stats.tx_lost++;
+	}
+}
+
+static void Host_Usart_Rx_Schedule( Host_Usart_t *usart ){
+	Host_Time_t start = usart->rx_last > Host_Clock_Now( ) ? usart->rx_last : Host_Clock_Now( );
+
+	if( usart->rx_count == 0 || usart->rx_event.armed || usart->regs->BRR.value == 0 )
+		return;
+	if( usart->rx_paced && ( usart->regs->ISR.value & ( 0x1UL << 5U ) ) )
+		return;
+	Host_Event_Set( &usart->rx_event, start + Host_Usart_Frame( usart ) );
+}
+
+static void Host_Usart_Rx_Done( Host_Event_t *event ){
+	Host_Usart_t *usart = event == &Host_Usart[ 0 ].rx_event ? &Host_Usart[ 0 ] : &Host_Usart[ 1 ];
+	USART_TypeDef *regs = usart->regs;
+	uint8_t byte = usart->rx_fifo[ usart->rx_head ];
+
+	usart->rx_head = ( usart->rx_head + 1U ) % HOST_USART_FIFO;
+	usart->rx_count--;
+	usart->rx_last = Host_Clock_Now( );
+
+	/* A disabled receiver does not see the frame */
+	if( ( regs->CR1.value & ( 0x1UL << 0U ) ) && ( regs->CR1.value & ( 0x1UL << 2U ) ) ){
+		usart->stats.rx_bytes++;
+		if( regs->ISR.value & ( 0x1UL << 5U ) ){
+			regs->ISR.value |= ( 0x1UL << 3U );//	ORE, the new byte is lost
+			usart->stats.overruns++;
+		} else {
+			regs->RDR.value = byte;
+			regs->ISR.value |= ( 0x1UL << 5U );//	RXNE
+		}
+	}
+	Host_Usart_Rx_Schedule( usart );
+}
+
+static uint32_t Host_Usart_RDR_Read( HostReg *reg ){
+	Host_Usart_t *usart = Host_Usart_Of( reg );
+	usart->regs->ISR.value &= ~( 0x1UL << 5U );
+	Host_Usart_Rx_Schedule( usart );
+	return reg->value;
+}
+
+static void Host_Usart_ICR_Write( HostReg *reg, uint32_t value ){
+	Host_Usart_Of( reg )->regs->ISR.value &= ~( value & 0x5FUL );//	PECF, FECF, NECF, ORECF, IDLECF, TCCF
+}
+
+static void Host_Usart_Push( Host_Usart_t *usart, const uint8_t *data, size_t length ){
+	while( length-- && usart->rx_count < HOST_USART_FIFO ){
+		usart->rx_fifo[ ( usart->rx_head + usart->rx_count ) % HOST_USART_FIFO ] = *data++;
+		usart->rx_count++;
+	}
+	Host_Usart_Rx_Schedule( usart );
+}
+
+void Host_Usart_Inject( USART_TypeDef *regs, const uint8_t *data, size_t length ){
+	Host_Usart_Push( Host_Usart_Of( regs ), data, length );
+}
+
+const Host_Usart_Stats_t *Host_Usart_Get_Stats( USART_TypeDef *regs ){
+	return &Host_Usart_Of( regs )->stats;
+}
+
+static int Host_Usart_Open( Host_Usart_t *usart ){
+	const char *mode;
+	char variable[ 32 ];
+
+	snprintf( variable, sizeof( variable ), "STM32_HOST_%s", usart->name );
+	mode = getenv( variable );
+	if( mode != NULL && strcmp( mode, "stdout" ) == 0 )
+		return STDOUT_FILENO;
+	if( mode != NULL && strcmp( mode, "none" ) == 0 )
+		return -1;
+	usart->rx_paced = 1;
+	return Host_Pty_Open( usart->name );
+}
+
+static int Host_Usart_Pending( Host_Usart_t *usart ){
+	uint32_t cr1 = usart->regs->CR1.value;
+	uint32_t isr = usart->regs->ISR.value;
+
+	return ( ( cr1 & ( 0x1UL << 5U ) ) && ( isr & ( ( 0x1UL << 5U ) | ( 0x1UL << 3U ) ) ) ) ||//	RXNEIE
+		   ( ( cr1 & ( 0x1UL << 7U ) ) && ( isr & ( 0x1UL << 7U ) ) ) ||//	TXEIE
+		   ( ( cr1 & ( 0x1UL << 6U ) ) && ( isr & ( 0x1UL << 6U ) ) );//	TCIE
+}
+
+/* ---------------------------------------------------------------- TIMx */
+
+typedef struct {
+	TIM_TypeDef *regs;
+	IRQn_Type irq;
+	void ( *handler )( void );
+	Host_Event_t event;//	Next update event while counting
+	int running;
+	Host_Time_t base;//	Time the counter was last at 0
+	uint32_t cnt;//	Counter while stopped
+	uint32_t psc;//	Shadow registers
+	uint32_t arr;
+	uint32_t ccr[ 4 ];
+	uint32_t updates;
+} Host_Tim_t;
+
+static Host_Tim_t Host_Tim[ 5 ];
+
+static Host_Tim_t *Host_Tim_Of( void *reg ){
+	for( unsigned i = 0; i < 5; i++ )
+		if( ( uintptr_t )reg - ( uintptr_t )Host_Tim[ i ].regs < sizeof( TIM_TypeDef ) )
+			return &Host_Tim[ i ];
+	return &Host_Tim[ 0 ];
+}
+
+static HostReg *Host_Tim_CCR( TIM_TypeDef *regs, unsigned channel ){
+	HostReg *ccr[ 4 ] = { &regs->CCR1, &regs->CCR2, &regs->CCR3, &regs->CCR4 };
+	return ccr[ channel ];
+}
+
+/* OCxPE of channel 0..3 */
+static int Host_Tim_CCR_Preload( TIM_TypeDef *regs, unsigned channel ){
+	uint32_t ccmr = channel < 2 ? regs->CCMR1.value : regs->CCMR2.value;
+	return ( ccmr & ( 0x1UL << ( ( channel & 1U ) ? 11U : 3U ) ) ) != 0;
+}
+
+static Host_Time_t Host_Tim_Count_Cycles( Host_Tim_t *tim ){
+	return ( Host_Time_t )( tim->psc + 1U ) << Host_Clock_Sysclk_Shift( );
+}
+
+static Host_Time_t Host_Tim_Period( Host_Tim_t *tim ){
+	return Host_Tim_Count_Cycles( tim ) * ( tim->arr + 1U );
+}
+
+/* UEV: preload registers to the shadows, UIF unless it came from UG with URS */
+static void Host_Tim_Update_Event( Host_Tim_t *tim, int flag ){
+	tim->psc = tim->regs->PSC.value & 0xFFFFU;
+	tim->arr = tim->regs->ARR.value & 0xFFFFU;
+	for( unsigned ch = 0; ch < 4; ch++ )
+		tim->ccr[ ch ] = Host_Tim_CCR( tim->regs, ch )->value & 0xFFFFU;
+	if( flag )
+		tim->regs->SR.value |= ( 0x1UL << 0U );
+	tim->updates++;
+}
+
+static void Host_Tim_Schedule( Host_Tim_t *tim ){
+	if( tim->running )
+		Host_Event_Set( &tim->event, tim->base + Host_Tim_Period( tim ) );
+	else
+		Host_Event_Cancel( &tim->event );
+}
+
+/* Brings the counter to the current time, one update event per overflow */
+static void Host_Tim_Sync( Host_Tim_t *tim ){
+	Host_Time_t now = Host_Clock_Now( );
+	Host_Time_t period;
+	uint64_t skipped;
+
+	if( !tim->running )
+		return;
+	period = Host_Tim_Period( tim );
+	if( now - tim->base < period )
+		return;
+
+	tim->base += period;
+	if( tim->regs->CR1.value & ( 0x1UL << 1U ) ){//	UDIS: the counter wraps, nothing else
+		skipped = ( now - tim->base ) / period;
+		tim->base += skipped * period;
+		return;
+	}
+	Host_Tim_Update_Event( tim, 1 );
+
+	/* The shadows are now stable, later overflows only count */
+	period = Host_Tim_Period( tim );
+	skipped = ( now - tim->base ) / period;
+	tim->base += skipped * period;
+	tim->updates += ( uint32_t )skipped;
+}
+
+static uint32_t Host_Tim_Counter( Host_Tim_t *tim ){
+	if( !tim->running )
+		return tim->cnt;
+	return ( uint32_t )( ( Host_Clock_Now( ) - tim->base ) / Host_Tim_Count_Cycles( tim ) );
+}
+
+static void Host_Tim_Fire( Host_Event_t *event ){
+	for( unsigned i = 0; i < 5; i++ )
+		if( event == &Host_Tim[ i ].event ){
+			Host_Tim_Sync( &Host_Tim[ i ] );
+			Host_Tim_Schedule( &Host_Tim[ i ] );
+		}
+}
+
+static void Host_Tim_CR1_Write( HostReg *reg, uint32_t value ){
+	Host_Tim_t *tim = Host_Tim_Of( reg );
+	int start = ( value & 0x1UL ) != 0;
+
+	Host_Tim_Sync( tim );
+	if( start && !tim->running )
+		tim->base = Host_Clock_Now( ) - ( Host_Time_t )tim->cnt * Host_Tim_Count_Cycles( tim );
+	else if( !start && tim->running )
+		tim->cnt = Host_Tim_Counter( tim );
+	tim->running = start;
+	reg->value = value;
+	Host_Tim_Schedule( tim );
+}
+
+static void Host_Tim_EGR_Write( HostReg *reg, uint32_t value ){
+	Host_Tim_t *tim = Host_Tim_Of( reg );
+
+	if( value & 0x1UL ){//	UG: counter and prescaler restart, shadows loaded
+		Host_Tim_Sync( tim );
+		tim->base = Host_Clock_Now( );
+		tim->cnt = 0;
+		Host_Tim_Update_Event( tim, !( tim->regs->CR1.value & ( 0x1UL << 2U ) ) );
+		Host_Tim_Schedule( tim );
+	}
+}
+
+static uint32_t Host_Tim_SR_Read( HostReg *reg ){
+	Host_Tim_Sync( Host_Tim_Of( reg ) );
+	return reg->value;
+}
+
+static void Host_Tim_SR_Write( HostReg *reg, uint32_t value ){
+	Host_Tim_Sync( Host_Tim_Of( reg ) );
+	reg->value &= value;//	rc_w0
+}
+
+static uint32_t Host_Tim_CNT_Read( HostReg *reg ){
+	Host_Tim_t *tim = Host_Tim_Of( reg );
+	Host_Tim_Sync( tim );
+	return Host_Tim_Counter( tim );
+}
+
+static void Host_Tim_CNT_Write( HostReg *reg, uint32_t value ){
+	Host_Tim_t *tim = Host_Tim_Of( reg );
+
+	Host_Tim_Sync( tim );
+	value &= 0xFFFFU;
+	if( tim->running )
+		tim->base = Host_Clock_Now( ) - ( Host_Time_t )value * Host_Tim_Count_Cycles( tim );
+	tim->cnt = value;
+	reg->value = value;
+	Host_Tim_Schedule( tim );
+}
+
+static void Host_Tim_ARR_Write( HostReg *reg, uint32_t value ){
+	Host_Tim_t *tim = Host_Tim_Of( reg );
+
+	Host_Tim_Sync( tim );
+	reg->value = value;
+	if( !( tim->regs->CR1.value & ( 0x1UL << 7U ) ) ){//	ARPE clear: takes effect at once
+		tim->arr = value & 0xFFFFU;
+		Host_Tim_Schedule( tim );
+	}
+}
+
+static void Host_Tim_CCR_Write( HostReg *reg, uint32_t value ){
+	Host_Tim_t *tim = Host_Tim_Of( reg );
+
+	reg->value = value;
+	for( unsigned ch = 0; ch < 4; ch++ )
+		if( reg == Host_Tim_CCR( tim->regs, ch ) && !Host_Tim_CCR_Preload( tim->regs, ch ) )
+			tim->ccr[ ch ] = value & 0xFFFFU;
+}
+
+/* Channel 1..4, 0 when the output is disabled or not in a PWM mode */
+uint32_t Host_TIM_Duty_Permille( TIM_TypeDef *regs, unsigned channel ){
+	Host_Tim_t *tim = Host_Tim_Of( regs );
+	unsigned ch = channel - 1U;
+	uint32_t ccmr;
+	uint32_t mode;
+	uint64_t duty;
+
+	if( ch > 3 )
+		return 0;
+	ccmr = ch < 2 ? regs->CCMR1.value : regs->CCMR2.value;
+	mode = ( ccmr >> ( ( ch & 1U ) ? 12U : 4U ) ) & 0x7U;
+	if( !( regs->CCER.value & ( 0x1UL << ( 4U * ch ) ) ) || ( mode != 6U && mode != 7U ) )
+		return 0;
+	Host_Tim_Sync( tim );
+	duty = ( uint64_t )tim->ccr[ ch ] * 1000U / ( tim->arr + 1U );
+	if( duty > 1000U )
+		duty = 1000U;
+	return mode == 6U ? ( uint32_t )duty : 1000U - ( uint32_t )duty;
+}
+
+uint32_t Host_TIM_Updates( TIM_TypeDef *regs ){
+	Host_Tim_t *tim = Host_Tim_Of( regs );
+	Host_Tim_Sync( tim );
+	return tim->updates;
+}
+
+/* ---------------------------------------------------------------- ADC1 */
+
+#define HOST_ADC_VREG_US		20U//	tADCVREG_STUP
+#define HOST_ADC_CAL_CYCLES		82U//	ADC clock cycles of a calibration
+#define HOST_ADC_STAB_CYCLES	16U//	ADEN to ADRDY, approximation
+
+typedef enum { HOST_ADC_IDLE, HOST_ADC_CALIBRATING, HOST_ADC_ENABLING, HOST_ADC_CONVERTING } Host_ADC_State_t;
+
+static struct {
+	Host_Event_t event;
+	Host_ADC_State_t state;
+	unsigned channel;
+	Host_Time_t vreg_ready;
+	uint16_t values[ 19 ];
+	Host_ADC_Stats_t stats;
+} Host_Adc;
+
+/* One ADC clock in HSI48 cycles: CKMODE, or the asynchronous clock (SYSCLK) over PRESC */
+static Host_Time_t Host_ADC_Clock( void ){
+	static const uint16_t presc[ 16 ] = { 1, 2, 4, 6, 8, 10, 12, 16, 32, 64, 128, 256, 256, 256, 256, 256 };
+	uint32_t ckmode = Host_ADC1.CFGR2.value >> 30U;
+	uint32_t divider = ckmode == 1U ? 2U : ckmode == 2U ? 4U : ckmode == 3U ? 1U
+					 : presc[ ( Host_ADC1_COMMON.CCR.value >> 18U ) & 0xFU ];
+	return ( Host_Time_t )divider << Host_Clock_Sysclk_Shift( );
+}
+
+/* Sampling time of the channel (SMP1 or SMP2 by SMPSEL) plus 12.5 cycles of conversion */
+static Host_Time_t Host_ADC_Conversion( unsigned channel ){
+	static const uint16_t half_cycles[ 8 ] = { 3, 7, 15, 25, 39, 79, 159, 321 };
+	uint32_t smpr = Host_ADC1.SMPR.value;
+	uint32_t smp = ( smpr & ( 0x1UL << ( 8U + channel ) ) ) ? ( smpr >> 4U ) & 0x7U : smpr & 0x7U;
+	return ( half_cycles[ smp ] + 25U ) * Host_ADC_Clock( ) / 2U;
+}
+
+/* Next selected channel from 'from' in the scan direction, -1 past the end */
+static int Host_ADC_Next_Channel( int from ){
+	uint32_t chselr = Host_ADC1.CHSELR.value & 0x7FFFFUL;
+	int step = ( Host_ADC1.CFGR1.value & ( 0x1UL << 2U ) ) ? -1 : 1;//	SCANDIR
+
+	for( int ch = from; ch >= 0 && ch < 19; ch += step )
+		if( chselr & ( 0x1UL << ch ) )
+			return ch;
+	return -1;
+}
+
+static void Host_ADC_Start_Sequence( void ){
+	int ch = Host_ADC_Next_Channel( ( Host_ADC1.CFGR1.value & ( 0x1UL << 2U ) ) ? 18 : 0 );
+
+	if( ch < 0 ){
+		Host_ADC1.CR.value &= ~( 0x1UL << 2U );
+		Host_Adc.state = HOST_ADC_IDLE;
+		return;
+	}
+	Host_Adc.channel = ( unsigned )ch;
+	Host_Adc.state = HOST_ADC_CONVERTING;
+	Host_Event_Set( &Host_Adc.event, Host_Clock_Now( ) + Host_ADC_Conversion( Host_Adc.channel ) );
+}
+
+static void Host_ADC_Fire( Host_Event_t *event ){
+	int step;
+	int next;
+
+	( void )event;
+	switch( Host_Adc.state ){
+	case HOST_ADC_CALIBRATING:
+		Host_ADC1.CR.value &= ~( 0x1UL << 31U );
+		Host_ADC1.CALFACT.value = 0x40U;
+		Host_ADC1.ISR.value |= ( 0x1UL << 11U );//	EOCAL
+		Host_Adc.state = HOST_ADC_IDLE;
+		break;
+
+	case HOST_ADC_ENABLING:
+		Host_ADC1.ISR.value |= ( 0x1UL << 0U );//	ADRDY
+		Host_Adc.state = HOST_ADC_IDLE;
+		break;
+
+	case HOST_ADC_CONVERTING:
+		Host_Adc.stats.conversions++;
+		if( Host_ADC1.ISR.value & ( 0x1UL << 2U ) ){//	EOC still set: DR was not read
+			Host_ADC1.ISR.value |= ( 0x1UL << 4U );//	OVR
+			Host_Adc.stats.overruns++;
+			if( Host_ADC1.CFGR1.value & ( 0x1UL << 12U ) )//	OVRMOD: overwrite
+				Host_ADC1.DR.value = Host_Adc.values[ Host_Adc.channel ];
+		} else {
+			Host_ADC1.DR.value = Host_Adc.values[ Host_Adc.channel ];
+		}
+		Host_ADC1.ISR.value |= ( 0x1UL << 2U );//	EOC
+
+		step = ( Host_ADC1.CFGR1.value & ( 0x1UL << 2U ) ) ? -1 : 1;
+		next = Host_ADC_Next_Channel( ( int )Host_Adc.channel + step );
+		if( next >= 0 ){
+			Host_Adc.channel = ( unsigned )next;
+			Host_Event_Set( &Host_Adc.event, Host_Clock_Now( ) + Host_ADC_Conversion( Host_Adc.channel ) );
+			break;
+		}
+		Host_ADC1.ISR.value |= ( 0x1UL << 3U );//	EOS
+		if( Host_ADC1.CFGR1.value & ( 0x1UL << 13U ) ){//	CONT
+			Host_ADC_Start_Sequence( );
+		} else {
+			Host_ADC1.CR.value &= ~( 0x1UL << 2U );//	ADSTART cleared by hardware
+			Host_Adc.state = HOST_ADC_IDLE;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static int Host_ADC_Vreg_Ready( uint32_t cr ){
+	return ( cr & ( 0x1UL << 28U ) ) && Host_Clock_Now( ) >= Host_Adc.vreg_ready;
+}
+
+static void Host_ADC_CR_Write( HostReg *reg, uint32_t value ){
+	uint32_t old = reg->value;
+
+	/* ADCAL and ADSTART are only set by software, hardware clears them */
+	reg->value = ( value & ~( ( 0x1UL << 4U ) | ( 0x1UL << 1U ) ) ) | ( old & ( ( 0x1UL << 31U ) | ( 0x1UL << 2U ) ) );
+
+	if( ( value & ( 0x1UL << 28U ) ) && !( old & ( 0x1UL << 28U ) ) )//	ADVREGEN
+		Host_Adc.vreg_ready = Host_Clock_Now( ) + HOST_ADC_VREG_US * ( HOST_HSI_HZ / 1000000ULL );
+
+	if( ( value & ( 0x1UL << 31U ) ) && !( old & ( 0x1UL << 31U ) ) && Host_Adc.state == HOST_ADC_IDLE ){//	ADCAL
+		if( !Host_ADC_Vreg_Ready( old ) )
+			Host_Adc.stats.early++;
+		Host_Adc.state = HOST_ADC_CALIBRATING;
+		Host_Event_Set( &Host_Adc.event, Host_Clock_Now( ) + HOST_ADC_CAL_CYCLES * Host_ADC_Clock( ) );
+	}
+
+	if( ( value & ( 0x1UL << 0U ) ) && !( old & ( 0x1UL << 0U ) ) && Host_Adc.state == HOST_ADC_IDLE ){//	ADEN
+		if( !Host_ADC_Vreg_Ready( old ) )
+			Host_Adc.stats.early++;
+		Host_Adc.state = HOST_ADC_ENABLING;
+		Host_Event_Set( &Host_Adc.event, Host_Clock_Now( ) + HOST_ADC_STAB_CYCLES * Host_ADC_Clock( ) );
+	}
+
+	if( value & ( 0x1UL << 1U ) ){//	ADDIS
+		reg->value &= ~( 0x1UL << 0U );
+		Host_ADC1.ISR.value &= ~( 0x1UL << 0U );
+	}
+
+	if( ( value & ( 0x1UL << 2U ) ) && !( old & ( 0x1UL << 2U ) ) && ( reg->value & ( 0x1UL << 0U ) ) &&
+		( Host_ADC1.ISR.value & ( 0x1UL << 0U ) ) && Host_Adc.state == HOST_ADC_IDLE ){//	ADSTART
+		reg->value |= ( 0x1UL << 2U );
+		Host_ADC_Start_Sequence( );
+	}
+
+	if( ( value & ( 0x1UL << 4U ) ) && Host_Adc.state == HOST_ADC_CONVERTING ){//	ADSTP
+		Host_Event_Cancel( &Host_Adc.event );
+		Host_Adc.state = HOST_ADC_IDLE;
+		reg->value &= ~( 0x1UL << 2U );
+	}
+}
+
+static void Host_ADC_ISR_Write( HostReg *reg, uint32_t value ){
+	reg->value &= ~value;//	rc_w1
+}
+
+static void Host_ADC_CHSELR_Write( HostReg *reg, uint32_t value ){
+	reg->value = value;
+	Host_ADC1.ISR.value |= ( 0x1UL << 13U );//	CCRDY
+}
+
+static uint32_t Host_ADC_DR_Read( HostReg *reg ){
+	Host_ADC1.ISR.value &= ~( 0x1UL << 2U );
+	return reg->value;
+}
+
+void Host_ADC_Set( uint16_t value ){
+	for( unsigned ch = 0; ch < 19; ch++ )
+		Host_Adc.values[ ch ] = value & 0x0FFFU;
+}
+
+const Host_ADC_Stats_t *Host_ADC_Get_Stats( void ){
+	return &Host_Adc.stats;
+}
+
+/* ---------------------------------------------------------------- GPIO */
+
+static uint16_t Host_GPIO_Inputs[ 3 ];
+
+static GPIO_TypeDef *Host_GPIO_Port( unsigned index ){
+	return index == 0 ? &Host_GPIOA : index == 1 ? &Host_GPIOB : &Host_GPIOC;
+}
+
+static unsigned Host_GPIO_Index( void *reg ){
+	for( unsigned i = 0; i < 3; i++ )
+		if( ( uintptr_t )reg - ( uintptr_t )Host_GPIO_Port( i ) < sizeof( GPIO_TypeDef ) )
+			return i;
+	return 0;
+}
+
+static uint32_t Host_GPIO_Outputs( GPIO_TypeDef *port ){
+	uint32_t outputs = 0;
+	for( unsigned pin = 0; pin < 16; pin++ )
+		if( ( ( port->MODER.value >> ( 2U * pin ) ) & 0x3U ) == 0x1U )
+			outputs |= ( 0x1UL << pin );
+	return outputs;
+}
+
+void Host_GPIO_Set_Input( GPIO_TypeDef *port, uint16_t pins, int level ){
+	unsigned index = Host_GPIO_Index( port );
+	if( level )
+		Host_GPIO_Inputs[ index ] |= pins;
+	else
+		Host_GPIO_Inputs[ index ] &= ~pins;
+}
+
+/* PB9-PB15 are the LCD */
+static void Host_GPIO_Changed( unsigned index ){
+	if( index == 1 )
+		Host_LCD_Pins( Host_GPIOB.ODR.value, Host_GPIOB.MODER.value );
+}
+
+static uint32_t Host_GPIO_IDR_Read( HostReg *reg ){
+	unsigned index = Host_GPIO_Index( reg );
+	GPIO_TypeDef *port = Host_GPIO_Port( index );
+	uint32_t outputs = Host_GPIO_Outputs( port );
+	uint32_t inputs = Host_GPIO_Inputs[ index ];
+	uint32_t driven;
+	uint32_t levels;
+
+	if( index == 1 ){
+		levels = Host_LCD_Bus( &driven );
+		inputs = ( inputs & ~driven ) | ( levels & driven );
+	}
+	return ( port->ODR.value & outputs ) | ( inputs & ~outputs & 0xFFFFU );
+}
+
+static void Host_GPIO_ODR_Write( HostReg *reg, uint32_t value ){
+	reg->value = value & 0xFFFFU;
+	Host_GPIO_Changed( Host_GPIO_Index( reg ) );
+}
+
+static void Host_GPIO_MODER_Write( HostReg *reg, uint32_t value ){
+	reg->value = value;
+	Host_GPIO_Changed( Host_GPIO_Index( reg ) );
+}
+
+static void Host_GPIO_BSRR_Write( HostReg *reg, uint32_t value ){
+	unsigned index = Host_GPIO_Index( reg );
+	GPIO_TypeDef *port = Host_GPIO_Port( index );
+	port->ODR.value = ( port->ODR.value & ~( value >> 16 ) ) | ( value & 0xFFFFU );//	Set wins over reset
+	Host_GPIO_Changed( index );
+}
+
+static void Host_GPIO_BRR_Write( HostReg *reg, uint32_t value ){
+	unsigned index = Host_GPIO_Index( reg );
+	GPIO_TypeDef *port = Host_GPIO_Port( index );
+	port->ODR.value &= ~( value & 0xFFFFU );
+	Host_GPIO_Changed( index );
+}
+
+/* ---------------------------------------------------------------- NVIC */
+
+static void Host_NVIC_ISER_Write( HostReg *reg, uint32_t value ){
+	reg->value |= value;
+}
+
+static void Host_NVIC_ICER_Write( HostReg *reg, uint32_t value ){
+	( void )reg;
+	Host_NVIC.ISER[0].value &= ~value;
+}
+
+static uint32_t Host_NVIC_ICER_Read( HostReg *reg ){
+	( void )reg;
+	return Host_NVIC.ISER[0].value;
+}
+
+/* ---------------------------------------------------------------- */
+
+/* Register blocks are arrays of HostReg, a class with operators: reset each one instead of a memset over it */
+template< typename Block > static void Host_Block_Reset( Block &block ){
+	HostReg *reg = reinterpret_cast< HostReg * >( &block );
+
+	for( size_t i = 0; i < sizeof( Block ) / sizeof( HostReg ); i++ )
+		reg[ i ].reset( );
+}
+
+/* Everything back to its reset value and time to 0, the LCD powers up with the MCU */
+static void Host_Periph_Reset( void ){
+	Host_Block_Reset( Host_RCC );
+	Host_Block_Reset( Host_FLASH );
+	Host_Block_Reset( Host_GPIOA );
+	Host_Block_Reset( Host_GPIOB );
+	Host_Block_Reset( Host_GPIOC );
+	Host_Block_Reset( Host_USART1 );
+	Host_Block_Reset( Host_USART2 );
+	Host_Block_Reset( Host_TIM1 );
+	Host_Block_Reset( Host_TIM3 );
+	Host_Block_Reset( Host_TIM14 );
+	Host_Block_Reset( Host_TIM16 );
+	Host_Block_Reset( Host_TIM17 );
+	Host_Block_Reset( Host_ADC1 );
+	Host_Block_Reset( Host_ADC1_COMMON );
+	Host_Block_Reset( Host_EXTI );
+	Host_Block_Reset( Host_NVIC );
+	Host_Block_Reset( Host_SysTick );
+	memset( Host_Usart, 0, sizeof( Host_Usart ) );
+	memset( Host_Tim, 0, sizeof( Host_Tim ) );
+	memset( &Host_Adc, 0, sizeof( Host_Adc ) );
+	memset( Host_GPIO_Inputs, 0, sizeof( Host_GPIO_Inputs ) );
+	Host_Clock_Reset( );
+	Host_LCD_Reset( );
+
+	Host_RCC.CR.value = 0x00001540UL;//	HSION, HSIRDY, HSIDIV = 4: SYSCLK 12 MHz
+	Host_GPIOA.MODER.value = 0xEBFFFFFFUL;//	Analog, PA13/PA14 on SWD
+	Host_GPIOB.MODER.value = 0xFFFFFFFFUL;
+	Host_GPIOC.MODER.value = 0xFFFFFFFFUL;
+	Host_USART1.ISR.value = ( 0x1UL << 7U ) | ( 0x1UL << 6U );//	TXE, TC
+	Host_USART2.ISR.value = ( 0x1UL << 7U ) | ( 0x1UL << 6U );
+}
+
+void Host_Periph_Init( void ){
+	static const IRQn_Type tim_irq[ 5 ] = { TIM1_BRK_UP_TRG_COM_IRQn, TIM3_IRQn, TIM14_IRQn, TIM16_IRQn, TIM17_IRQn };
+	void ( *tim_handler[ 5 ] )( void ) = { TIM1_BRK_UP_TRG_COM_IRQHandler, TIM3_IRQHandler, TIM14_IRQHandler,
+										   TIM16_IRQHandler, TIM17_IRQHandler };
+	TIM_TypeDef *tim_regs[ 5 ] = { &Host_TIM1, &Host_TIM3, &Host_TIM14, &Host_TIM16, &Host_TIM17 };
+	const char *value;
+	unsigned i;
+
+	Host_Periph_Reset( );
+
+	Host_Usart[ 0 ].regs = &Host_USART1;
+	Host_Usart[ 0 ].name = "USART1";
+	Host_Usart[ 0 ].irq = USART1_IRQn;
+	Host_Usart[ 0 ].handler = USART1_IRQHandler;
+	Host_Usart[ 1 ].regs = &Host_USART2;
+	Host_Usart[ 1 ].name = "USART2";
+	Host_Usart[ 1 ].irq = USART2_IRQn;
+	Host_Usart[ 1 ].handler = USART2_IRQHandler;
+	for( i = 0; i < 2; i++ ){
+		USART_TypeDef *regs = Host_Usart[ i ].regs;
+		regs->TDR.on_write = Host_Usart_TDR_Write;
+		regs->RDR.on_read = Host_Usart_RDR_Read;
+		regs->RDR.changing = 1;
+		regs->ICR.on_write = Host_Usart_ICR_Write;
+		Host_Usart[ i ].fd = Host_Usart_Open( &Host_Usart[ i ] );
+		Host_Event_Register( &Host_Usart[ i ].tx_event, Host_Usart_Tx_Done );
+		Host_Event_Register( &Host_Usart[ i ].rx_event, Host_Usart_Rx_Done );
+	}
+
+	for( i = 0; i < 5; i++ ){
+		TIM_TypeDef *regs = tim_regs[ i ];
+		Host_Tim[ i ].regs = regs;
+		Host_Tim[ i ].irq = tim_irq[ i ];
+		Host_Tim[ i ].handler = tim_handler[ i ];
+		regs->CR1.on_write = Host_Tim_CR1_Write;
+		regs->EGR.on_write = Host_Tim_EGR_Write;
+		regs->SR.on_read = Host_Tim_SR_Read;
+		regs->SR.on_write = Host_Tim_SR_Write;
+		regs->CNT.on_read = Host_Tim_CNT_Read;
+		regs->CNT.on_write = Host_Tim_CNT_Write;
+		regs->CNT.changing = 1;
+		regs->ARR.on_write = Host_Tim_ARR_Write;
+		regs->CCR1.on_write = Host_Tim_CCR_Write;
+		regs->CCR2.on_write = Host_Tim_CCR_Write;
+		regs->CCR3.on_write = Host_Tim_CCR_Write;
+		regs->CCR4.on_write = Host_Tim_CCR_Write;
+		regs->ARR.value = 0xFFFFU;
+		Host_Tim[ i ].arr = 0xFFFFU;
+		Host_Event_Register( &Host_Tim[ i ].event, Host_Tim_Fire );
+	}
+
+	Host_ADC1.CR.on_write = Host_ADC_CR_Write;
+	Host_ADC1.ISR.on_write = Host_ADC_ISR_Write;
+	Host_ADC1.CHSELR.on_write = Host_ADC_CHSELR_Write;
+	Host_ADC1.DR.on_read = Host_ADC_DR_Read;
+	Host_ADC1.DR.changing = 1;
+	Host_Event_Register( &Host_Adc.event, Host_ADC_Fire );
+	Host_ADC_Set( 2048 );
+	value = getenv( "STM32_HOST_ADC" );
+	if( value != NULL )
+		Host_ADC_Set( ( uint16_t )strtoul( value, NULL, 0 ) );
+
+	for( i = 0; i < 3; i++ ){
+		GPIO_TypeDef *port = Host_GPIO_Port( i );
+		port->IDR.on_read = Host_GPIO_IDR_Read;
+		port->ODR.on_write = Host_GPIO_ODR_Write;
+		port->MODER.on_write = Host_GPIO_MODER_Write;
+		port->BSRR.on_write = Host_GPIO_BSRR_Write;
+		port->BRR.on_write = Host_GPIO_BRR_Write;
+	}
+
+	Host_NVIC.ISER[0].on_write = Host_NVIC_ISER_Write;
+	Host_NVIC.ICER[0].on_write = Host_NVIC_ICER_Write;
+	Host_NVIC.ICER[0].on_read = Host_NVIC_ICER_Read;
+}
+
+/* Bytes typed on the receivers' pseudo-terminals join the line */
+void Host_Periph_Poll( void ){
+	uint8_t data[ HOST_USART_FIFO ];
+	ssize_t count;
+
+	for( unsigned i = 0; i < 2; i++ ){
+		Host_Usart_t *usart = &Host_Usart[ i ];
+		if( !usart->rx_paced || usart->fd < 0 || usart->rx_count == HOST_USART_FIFO )
+			continue;
+		count = read( usart->fd, data, HOST_USART_FIFO - usart->rx_count );
+		if( count > 0 )
+			Host_Usart_Push( usart, data, ( size_t )count );
+	}
+}
+
+/* Calls each pending handler until it cleared its flags, bounded against a handler that never does */
+void Host_Periph_Dispatch( void ){
+	unsigned i;
+	unsigned n;
+
+	for( i = 0; i < 2; i++ )
+		for( n = 0; n < 8 && Host_Usart[ i ].handler && Host_IRQ_Enabled( Host_Usart[ i ].irq ) &&
+					Host_Usart_Pending( &Host_Usart[ i ] ); n++ )
+			Host_Usart[ i ].handler( );
+
+	for( i = 0; i < 5; i++ )
+		for( n = 0; n < 8 && Host_Tim[ i ].handler && Host_IRQ_Enabled( Host_Tim[ i ].irq ) &&
+					( Host_Tim[ i ].regs->DIER.value & Host_Tim_SR_Read( &Host_Tim[ i ].regs->SR ) & 0x1UL ); n++ )
+			Host_Tim[ i ].handler( );
+
+	for( n = 0; n < 8 && ADC1_IRQHandler && Host_IRQ_Enabled( ADC1_IRQn ) &&
+				( Host_ADC1.IER.value & Host_ADC1.ISR.value & 0x1CUL ); n++ )//	EOCIE, EOSIE, OVRIE
+		ADC1_IRQHandler( );
+}
@@ -0,0 +1,34 @@
+/*
+ * File: host_pty.c
+ *
+ * Pseudo-terminals for the mocked UARTs. Kept apart from host_periph.cpp,
+ * <termios.h> defines CR1/CR2/CR3, which are also register names.
+ */
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+int Host_Pty_Open( const char *name ){
+	struct termios raw;
+	int fd;
+	int slave;
+
+	fd = posix_openpt( O_RDWR | O_NOCTTY | O_NONBLOCK );
+	if( fd < 0 || grantpt( fd ) != 0 || unlockpt( fd ) != 0 ){
+		perror( "posix_openpt" );
+		return -1;
+	}
+
+	/* Raw line, and the slave kept open so the master works before a client attaches */
+	slave = open( ptsname( fd ), O_RDWR | O_NOCTTY );
+	if( slave >= 0 && tcgetattr( slave, &raw ) == 0 ){
+		cfmakeraw( &raw );
+		tcsetattr( slave, TCSANOW, &raw );
+	}
+	fprintf( stderr, "host: %s on %s\n", name, ptsname( fd ) );
+	return fd;
+}
@@ -0,0 +1,72 @@
+/*
+ * File: host_system.cpp
+ *
+ * What the STM32 build gets from the HAL, the startup code and the FreeRTOS
+ * hooks, for the host build.
+ *
+ * Environment:
+ *   STM32_HOST_RUN_MS   exit after this many milliseconds of real time
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "host_periph.h"
+
+uint32_t SystemCoreClock = 12000000UL;//	HSI48 / 4 after reset, USER_RCC_Init sets 48 MHz
+
+static uint64_t Host_Boot_ns;
+static uint64_t Host_Run_Limit_ns;
+
+static uint64_t Host_Time_ns( void ){
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return ( uint64_t )now.tv_sec * 1000000000ULL + ( uint64_t )now.tv_nsec;
+}
+
+HAL_StatusTypeDef HAL_Init( void ){
+	const char *value;
+
+	/* Line-buffered so the console output keeps its order with the UART traffic */
+	setvbuf( stdout, NULL, _IOLBF, 0 );
+	Host_Boot_ns = Host_Time_ns( );
+	value = getenv( "STM32_HOST_RUN_MS" );
+	if( value != NULL )
+		Host_Run_Limit_ns = strtoull( value, NULL, 0 ) * 1000000ULL;
+	Host_Periph_Init( );
+	return HAL_OK;
+}
+
+uint32_t HAL_GetTick( void ){
+	return ( uint32_t )( Host_Clock_Us( ) / 1000U );
+}
+
+/*
+ * Tick thread, every task stopped. One tick of virtual time passes on top of
+ * what the tasks' busy-waits skipped, then the pty input and the interrupts:
+ * a handler runs up to one tick after its flag was set.
+ */
+extern "C" void vPortHostInterrupts( void ){
+	Host_Clock_Run( HOST_HSI_HZ / configTICK_RATE_HZ );
+	Host_Periph_Poll( );
+	Host_Periph_Dispatch( );
+
+	if( Host_Run_Limit_ns != 0 && Host_Time_ns( ) - Host_Boot_ns >= Host_Run_Limit_ns ){
+		fflush( stdout );
+		_exit( 0 );
+	}
+}
+
+/* Give the host core back instead of spinning, the next tick wakes the idle task anyway */
+extern "C" void vApplicationIdleHook( void ){
+	struct timespec pause = { 0, 200000L };
+	nanosleep( &pause, NULL );
+}
+
+extern "C" void vAssertCalled( const char *file, unsigned long line ){
+	fprintf( stderr, "configASSERT failed: %s:%lu\n", file, line );
+	abort( );
+}
@@ -0,0 +1,202 @@
+/*
+ * File: timing_test.cpp
+ *
+ * Timing regression test of the Stm32RTOS drivers, run unchanged on the
+ * peripheral models of host_periph.h. Each step is timed in virtual time and
+ * fails past its budget, a driver change that makes the LCD or the boot slower
+ * shows up here before it reaches the board. The steps also check what the
+ * models saw: the LCD text, the PWM preload, the UART parser and no HD44780
+ * protocol violations.
+ *
+ * The budgets are the measured times plus a margin, update them together with
+ * a change that is meant to move them.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "lcd.h"
+#include "user_tim.h"
+#include "user_uart.h"
+#include "host_periph.h"
+
+/* main.c, built with its main() renamed */
+void USER_RCC_Init( void );
+void System_init( void );
+void System_init_background( void );
+void Show_data( void );
+void Manage_msg( void );
+extern char buffer_vel[ 8 ];
+extern char buffer_rpm[ 8 ];
+extern char buffer_gear[ 8 ];
+extern volatile uint16_t boot_pwm_us;
+
+uint16_t USER_ADC_Read( void );
+
+static int Failures;
+
+static void Check( int condition, const char *what ){
+	if( !condition ){
+		printf( "FAIL  %s\n", what );
+		Failures++;
+	}
+}
+
+/* Time since 'start', within [min_us, max_us] */
+static void Check_Time( const char *name, uint64_t start, uint64_t min_us, uint64_t max_us ){
+	uint64_t elapsed = Host_Clock_Us( ) - start;
+
+	printf( "%-22s %9llu us   budget %llu .. %llu us\n", name, ( unsigned long long )elapsed,
+			( unsigned long long )min_us, ( unsigned long long )max_us );
+	if( elapsed < min_us || elapsed > max_us ){
+		printf( "FAIL  %s out of budget\n", name );
+		Failures++;
+	}
+}
+
+static void Check_LCD( const char *step ){
+	const Host_LCD_Stats_t *lcd = Host_LCD_Get_Stats( );
+	char what[ 64 ];
+
+	snprintf( what, sizeof( what ), "%s: LCD write while busy (%u)", step, ( unsigned )lcd->while_busy );
+	Check( lcd->while_busy == 0, what );
+	snprintf( what, sizeof( what ), "%s: LCD write before power-up (%u)", step, ( unsigned )lcd->early );
+	Check( lcd->early == 0, what );
+}
+
+static void Check_Line( unsigned line, const char *expected ){
+	char text[ 17 ];
+	char what[ 64 ];
+
+	Host_LCD_Line( line, text );
+	snprintf( what, sizeof( what ), "LCD line %u is \"%s\"", line, text );
+	Check( strcmp( text, expected ) == 0, what );
+}
+
+static void Test_LCD_Init( void ){
+	uint64_t start;
+
+	Host_Periph_Init( );
+	USER_RCC_Init( );
+	USER_TIM14_Init( );
+	USER_TIM16_Boot_Start( );//	USER_Delay_us timebase
+	start = Host_Clock_Us( );
+	LCD_Init( );
+	Check_Time( "LCD_Init", start, 150000U, 165000U );
+	Check_LCD( "LCD_Init" );
+}
+
+/* Only the control path is on the boot path, the ADC and the LCD follow from Task1 */
+static void Test_Boot( void ){
+	uint64_t start;
+	char what[ 64 ];
+
+	Host_Periph_Init( );
+	start = Host_Clock_Us( );
+	System_init( );
+	Check_Time( "System_init", start, 15U, 40U );
+	Check( TIM3->CR1 & ( 0x1UL << 0U ), "TIM3 PWM running after System_init" );
+	/* Stamped by the first update event, one 1 kHz period after the counter starts */
+	Host_Clock_Run( HOST_HSI_HZ / 1000U );
+	Host_Periph_Dispatch( );
+	snprintf( what, sizeof( what ), "PWM running %u us after the clock setup", ( unsigned )boot_pwm_us );
+	Check( boot_pwm_us >= 1000U && boot_pwm_us <= 1020U, what );
+
+	/* Before the scheduler starts, so the three 50 ms LCD waits are TIM14 busy-waits, the rest is on TIM16 */
+	start = Host_Clock_Us( );
+	System_init_background( );
+	Check_Time( "System_init_background", start, 150000U, 170000U );
+	Check_LCD( "System_init_background" );
+	Check( Host_ADC_Get_Stats( )->early == 0, "ADC calibrated or enabled before the regulator started" );
+}
+
+/* Runs after Test_Boot, on the initialised peripherals */
+static void Test_Show_Data( void ){
+	uint64_t start;
+
+	strcpy( buffer_vel, "12.5" );
+	strcpy( buffer_rpm, "1800" );
+	strcpy( buffer_gear, "3" );
+	start = Host_Clock_Us( );
+	Show_data( );
+	Check_Time( "Show_data", start, 1800U, 2100U );
+	Check_LCD( "Show_data" );
+	Check_Line( 1, "Vel:12.5   G:3  " );
+	Check_Line( 2, "RPM:1800        " );
+}
+
+static void Test_Delay( void ){
+	uint64_t start = Host_Clock_Us( );
+	USER_TIM14_Delay( 5 );
+	Check_Time( "USER_TIM14_Delay(5)", start, 5000U, 5050U );
+}
+
+static void Test_ADC( void ){
+	uint64_t start;
+	uint16_t value;
+
+	Host_ADC_Set( 1234 );
+	start = Host_Clock_Us( );
+	value = USER_ADC_Read( );
+	Check_Time( "USER_ADC_Read", start, 5U, 12U );
+	Check( value == 1234, "ADC reading" );
+	Check( Host_ADC_Get_Stats( )->overruns == 0, "ADC overrun" );
+}
+
+/* CCR1 is preloaded (OC1PE): the new duty only appears at the next update */
+static void Test_PWM_Preload( void ){
+	uint32_t before = Host_TIM_Duty_Permille( TIM3, 1 );
+
+	update_cycle( 25, 1 );
+	Check( Host_TIM_Duty_Permille( TIM3, 1 ) == before, "TIM3 CCR1 took effect before the update event" );
+	Host_Clock_Run( HOST_HSI_HZ / 1000U );//	One 1 kHz period
+	Check( Host_TIM_Duty_Permille( TIM3, 1 ) == 250U, "TIM3 CH1 at 25 % after the update event" );
+}
+
+/* 16 bytes at 115200 baud: returns when the last one is in TDR, 14 frames later */
+static void Test_UART2_Transmit( void ){
+	uint8_t message[] = "Vel:12.5 G:3 OK\n";
+	uint64_t start = Host_Clock_Us( );
+	uint32_t sent = Host_Usart_Get_Stats( USART2 )->tx_bytes;
+
+	USER_UART2_Transmit( message, 16 );
+	Check_Time( "USER_UART2_Transmit", start, 1200U, 1240U );
+	while( !( USART2->ISR & ( 0x1UL << 6U ) ) );//	TC
+	Check( Host_Usart_Get_Stats( USART2 )->tx_bytes - sent == 16U, "USART2 sent 16 bytes" );
+	Check( Host_Usart_Get_Stats( USART2 )->tx_lost == 0, "USART2 lost a byte" );
+}
+
+/* The ESP32 message format at 9600 baud, polled through Manage_msg */
+static void Test_UART1_Receive( void ){
+	const char *message = "12V34S5E";
+	uint64_t start = Host_Clock_Us( );
+
+	Host_Usart_Inject( USART1, ( const uint8_t * )message, strlen( message ) );
+	for( size_t i = 0; i < strlen( message ); i++ ){
+		while( !( USART1->ISR & ( 0x1UL << 5U ) ) );//	RXNE
+		Manage_msg( );
+	}
+	Check_Time( "USART1 8 bytes in", start, 8330U, 8360U );
+	Check( strcmp( buffer_vel, "12" ) == 0 && strcmp( buffer_rpm, "34" ) == 0 && strcmp( buffer_gear, "5" ) == 0,
+		   "Manage_msg parsed V, S and E" );
+	Check( Host_Usart_Get_Stats( USART1 )->overruns == 0, "USART1 overrun" );
+}
+
+int main( void ){
+	setenv( "STM32_HOST_USART1", "none", 1 );
+	setenv( "STM32_HOST_USART2", "none", 1 );
+
+	Test_LCD_Init( );
+	Test_Boot( );
+	Test_Show_Data( );
+	Test_Delay( );
+	Test_ADC( );
+	Test_PWM_Preload( );
+	Test_UART2_Transmit( );
+	Test_UART1_Receive( );
+
+	Check( Host_LCD_Get_Stats( )->bus_conflicts == 0, "LCD read with the data pins still outputs" );
+	printf( "%s\n", Failures ? "FAILED" : "PASSED" );
+	return Failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -18,8 +18,15 @@ const TractorDashboard = () => {
   // WebSocket and API references
   const wsRef = useRef(null);
   const reconnectTimeoutRef = useRef(null);
+  const syncIntervalRef = useRef(null);
   const API_BASE_URL = 'http://192.168.0.244:8000';
 
+  // Clock sync with the backend for the latency traces: offset of the backend
+  // clock (microseconds) from performance.now(), taken from the exchange with
+  // the shortest round trip among the last SYNC_WINDOW ones
+  const SYNC_WINDOW = 8;
+  const syncSamplesRef = useRef([]);
+
   // WebSocket connection and data fetching
   useEffect(() => {
     connectWebSocket();
@@ -33,9 +40,45 @@ const TractorDashboard = () => {
       if (reconnectTimeoutRef.current) {
         clearTimeout(reconnectTimeoutRef.current);
       }
+      if (syncIntervalRef.current) {
+        clearInterval(syncIntervalRef.current);
+      }
     };
   }, []);
 
+  const sendSync = (ws) => {
+    if (ws.readyState === WebSocket.OPEN) {
+      ws.send(JSON.stringify({ type: 'sync', t1: performance.now() }));
+    }
+  };
+
+  const handleSync = (message, t4) => {
+    const rtt = (t4 - message.t1) * 1000 - (message.t3 - message.t2);
+    const offset = (message.t2 + message.t3) / 2 - ((message.t1 + t4) / 2) * 1000;
+    syncSamplesRef.current = [...syncSamplesRef.current, { rtt, offset }].slice(-SYNC_WINDOW);
+  };
+
+  // performance.now() milliseconds to backend microseconds, null before the first sync
+  const toBackendUs = (ms) => {
+    const samples = syncSamplesRef.current;
+    if (samples.length === 0) return null;
+    const best = samples.reduce((a, b) => (b.rtt < a.rtt ? b : a));
+    return Math.round(ms * 1000 + best.offset);
+  };
+
+  // Answers a traced update once the frame showing it has been painted
+  const answerTrace = (ws, id, rxMs) => {
+    requestAnimationFrame(() => {
+      requestAnimationFrame(() => {
+        const rx = toBackendUs(rxMs);
+        const render = toBackendUs(performance.now());
+        if (rx !== null && ws.readyState === WebSocket.OPEN) {
+          ws.send(JSON.stringify({ type: 'trace', id, rx, render }));
+        }
+      });
+    });
+  };
+
   const connectWebSocket = () => {
     try {
       const ws = new WebSocket('ws://192.168.0.244:8000/ws');
@@ -47,11 +90,19 @@ const TractorDashboard = () => {
         if (reconnectTimeoutRef.current) {
           clearTimeout(reconnectTimeoutRef.current);
         }
+        sendSync(ws);
+        syncIntervalRef.current = setInterval(() => sendSync(ws), 1000);
       };
 
       ws.onmessage = (event) => {
+        const rxMs = performance.now();
         try {
           const message = JSON.parse(event.data);
+
+          if (message.type === 'sync') {
+            handleSync(message, rxMs);
+            return;
+          }
           
           if (message.type === 'data_update' || message.type === 'initial_data') {
             const newData = {
@@ -75,6 +126,10 @@ const TractorDashboard = () => {
               const updated = [...prev, { ...newData, time: Date.now() }];
               return updated.slice(-50);
             });
+
+            if (message.trace) {
+              answerTrace(ws, message.trace.id, rxMs);
+            }
           }
         } catch (error) {
           console.error('Error parsing WebSocket message:', error);
@@ -84,6 +139,11 @@ const TractorDashboard = () => {
       ws.onclose = () => {
         console.log('WebSocket disconnected');
         setBackendConnected(false);
+        if (syncIntervalRef.current) {
+          clearInterval(syncIntervalRef.current);
+          syncIntervalRef.current = null;
+        }
+        syncSamplesRef.current = [];
         
         // Attempt to reconnect after 3 seconds
         reconnectTimeoutRef.current = setTimeout(() => {